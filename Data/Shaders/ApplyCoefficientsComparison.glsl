@@ -0,0 +1,129 @@
+-- Vertex
+
+#version 430 core
+
+in vec2 vertexPosition;
+in vec2 vertexTexCoord;
+out vec2 st;
+
+void main() {
+    st = vertexTexCoord;
+    gl_Position = vec4(vertexPosition, 0.0, 1.0);
+}
+
+-- Fragment
+
+#version 430 core
+
+/*
+ * Code for handling weights from: https://github.com/mgharbi/hdrnet/blob/master/benchmark/assets/std.frag
+
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * License of adapted code:
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Applies up to four filters to the same image in one pass. The views are arranged in tileLayout.x columns
+// and tileLayout.y rows. The grids of all filters are stacked along the guidance axis of the grid textures.
+
+#define MAX_VIEWS 4
+
+uniform sampler2D image;
+uniform sampler3D affineGridRow0;
+uniform sampler3D affineGridRow1;
+uniform sampler3D affineGridRow2;
+uniform int numViews;
+uniform ivec2 tileLayout;
+// Depth of the grid of one filter
+uniform float gridDepth;
+
+// Guidance map data of all filters (the columns of the 3x4 color matrices, 16 segments per filter)
+uniform vec4 guideCCM[MAX_VIEWS*3];
+uniform vec3 guideShifts[MAX_VIEWS*16];
+uniform vec3 guideSlopes[MAX_VIEWS*16];
+uniform vec4 mixMatrix[MAX_VIEWS];
+
+in vec2 st;
+out vec4 fragColorOut;
+
+void main() {
+    // The quad is mirrored horizontally, so the first column of views is at st.x = 1
+    vec2 tiledSt = st * vec2(tileLayout);
+    ivec2 tile = min(ivec2(tiledSt), tileLayout - ivec2(1));
+    vec2 localSt = tiledSt - vec2(tile);
+    int viewIndex = tile.y * tileLayout.x + (tileLayout.x - 1 - tile.x);
+    if (viewIndex >= numViews) {
+        fragColorOut = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec4 imageColor = vec4(texture(image, localSt).rgb, 1.0);
+
+    // 1. Compute guidance map value
+    vec3 temp = vec3(
+            dot(imageColor, guideCCM[viewIndex*3]),
+            dot(imageColor, guideCCM[viewIndex*3 + 1]),
+            dot(imageColor, guideCCM[viewIndex*3 + 2]));
+    vec3 acc = vec3(0.0);
+    for (int i = 0; i < 16; ++i) {
+        acc += guideSlopes[viewIndex*16 + i].xyz * max(vec3(0), temp - guideShifts[viewIndex*16 + i].xyz);
+    }
+    float guidanceValue = clamp(dot(mixMatrix[viewIndex], vec4(acc, 1.0)), 0.0, 1.0);
+
+    // 2. Compute sliced coefficients (clamped to the grid of this view like GL_CLAMP_TO_EDGE)
+    float gridZ = clamp(guidanceValue * gridDepth, 0.5, gridDepth - 0.5);
+    vec3 gridCoords = vec3(localSt, (float(viewIndex) * gridDepth + gridZ) / (gridDepth * float(numViews)));
+    vec4 matRows[3];
+    matRows[0] = texture(affineGridRow0, gridCoords);
+    matRows[1] = texture(affineGridRow1, gridCoords);
+    matRows[2] = texture(affineGridRow2, gridCoords);
+
+    // 3. Apply coefficients
+    float r = dot(matRows[0], imageColor);
+    float g = dot(matRows[1], imageColor);
+    float b = dot(matRows[2], imageColor);
+    fragColorOut = clamp(vec4(r, g, b, 1.0), 0.0, 1.0);
+}
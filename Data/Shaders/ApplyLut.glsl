@@ -0,0 +1,63 @@
+-- Vertex
+
+#version 430 core
+
+in vec2 vertexPosition;
+in vec2 vertexTexCoord;
+out vec2 st;
+
+void main() {
+    st = vertexTexCoord;
+    gl_Position = vec4(vertexPosition, 0.0, 1.0);
+}
+
+-- Fragment
+
+#version 430 core
+
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Color LUT baked from a model (see LutBaker.cpp), applied instead of the network and grid
+uniform sampler2D image;
+uniform sampler3D colorLut;
+uniform float lutSize;
+
+in vec2 st;
+out vec4 fragColorOut;
+
+void main() {
+    vec3 imageColor = clamp(texture(image, st).rgb, 0.0, 1.0);
+    // Map [0, 1] to the centers of the first and the last texel
+    vec3 lutCoords = (imageColor * (lutSize - 1.0) + 0.5) / lutSize;
+    fragColorOut = vec4(texture(colorLut, lutCoords).rgb, 1.0);
+}
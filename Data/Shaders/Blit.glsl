@@ -44,9 +44,38 @@ void main() {
 #version 430 core
 
 uniform sampler2D inputTexture;
+
+// Layout of inputTexture (see FrameFormat): 0 = RGBA, 2 = YUYV packed into an RGBA texture of half the width
+// (Y0 U Y1 V per texel, read unfiltered), 3 = NV12 with the luma plane in inputTexture
+// and the UV plane in chromaImage.
+uniform int inputFormat;
+uniform sampler2D chromaImage;
+
+// Keep in sync with yuvToRgb in YuvFrame.hpp (BT.601, limited range)
+vec3 yuvToRgb(float y, float u, float v) {
+    y = 1.164 * (y - 16.0 / 255.0);
+    u -= 128.0 / 255.0;
+    v -= 128.0 / 255.0;
+    return clamp(vec3(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u), 0.0, 1.0);
+}
+
+vec3 readImageColor(vec2 texCoord) {
+    if (inputFormat == 2) {
+        ivec2 packedSize = textureSize(inputTexture, 0);
+        ivec2 pixel = clamp(ivec2(texCoord * vec2(packedSize.x * 2, packedSize.y)),
+                ivec2(0), ivec2(packedSize.x * 2 - 1, packedSize.y - 1));
+        vec4 yuyv = texelFetch(inputTexture, ivec2(pixel.x / 2, pixel.y), 0);
+        return yuvToRgb((pixel.x & 1) == 0 ? yuyv.r : yuyv.b, yuyv.g, yuyv.a);
+    } else if (inputFormat == 3) {
+        vec2 uv = texture(chromaImage, texCoord).rg;
+        return yuvToRgb(texture(inputTexture, texCoord).r, uv.r, uv.g);
+    }
+    return texture(inputTexture, texCoord).rgb;
+}
+
 in vec2 fragTexCoord;
 out vec4 fragColor;
 
 void main() {
-    fragColor = texture(inputTexture, fragTexCoord);
+    fragColor = vec4(readImageColor(fragTexCoord), 1.0);
 }
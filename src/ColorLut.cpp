@@ -0,0 +1,156 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <Utils/File/Logfile.hpp>
+#include "ColorLut.hpp"
+
+using namespace sgl;
+
+// Larger tables would need more than 200 MB (the usual sizes are 17, 33 and 65)
+const int MAX_LUT_SIZE = 256;
+
+ColorLut::ColorLut(int size) : size(size), entries(size_t(size) * size_t(size) * size_t(size)) {
+    float scale = 1.0f / float(size - 1);
+    for (int b = 0; b < size; b++) {
+        for (int g = 0; g < size; g++) {
+            for (int r = 0; r < size; r++) {
+                at(r, g, b) = glm::vec3(r, g, b) * scale;
+            }
+        }
+    }
+}
+
+glm::vec3 ColorLut::sample(const glm::vec3& color) const {
+    glm::vec3 position = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f)) * float(size - 1);
+    glm::ivec3 index0 = glm::min(glm::ivec3(position), glm::ivec3(size - 2));
+    glm::vec3 weight = position - glm::vec3(index0);
+
+    glm::vec3 c00 = glm::mix(at(index0.x, index0.y, index0.z), at(index0.x+1, index0.y, index0.z), weight.x);
+    glm::vec3 c10 = glm::mix(at(index0.x, index0.y+1, index0.z), at(index0.x+1, index0.y+1, index0.z), weight.x);
+    glm::vec3 c01 = glm::mix(at(index0.x, index0.y, index0.z+1), at(index0.x+1, index0.y, index0.z+1), weight.x);
+    glm::vec3 c11 = glm::mix(
+            at(index0.x, index0.y+1, index0.z+1), at(index0.x+1, index0.y+1, index0.z+1), weight.x);
+    return glm::mix(glm::mix(c00, c10, weight.y), glm::mix(c01, c11, weight.y), weight.z);
+}
+
+void ColorLut::apply(const FrameData& input, FrameData& output) const {
+    output.allocate(input.w, input.h);
+    size_t numPixels = size_t(input.w) * size_t(input.h);
+    for (size_t i = 0; i < numPixels; i++) {
+        const uint8_t *inputPixel = input.pixels + i*4;
+        uint8_t *outputPixel = output.pixels + i*4;
+        glm::vec3 color = sample(glm::vec3(inputPixel[0], inputPixel[1], inputPixel[2]) / 255.0f);
+        color = glm::clamp(color, glm::vec3(0.0f), glm::vec3(1.0f)) * 255.0f + glm::vec3(0.5f);
+        outputPixel[0] = uint8_t(color.r);
+        outputPixel[1] = uint8_t(color.g);
+        outputPixel[2] = uint8_t(color.b);
+        outputPixel[3] = inputPixel[3];
+    }
+}
+
+bool ColorLut::saveCubeFile(const std::string& filename, const std::string& title) const {
+    std::ofstream file(filename.c_str());
+    if (!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in ColorLut::saveCubeFile: Couldn't open file \"" + filename + "\".");
+        return false;
+    }
+    file << "TITLE \"" << title << "\"\n";
+    file << "LUT_3D_SIZE " << size << "\n";
+    file << "DOMAIN_MIN 0.0 0.0 0.0\n";
+    file << "DOMAIN_MAX 1.0 1.0 1.0\n";
+    file << std::fixed << std::setprecision(6);
+    for (const glm::vec3& entry : entries) {
+        file << entry.r << " " << entry.g << " " << entry.b << "\n";
+    }
+    return file.good();
+}
+
+bool ColorLut::loadCubeFile(const std::string& filename) {
+    std::ifstream file(filename.c_str());
+    if (!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in ColorLut::loadCubeFile: Couldn't open file \"" + filename + "\".");
+        return false;
+    }
+
+    size = 0;
+    entries.clear();
+    auto invalidFile = [&](const std::string& reason) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in ColorLut::loadCubeFile: \"" + filename + "\" isn't a valid 3D LUT ("
+                + reason + ").");
+        size = 0;
+        entries.clear();
+        return false;
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream lineStream(line);
+        std::string keyword;
+        if (line.compare(0, 11, "LUT_3D_SIZE") == 0) {
+            if (!(lineStream >> keyword >> size) || size < 2 || size > MAX_LUT_SIZE) {
+                return invalidFile("LUT_3D_SIZE must be between 2 and " + std::to_string(MAX_LUT_SIZE));
+            }
+            entries.reserve(size_t(size) * size_t(size) * size_t(size));
+        } else if (line.compare(0, 10, "DOMAIN_MIN") == 0 || line.compare(0, 10, "DOMAIN_MAX") == 0) {
+            // Only the domain [0, 1] is supported (sample clamps to it)
+            glm::vec3 bound;
+            float expectedBound = line.compare(0, 10, "DOMAIN_MIN") == 0 ? 0.0f : 1.0f;
+            if (!(lineStream >> keyword >> bound.r >> bound.g >> bound.b) || bound != glm::vec3(expectedBound)) {
+                return invalidFile("only the domain [0, 1] is supported");
+            }
+        } else if (line.compare(0, 11, "LUT_1D_SIZE") == 0) {
+            return invalidFile("1D tables aren't supported");
+        } else if (line.compare(0, 5, "TITLE") == 0) {
+            continue;
+        } else {
+            glm::vec3 entry;
+            if (lineStream >> entry.r >> entry.g >> entry.b) {
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    if (size < 2 || entries.size() != size_t(size) * size_t(size) * size_t(size)) {
+        return invalidFile("wrong number of entries");
+    }
+    return true;
+}
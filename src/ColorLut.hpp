@@ -0,0 +1,65 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COLORLUT_HPP_
+#define COLORLUT_HPP_
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+
+/**
+ * 3D color lookup table mapping RGB in [0, 1]^3 to RGB. The entries are stored in the order of the
+ * .cube format (red varies fastest, then green, then blue), i.e. the same layout as an RGB 3D texture.
+ */
+struct ColorLut {
+    ColorLut() : size(0) {}
+    //! Identity transform with size^3 entries
+    explicit ColorLut(int size);
+
+    inline const glm::vec3& at(int r, int g, int b) const { return entries[r + size*(g + size*b)]; }
+    inline glm::vec3& at(int r, int g, int b) { return entries[r + size*(g + size*b)]; }
+    //! Trilinear interpolation of the entries
+    glm::vec3 sample(const glm::vec3& color) const;
+    //! Applies the table to a 32-bit RGBA image on the CPU (alpha is kept). Output is (re-)allocated.
+    void apply(const FrameData& input, FrameData& output) const;
+
+    //! Adobe/Resolve .cube format (3D tables with the domain [0, 1] and at most 256^3 entries only)
+    bool saveCubeFile(const std::string& filename, const std::string& title) const;
+    bool loadCubeFile(const std::string& filename);
+
+    int size;
+    std::vector<glm::vec3> entries;
+};
+
+#endif /* COLORLUT_HPP_ */
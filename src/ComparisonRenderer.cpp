@@ -0,0 +1,267 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <GL/glew.h>
+#include <Utils/File/Logfile.hpp>
+#include <Utils/AppSettings.hpp>
+#include <Graphics/Window.hpp>
+#include "GridRenderer.hpp"
+#include "Tracer.hpp"
+#include "ComparisonRenderer.hpp"
+
+using namespace sgl;
+
+ComparisonRenderer::ComparisonRenderer() : gridsValid(false), textureMemory(MEMORY_TEXTURES) {
+    comparisonShader = ShaderManager->getShaderProgram(
+            {"ApplyCoefficientsComparison.Vertex", "ApplyCoefficientsComparison.Fragment"});
+    MemoryAccounting::get()->addReclaimer(this, RECLAIM_PRIORITY_IDLE_MODELS);
+}
+
+ComparisonRenderer::~ComparisonRenderer() {
+    MemoryAccounting::get()->removeReclaimer(this);
+}
+
+void ComparisonRenderer::setFilters(const std::vector<std::string>& filterPaths) {
+    // All predictors run at the same time, so they share the cores
+    int numThreadsPerFilter = std::max(int(std::thread::hardware_concurrency()) / MAX_VIEWS, 1);
+
+    // Filters that are already loaded are marked active first, so they aren't released as idle models when the
+    // others are loaded
+    size_t numFilters = std::min(filterPaths.size(), size_t(MAX_VIEWS));
+    std::vector<FilterPtr> filters(numFilters);
+    activeFilters.clear();
+    for (size_t i = 0; i < numFilters; i++) {
+        std::map<std::string, FilterPtr>::iterator it = loadedFilters.find(filterPaths.at(i));
+        if (it != loadedFilters.end()) {
+            filters.at(i) = it->second;
+            activeFilters.push_back(it->second);
+        }
+    }
+
+    for (size_t i = 0; i < numFilters; i++) {
+        if (filters.at(i)) {
+            continue;
+        }
+        const std::string& path = filterPaths.at(i);
+        FilterPtr filter(new Filter);
+        filter->path = path;
+        filter->inferenceTimeMs = 0.0f;
+        filter->valid = false;
+        if (!filter->gridPredictor.loadGraph(path, numThreadsPerFilter) || !filter->guide.load(path)) {
+            Logfile::get()->writeError(
+                    std::string() + "ERROR in ComparisonRenderer::setFilters: Couldn't load \"" + path + "\".");
+            continue;
+        }
+        loadedFilters.insert(std::make_pair(path, filter));
+        filters.at(i) = filter;
+        activeFilters.push_back(filter);
+    }
+
+    // Same order as the paths
+    activeFilters.clear();
+    for (FilterPtr& filter : filters) {
+        if (filter) {
+            activeFilters.push_back(filter);
+        }
+    }
+
+    gridsValid = false;
+    updateGuideUniforms();
+}
+
+bool ComparisonRenderer::predictGrids(FrameDataPtr& lowresImage) {
+    TRACE_SCOPE("ComparisonRenderer::predictGrids");
+    std::vector<std::thread> threads;
+    for (FilterPtr& filter : activeFilters) {
+        FrameDataPtr threadLowresImage = lowresImage;
+        threads.push_back(std::thread([filter, threadLowresImage]() mutable {
+            Tracer::setThreadName("comparison predictor");
+            std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+            GridCoefficientsPtr grid = filter->gridPredictor.computeGridCoefficients(*threadLowresImage);
+            filter->valid = bool(grid);
+            if (filter->valid) {
+                filter->grid = *grid;
+            }
+            filter->inferenceTimeMs = std::chrono::duration<float, std::milli>(
+                    std::chrono::steady_clock::now() - startTime).count();
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    uploadGrids();
+    return gridsValid;
+}
+
+void ComparisonRenderer::uploadGrids() {
+    gridsValid = false;
+    if (activeFilters.empty()) {
+        return;
+    }
+    glm::ivec3 gridSize = activeFilters.front()->grid.gridSize;
+    for (FilterPtr& filter : activeFilters) {
+        if (!filter->valid) {
+            return;
+        }
+        if (filter->grid.gridSize != gridSize) {
+            Logfile::get()->writeError(
+                    "ERROR in ComparisonRenderer::uploadGrids: Only filters with the same grid size can be compared.");
+            return;
+        }
+    }
+
+    int numViews = int(activeFilters.size());
+    glm::ivec3 textureSize(gridSize.x, gridSize.y, gridSize.z * numViews);
+    if (gridTextures.empty() || textureSize != gridTextureSize) {
+        TextureSettings settings;
+        settings.type = TEXTURE_3D;
+        settings.internalFormat = GL_RGBA16F;
+        settings.textureWrapS = GL_CLAMP_TO_EDGE;
+        settings.textureWrapT = GL_CLAMP_TO_EDGE;
+        settings.textureWrapR = GL_CLAMP_TO_EDGE;
+        gridTextures.clear();
+        for (int i = 0; i < 3; ++i) {
+            gridTextures.push_back(TextureManager->createEmptyTexture(
+                    textureSize.x, textureSize.y, textureSize.z, settings));
+        }
+        gridTextureSize = textureSize;
+        // RGBA16F
+        textureMemory.set(gridTextures.size() * size_t(textureSize.x) * size_t(textureSize.y)
+                * size_t(textureSize.z) * 8);
+    }
+
+    // The guidance axis varies slowest, so stacking the grids is a concatenation
+    size_t rowSize = size_t(gridSize.x) * size_t(gridSize.y) * size_t(gridSize.z) * 4;
+    stackedCoefficients.resize(rowSize * numViews);
+    for (int row = 0; row < 3; ++row) {
+        for (int view = 0; view < numViews; ++view) {
+            const float *rowData = activeFilters.at(view)->grid.getRow(row);
+            std::copy(rowData, rowData + rowSize, stackedCoefficients.begin() + view * rowSize);
+        }
+        gridTextures[row]->uploadPixelData(
+                textureSize.x, textureSize.y, textureSize.z, &stackedCoefficients.front(),
+                PixelFormat(GL_RGBA, GL_FLOAT));
+    }
+    gridsValid = true;
+}
+
+size_t ComparisonRenderer::reclaimMemory(size_t bytesNeeded) {
+    size_t usageBefore = MemoryAccounting::get()->getTotalUsage();
+    int numReleasedFilters = 0;
+    for (std::map<std::string, FilterPtr>::iterator it = loadedFilters.begin(); it != loadedFilters.end(); ) {
+        if (std::find(activeFilters.begin(), activeFilters.end(), it->second) != activeFilters.end()) {
+            ++it;
+            continue;
+        }
+        Logfile::get()->writeInfo(
+                "INFO in ComparisonRenderer::reclaimMemory: Releasing idle filter \"" + it->first + "\".");
+        it = loadedFilters.erase(it);
+        numReleasedFilters++;
+    }
+    if (numReleasedFilters == 0) {
+        return 0;
+    }
+    size_t usageAfter = MemoryAccounting::get()->getTotalUsage();
+    return usageBefore > usageAfter ? usageBefore - usageAfter : 0;
+}
+
+std::string ComparisonRenderer::getReclaimerName() const {
+    return "idle comparison filters (" + std::to_string(loadedFilters.size() - activeFilters.size()) + ")";
+}
+
+void ComparisonRenderer::updateGuideUniforms() {
+    glm::vec4 ccmColumns[MAX_VIEWS * 3];
+    glm::vec3 shifts[MAX_VIEWS * NUM_GUIDE_SEGMENTS];
+    glm::vec3 slopes[MAX_VIEWS * NUM_GUIDE_SEGMENTS];
+    glm::vec4 mixMatrices[MAX_VIEWS];
+    for (size_t view = 0; view < activeFilters.size(); view++) {
+        const GuideParameters& guide = activeFilters.at(view)->guide;
+        for (int column = 0; column < 3; column++) {
+            ccmColumns[view*3 + column] = guide.ccm[column];
+        }
+        for (int i = 0; i < NUM_GUIDE_SEGMENTS; i++) {
+            shifts[view*NUM_GUIDE_SEGMENTS + i] = guide.shifts[i];
+            slopes[view*NUM_GUIDE_SEGMENTS + i] = guide.slopes[i];
+        }
+        mixMatrices[view] = guide.mixMatrix;
+    }
+
+    comparisonShader->setUniformArray("guideCCM", ccmColumns, MAX_VIEWS * 3);
+    comparisonShader->setUniformArray("guideShifts", shifts, MAX_VIEWS * NUM_GUIDE_SEGMENTS);
+    comparisonShader->setUniformArray("guideSlopes", slopes, MAX_VIEWS * NUM_GUIDE_SEGMENTS);
+    comparisonShader->setUniformArray("mixMatrix", mixMatrices, MAX_VIEWS);
+    comparisonShader->setUniform("numViews", int(activeFilters.size()));
+    comparisonShader->setUniform("tileLayout", getTileLayout());
+}
+
+glm::ivec2 ComparisonRenderer::getTileLayout() {
+    // Two views side by side (split view), otherwise a 2x2 grid
+    return activeFilters.size() <= 2 ? glm::ivec2(std::max(int(activeFilters.size()), 1), 1) : glm::ivec2(2, 2);
+}
+
+void ComparisonRenderer::render(sgl::TexturePtr& imageTexture) {
+    if (!gridsValid) {
+        return;
+    }
+    TRACE_SCOPE("ComparisonRenderer::render");
+    comparisonShader->setUniform("image", imageTexture, 0);
+    comparisonShader->setUniform("affineGridRow0", gridTextures[0], 1);
+    comparisonShader->setUniform("affineGridRow1", gridTextures[1], 2);
+    comparisonShader->setUniform("affineGridRow2", gridTextures[2], 3);
+    comparisonShader->setUniform("gridDepth", float(gridTextureSize.z / getNumViews()));
+
+    glm::ivec2 tileLayout = getTileLayout();
+    float imageRatio = float(imageTexture->getW() * tileLayout.x) / float(imageTexture->getH() * tileLayout.y);
+    GridRenderer::renderQuad(comparisonShader, GridRenderer::createTexturedQuad(getRenderRect(imageRatio)));
+}
+
+AABB2 ComparisonRenderer::getViewRect(sgl::TexturePtr& imageTexture, int viewIndex) {
+    glm::ivec2 tileLayout = getTileLayout();
+    float imageRatio = float(imageTexture->getW() * tileLayout.x) / float(imageTexture->getH() * tileLayout.y);
+    AABB2 renderRect = getRenderRect(imageRatio);
+
+    // Normalized device coordinates -> window coordinates
+    Window *window = AppSettings::get()->getMainWindow();
+    glm::vec2 windowSize(window->getWidth(), window->getHeight());
+    glm::vec2 topLeft = (glm::vec2(renderRect.min.x, -renderRect.max.y) * 0.5f + 0.5f) * windowSize;
+    glm::vec2 bottomRight = (glm::vec2(renderRect.max.x, -renderRect.min.y) * 0.5f + 0.5f) * windowSize;
+    glm::vec2 viewSize = (bottomRight - topLeft) / glm::vec2(tileLayout);
+
+    AABB2 viewRect;
+    viewRect.min = topLeft + glm::vec2(viewIndex % tileLayout.x, viewIndex / tileLayout.x) * viewSize;
+    viewRect.max = viewRect.min + viewSize;
+    return viewRect;
+}
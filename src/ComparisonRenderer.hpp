@@ -0,0 +1,107 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPARISONRENDERER_HPP_
+#define COMPARISONRENDERER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <Math/Geometry/AABB2.hpp>
+#include <Graphics/Shader/ShaderManager.hpp>
+#include <Graphics/Texture/TextureManager.hpp>
+#include "GridPredictor.hpp"
+#include "GuideParameters.hpp"
+#include "MemoryAccounting.hpp"
+
+/**
+ * Applies multiple filters to the same frame to compare them side by side (two filters) or in a 2x2 grid.
+ * The predictors of all filters run concurrently, and all views are sliced in a single draw call.
+ * Filters stay loaded when they are deselected, so switching between them doesn't reload the models. These idle
+ * models are released when the memory budget is exceeded (this class isn't thread-safe, see MemoryReclaimer).
+ */
+class ComparisonRenderer : public MemoryReclaimer {
+public:
+    static const int MAX_VIEWS = 4;
+
+    ComparisonRenderer();
+    ~ComparisonRenderer();
+    //! \param filterPaths: Model directories of the filters to show (at most MAX_VIEWS).
+    void setFilters(const std::vector<std::string>& filterPaths);
+    //! Predicts the grids of all filters for lowresImage (in parallel) and uploads them.
+    bool predictGrids(FrameDataPtr& lowresImage);
+    //! Renders the views of imageTexture with the grids of the last call to predictGrids.
+    void render(sgl::TexturePtr& imageTexture);
+
+    //! \return The number of views (filters that couldn't be loaded are skipped, i.e., the views are compacted).
+    int getNumViews() { return int(activeFilters.size()); }
+    //! \return The model directory of the filter shown in the view.
+    const std::string& getFilterPath(int viewIndex) { return activeFilters.at(viewIndex)->path; }
+    //! \return The time the last prediction of the filter shown in the view took.
+    float getInferenceTimeMs(int viewIndex) { return activeFilters.at(viewIndex)->inferenceTimeMs; }
+    //! \return The area of a view in window coordinates (origin at the top left, e.g. for labels).
+    sgl::AABB2 getViewRect(sgl::TexturePtr& imageTexture, int viewIndex);
+
+    // MemoryReclaimer (releases the loaded filters that aren't shown)
+    virtual size_t reclaimMemory(size_t bytesNeeded);
+    virtual std::string getReclaimerName() const;
+
+private:
+    struct Filter {
+        std::string path;
+        GridPredictor gridPredictor;
+        GuideParameters guide;
+        GridCoefficients grid;
+        float inferenceTimeMs;
+        bool valid;
+    };
+    typedef boost::shared_ptr<Filter> FilterPtr;
+
+    //! \return Columns and rows of the views
+    glm::ivec2 getTileLayout();
+    void uploadGrids();
+    void updateGuideUniforms();
+
+    std::map<std::string, FilterPtr> loadedFilters;
+    std::vector<FilterPtr> activeFilters;
+
+    sgl::ShaderProgramPtr comparisonShader;
+    // Grids of all views stacked along the guidance axis
+    std::vector<sgl::TexturePtr> gridTextures;
+    glm::ivec3 gridTextureSize;
+    std::vector<float> stackedCoefficients;
+    bool gridsValid;
+    TrackedMemory textureMemory;
+};
+
+#endif /* COMPARISONRENDERER_HPP_ */
@@ -0,0 +1,175 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include "Tracer.hpp"
+#include "PerfCounters.hpp"
+#include "CpuSlicer.hpp"
+
+CpuSlicer::CpuSlicer(int numThreads) {
+    setNumThreads(numThreads);
+}
+
+void CpuSlicer::setNumThreads(int numThreads) {
+    if (numThreads <= 0) {
+        numThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+    }
+    this->numThreads = numThreads;
+}
+
+/**
+ * Trilinear interpolation with the same conventions as texture() for a GL_LINEAR 3D texture
+ * with GL_CLAMP_TO_EDGE wrapping (texel centers at (i + 0.5) / size).
+ * The texel offsets and weights are computed once and shared by the three rows of the transform.
+ */
+struct TrilinearSample {
+    inline TrilinearSample(const glm::ivec3& size, const glm::vec3& coords) {
+        int i0[3], i1[3];
+        float w[3];
+        const int sizes[3] = { size.x, size.y, size.z };
+        for (int d = 0; d < 3; d++) {
+            float texelCoord = coords[d] * sizes[d] - 0.5f;
+            float texelFloor = std::floor(texelCoord);
+            w[d] = texelCoord - texelFloor;
+            int index = int(texelFloor);
+            i0[d] = std::min(std::max(index, 0), sizes[d] - 1);
+            i1[d] = std::min(std::max(index + 1, 0), sizes[d] - 1);
+        }
+        for (int corner = 0; corner < 8; corner++) {
+            int x = (corner & 1) ? i1[0] : i0[0];
+            int y = (corner & 2) ? i1[1] : i0[1];
+            int z = (corner & 4) ? i1[2] : i0[2];
+            offsets[corner] = ((z*size.y + y)*size.x + x)*4;
+            weights[corner] = ((corner & 1) ? w[0] : 1.0f - w[0])
+                    * ((corner & 2) ? w[1] : 1.0f - w[1])
+                    * ((corner & 4) ? w[2] : 1.0f - w[2]);
+        }
+    }
+
+    inline glm::vec4 sample(const float *grid) const {
+        glm::vec4 result(0.0f);
+        for (int corner = 0; corner < 8; corner++) {
+            const float *texel = grid + offsets[corner];
+            result += weights[corner] * glm::vec4(texel[0], texel[1], texel[2], texel[3]);
+        }
+        return result;
+    }
+
+    int offsets[8];
+    float weights[8];
+};
+
+/**
+ * Slices the pixels in [x0, x1) x [y0, y1). readColor(x, y) returns the normalized RGB input color,
+ * so the same kernel is used for RGBA and YUV input frames.
+ */
+template<typename ColorReader>
+static void sliceRegionKernel(
+        const ColorReader& readColor, const GuideParameters& guide, const GridCoefficients& grid,
+        FrameData& output, int x0, int y0, int x1, int y1) {
+    const float *rows[3] = { grid.getRow(0), grid.getRow(1), grid.getRow(2) };
+    for (int y = y0; y < y1; y++) {
+        float t = (y + 0.5f) / float(output.h);
+        for (int x = x0; x < x1; x++) {
+            float s = (x + 0.5f) / float(output.w);
+            glm::vec4 imageColor(readColor(x, y), 1.0f);
+
+            // 1. Compute guidance map value
+            float guidanceValue = guide.computeGuidance(imageColor);
+
+            // 2. Compute sliced coefficients & 3. apply them
+            TrilinearSample gridSample(grid.gridSize, glm::vec3(s, t, guidanceValue));
+            uint8_t *outputPixel = output.pixels + (y*output.w + x)*4;
+            for (int c = 0; c < 3; c++) {
+                float value = glm::dot(gridSample.sample(rows[c]), imageColor);
+                outputPixel[c] = uint8_t(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            outputPixel[3] = 255;
+        }
+    }
+}
+
+template<typename RowFunction>
+void CpuSlicer::forEachRowBlock(int height, const RowFunction& processRows) const {
+    int numRowThreads = std::min(numThreads, height);
+    if (numRowThreads <= 1) {
+        processRows(0, height);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numRowThreads; i++) {
+        int y0 = height * i / numRowThreads;
+        int y1 = height * (i + 1) / numRowThreads;
+        threads.push_back(std::thread([&processRows, y0, y1]() {
+            processRows(y0, y1);
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void CpuSlicer::slice(const FrameData& input, const GridCoefficients& grid, FrameData& output) const {
+    TRACE_SCOPE("CpuSlicer::slice");
+    output.allocate(input.w, input.h);
+    forEachRowBlock(input.h, [this, &input, &grid, &output](int y0, int y1) {
+        sliceRegion(input, grid, output, 0, y0, input.w, y1);
+    });
+}
+
+void CpuSlicer::sliceRegion(
+        const FrameData& input, const GridCoefficients& grid, FrameData& output,
+        int x0, int y0, int x1, int y1) const {
+    // Counted per thread, so the calls of all slicing threads add up to the whole image
+    PERF_SCOPE("CpuSlicer::sliceRegion", uint64_t(x1 - x0) * uint64_t(y1 - y0));
+    auto readColor = [&input](int x, int y) {
+        const uint8_t *inputPixel = input.pixels + (y*input.w + x)*4;
+        return glm::vec3(inputPixel[0] / 255.0f, inputPixel[1] / 255.0f, inputPixel[2] / 255.0f);
+    };
+    sliceRegionKernel(readColor, guide, grid, output, x0, y0, x1, y1);
+}
+
+void CpuSlicer::sliceYuv(const YuvFrame& input, const GridCoefficients& grid, FrameData& output) const {
+    TRACE_SCOPE("CpuSlicer::sliceYuv");
+    output.allocate(input.w, input.h);
+    auto readColor = [&input](int x, int y) {
+        return input.getColor(x, y);
+    };
+    forEachRowBlock(input.h, [this, &readColor, &grid, &output](int y0, int y1) {
+        PERF_SCOPE("CpuSlicer::sliceYuv", uint64_t(output.w) * uint64_t(y1 - y0));
+        sliceRegionKernel(readColor, guide, grid, output, 0, y0, output.w, y1);
+    });
+}
@@ -0,0 +1,73 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CPUSLICER_HPP_
+#define CPUSLICER_HPP_
+
+#include "FrameData.hpp"
+#include "GridCoefficients.hpp"
+#include "GuideParameters.hpp"
+#include "YuvFrame.hpp"
+
+/**
+ * CPU implementation of ApplyCoefficients.glsl for use without an OpenGL context.
+ * For every pixel, the guidance value is computed, the affine transform is trilinearly interpolated
+ * from the grid (clamped to the edges like the grid textures) and applied to the pixel color.
+ */
+class CpuSlicer {
+public:
+    //! \param numThreads: Number of threads used by slice (0 = number of hardware threads).
+    explicit CpuSlicer(int numThreads = 0);
+    void setGuideParameters(const GuideParameters& guide) { this->guide = guide; }
+    const GuideParameters& getGuideParameters() const { return guide; }
+    void setNumThreads(int numThreads);
+    int getNumThreads() const { return numThreads; }
+
+    //! Applies the grid to the 32-bit RGBA image input. Output is (re-)allocated to the size of input.
+    void slice(const FrameData& input, const GridCoefficients& grid, FrameData& output) const;
+    //! Only processes the pixels in [x0, x1) x [y0, y1). Output must already have the size of input.
+    void sliceRegion(
+            const FrameData& input, const GridCoefficients& grid, FrameData& output,
+            int x0, int y0, int x1, int y1) const;
+    //! Applies the grid to a YUYV or NV12 camera frame (converted to RGB per pixel, no full RGBA copy needed).
+    void sliceYuv(const YuvFrame& input, const GridCoefficients& grid, FrameData& output) const;
+
+private:
+    //! Calls processRows(y0, y1) for numThreads blocks of rows of an image with the passed height
+    template<typename RowFunction>
+    void forEachRowBlock(int height, const RowFunction& processRows) const;
+
+    GuideParameters guide;
+    int numThreads;
+};
+
+#endif /* CPUSLICER_HPP_ */
@@ -0,0 +1,110 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ENHANCEMENTPROTOCOL_HPP_
+#define ENHANCEMENTPROTOCOL_HPP_
+
+/**
+ * Wire format of the local enhancement service (see EnhancementServer).
+ * A client connects to the Unix domain socket and sends any number of requests on the connection.
+ * Every request is a EnhancementRequestHeader followed by width * height 32-bit RGBA pixels, every
+ * response a EnhancementResponseHeader followed by the enhanced pixels (if status is ENHANCEMENT_OK).
+ * All values are in host byte order, as client and server always run on the same machine.
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <cerrno>
+#include <unistd.h>
+
+const uint32_t ENHANCEMENT_REQUEST_MAGIC = 0x51524448; // "HDRQ"
+const uint32_t ENHANCEMENT_RESPONSE_MAGIC = 0x52524448; // "HDRR"
+//! Requests with more pixels are rejected
+const uint32_t ENHANCEMENT_MAX_PIXELS = 8192u * 8192u;
+
+enum EnhancementPixelFormat {
+    ENHANCEMENT_FORMAT_RGBA8 = 0
+};
+
+enum EnhancementStatus {
+    ENHANCEMENT_OK = 0, ENHANCEMENT_INVALID_REQUEST = 1, ENHANCEMENT_INFERENCE_FAILED = 2
+};
+
+struct EnhancementRequestHeader {
+    uint32_t magic;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+};
+
+struct EnhancementResponseHeader {
+    uint32_t magic;
+    uint32_t status;
+    uint32_t width;
+    uint32_t height;
+};
+
+//! \return false if the connection was closed or an error occurred
+inline bool readFully(int fd, void *data, size_t size) {
+    uint8_t *bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t numRead = read(fd, bytes, size);
+        if (numRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numRead <= 0) {
+            return false;
+        }
+        bytes += numRead;
+        size -= size_t(numRead);
+    }
+    return true;
+}
+
+//! \return false if the connection was closed or an error occurred
+inline bool writeFully(int fd, const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t numWritten = write(fd, bytes, size);
+        if (numWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numWritten <= 0) {
+            return false;
+        }
+        bytes += numWritten;
+        size -= size_t(numWritten);
+    }
+    return true;
+}
+
+#endif /* ENHANCEMENTPROTOCOL_HPP_ */
@@ -0,0 +1,372 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "EnhancementProtocol.hpp"
+#include "Tracer.hpp"
+#include "EnhancementServer.hpp"
+
+using namespace sgl;
+
+// Downscaled image width/heigth (input size of the network)
+const int DSC_IMG_SIZE = 256;
+// Number of latest requests the percentiles are computed from
+const size_t MAX_LATENCY_SAMPLES = 100000;
+
+static uint64_t getTimeMicroseconds() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+EnhancementServer::EnhancementServer(const EnhancementServerSettings& settings)
+        : settings(settings), running(false), serverSocket(-1), cpuSlicer(settings.slicingThreads),
+          numRequests(0), numFailedRequests(0), nextSampleIndex(0) {
+}
+
+EnhancementServer::~EnhancementServer() {
+    if (serverSocket >= 0) {
+        close(serverSocket);
+        unlink(settings.socketPath.c_str());
+    }
+}
+
+bool EnhancementServer::start() {
+    // Clients closing their connection early mustn't terminate the server
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!gridPredictor.loadGraph(settings.modelPath)) {
+        return false;
+    }
+    GuideParameters guide;
+    if (!guide.load(settings.modelPath)) {
+        return false;
+    }
+    cpuSlicer.setGuideParameters(guide);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (settings.socketPath.size() >= sizeof(address.sun_path)) {
+        Logfile::get()->writeError("ERROR in EnhancementServer::start: Socket path is too long.");
+        return false;
+    }
+    strncpy(address.sun_path, settings.socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverSocket < 0) {
+        Logfile::get()->writeError(std::string() + "ERROR in EnhancementServer::start: " + strerror(errno));
+        return false;
+    }
+    unlink(settings.socketPath.c_str());
+    if (bind(serverSocket, (sockaddr*)&address, sizeof(address)) < 0 || listen(serverSocket, 64) < 0) {
+        Logfile::get()->writeError(std::string() + "ERROR in EnhancementServer::start: " + strerror(errno));
+        close(serverSocket);
+        serverSocket = -1;
+        return false;
+    }
+
+    Logfile::get()->writeInfo(std::string() + "Enhancement server listening on " + settings.socketPath);
+    running = true;
+    return true;
+}
+
+void EnhancementServer::run() {
+    inferenceThread = std::thread(&EnhancementServer::inferenceLoop, this);
+    acceptLoop();
+
+    // Wake up all threads blocked on a connection or on the queue
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(clientMutex);
+        for (int clientSocket : clientSockets) {
+            shutdown(clientSocket, SHUT_RDWR);
+        }
+        threads.swap(clientThreads);
+    }
+    queueConditionVariable.notify_all();
+    jobDoneConditionVariable.notify_all();
+    inferenceThread.join();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Logfile::get()->writeInfo(getMetricsReport());
+}
+
+void EnhancementServer::acceptLoop() {
+    while (running) {
+        // Join the threads of closed connections
+        {
+            std::lock_guard<std::mutex> lock(clientMutex);
+            for (size_t i = 0; i < clientThreads.size(); ) {
+                std::vector<std::thread::id>::iterator it = std::find(
+                        finishedClientThreads.begin(), finishedClientThreads.end(), clientThreads.at(i).get_id());
+                if (it != finishedClientThreads.end()) {
+                    finishedClientThreads.erase(it);
+                    clientThreads.at(i).join();
+                    clientThreads.erase(clientThreads.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+        }
+
+        // Use a timeout so that stop() is noticed
+        pollfd pollData;
+        pollData.fd = serverSocket;
+        pollData.events = POLLIN;
+        pollData.revents = 0;
+        if (poll(&pollData, 1, 200) <= 0) {
+            continue;
+        }
+
+        int clientSocket = accept(serverSocket, NULL, NULL);
+        if (clientSocket < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(clientMutex);
+        clientSockets.insert(clientSocket);
+        clientThreads.push_back(std::thread(&EnhancementServer::handleClient, this, clientSocket));
+    }
+}
+
+void EnhancementServer::handleClient(int clientSocket) {
+    Tracer::setThreadName("client");
+    FrameDataPtr image(new FrameData);
+    FrameDataPtr output(new FrameData);
+    EnhancementRequestHeader request;
+
+    while (running && readFully(clientSocket, &request, sizeof(request))) {
+        TRACE_SCOPE("EnhancementServer::handleRequest");
+        uint64_t startTime = getTimeMicroseconds();
+
+        EnhancementResponseHeader response;
+        response.magic = ENHANCEMENT_RESPONSE_MAGIC;
+        response.status = ENHANCEMENT_OK;
+        response.width = request.width;
+        response.height = request.height;
+
+        if (request.magic != ENHANCEMENT_REQUEST_MAGIC || request.format != ENHANCEMENT_FORMAT_RGBA8
+                || request.width == 0 || request.height == 0
+                || uint64_t(request.width) * uint64_t(request.height) > ENHANCEMENT_MAX_PIXELS) {
+            // The stream can't be resynchronized after an invalid header
+            response.status = ENHANCEMENT_INVALID_REQUEST;
+            writeFully(clientSocket, &response, sizeof(response));
+            break;
+        }
+
+        image->allocate(int(request.width), int(request.height));
+        if (!readFully(clientSocket, image->pixels, size_t(image->w) * size_t(image->h) * 4)) {
+            break;
+        }
+
+        FrameDataPtr lowresImage(new FrameData(DSC_IMG_SIZE, DSC_IMG_SIZE));
+        cv::Mat imageMat(image->h, image->w, CV_8UC4, image->pixels);
+        cv::Mat lowresMat(DSC_IMG_SIZE, DSC_IMG_SIZE, CV_8UC4, lowresImage->pixels);
+        cv::resize(imageMat, lowresMat, cv::Size(DSC_IMG_SIZE, DSC_IMG_SIZE), 0, 0, cv::INTER_AREA);
+
+        uint64_t queueTimeUs = 0;
+        int batchSize = 0;
+        GridCoefficientsPtr grid = predictGrid(lowresImage, queueTimeUs, batchSize);
+        if (!grid) {
+            response.status = ENHANCEMENT_INFERENCE_FAILED;
+            {
+                std::lock_guard<std::mutex> lock(metricsMutex);
+                numFailedRequests++;
+            }
+            if (!writeFully(clientSocket, &response, sizeof(response))) {
+                break;
+            }
+            continue;
+        }
+
+        cpuSlicer.slice(*image, *grid, *output);
+        if (!writeFully(clientSocket, &response, sizeof(response))
+                || !writeFully(clientSocket, output->pixels, size_t(output->w) * size_t(output->h) * 4)) {
+            break;
+        }
+        recordRequest(queueTimeUs, getTimeMicroseconds() - startTime);
+    }
+
+    // Erased before closing: Once closed, the fd number can be reused (e.g. by accept), and run would shut it down
+    {
+        std::lock_guard<std::mutex> lock(clientMutex);
+        clientSockets.erase(clientSocket);
+        finishedClientThreads.push_back(std::this_thread::get_id());
+    }
+    close(clientSocket);
+}
+
+GridCoefficientsPtr EnhancementServer::predictGrid(
+        const FrameDataPtr& lowresImage, uint64_t& queueTimeUs, int& batchSize) {
+    TRACE_SCOPE("EnhancementServer::waitForGrid");
+    InferenceJobPtr job(new InferenceJob);
+    job->lowresImage = lowresImage;
+    job->enqueueTimeUs = getTimeMicroseconds();
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    jobQueue.push_back(job);
+    queueConditionVariable.notify_one();
+    while (!job->done && running) {
+        jobDoneConditionVariable.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    queueTimeUs = job->queueTimeUs;
+    batchSize = job->batchSize;
+    return job->grid;
+}
+
+void EnhancementServer::inferenceLoop() {
+    Tracer::setThreadName("inference");
+    uint64_t lastReportTime = getTimeMicroseconds();
+
+    while (running) {
+        std::vector<InferenceJobPtr> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueConditionVariable.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                return !jobQueue.empty() || !running;
+            });
+            if (jobQueue.empty()) {
+                continue;
+            }
+
+            // Wait for more requests until the batch is full or the oldest request waited for batchWindowUs
+            std::chrono::steady_clock::time_point deadline(std::chrono::microseconds(
+                    jobQueue.front()->enqueueTimeUs + uint64_t(settings.batchWindowUs)));
+            while (int(jobQueue.size()) < settings.maxBatchSize && running) {
+                if (queueConditionVariable.wait_until(lock, deadline) == std::cv_status::timeout) {
+                    break;
+                }
+            }
+
+            size_t batchSize = std::min(jobQueue.size(), size_t(std::max(settings.maxBatchSize, 1)));
+            batch.assign(jobQueue.begin(), jobQueue.begin() + batchSize);
+            jobQueue.erase(jobQueue.begin(), jobQueue.begin() + batchSize);
+        }
+
+        uint64_t batchStartTime = getTimeMicroseconds();
+        std::vector<FrameDataPtr> lowresImages;
+        for (InferenceJobPtr& job : batch) {
+            lowresImages.push_back(job->lowresImage);
+        }
+        std::vector<GridCoefficientsPtr> grids;
+        bool success = gridPredictor.computeGridCoefficientsBatch(lowresImages, grids);
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (size_t i = 0; i < batch.size(); i++) {
+                InferenceJobPtr& job = batch.at(i);
+                job->grid = success ? grids.at(i) : GridCoefficientsPtr();
+                job->queueTimeUs = batchStartTime - job->enqueueTimeUs;
+                job->batchSize = int(batch.size());
+                job->done = true;
+            }
+        }
+        jobDoneConditionVariable.notify_all();
+        recordBatch(int(batch.size()));
+
+        if (settings.reportIntervalS > 0
+                && getTimeMicroseconds() - lastReportTime > uint64_t(settings.reportIntervalS) * 1000000ull) {
+            Logfile::get()->writeInfo(getMetricsReport());
+            lastReportTime = getTimeMicroseconds();
+        }
+    }
+}
+
+void EnhancementServer::recordRequest(uint64_t queueTimeUs, uint64_t latencyUs) {
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    numRequests++;
+    if (latenciesUs.size() < MAX_LATENCY_SAMPLES) {
+        queueTimesUs.push_back(queueTimeUs);
+        latenciesUs.push_back(latencyUs);
+    } else {
+        queueTimesUs.at(nextSampleIndex) = queueTimeUs;
+        latenciesUs.at(nextSampleIndex) = latencyUs;
+        nextSampleIndex = (nextSampleIndex + 1) % MAX_LATENCY_SAMPLES;
+    }
+}
+
+void EnhancementServer::recordBatch(int batchSize) {
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    batchSizeHistogram[batchSize]++;
+}
+
+//! \param values: Sorted values. \return The p-th percentile in milliseconds.
+static double percentileMs(const std::vector<uint64_t>& values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t index = std::min(values.size() - 1, size_t(p * double(values.size())));
+    return values.at(index) / 1000.0;
+}
+
+std::string EnhancementServer::getMetricsReport() {
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    std::vector<uint64_t> sortedQueueTimes = queueTimesUs;
+    std::vector<uint64_t> sortedLatencies = latenciesUs;
+    std::sort(sortedQueueTimes.begin(), sortedQueueTimes.end());
+    std::sort(sortedLatencies.begin(), sortedLatencies.end());
+
+    uint64_t numBatches = 0;
+    for (const std::pair<const int, uint64_t>& entry : batchSizeHistogram) {
+        numBatches += entry.second;
+    }
+
+    std::stringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << "Enhancement server: " << numRequests << " requests (" << numFailedRequests << " failed), "
+           << numBatches << " batches" << std::endl;
+    report << "Queue time (ms): p50 " << percentileMs(sortedQueueTimes, 0.5)
+           << ", p99 " << percentileMs(sortedQueueTimes, 0.99)
+           << ", max " << percentileMs(sortedQueueTimes, 1.0) << std::endl;
+    report << "Latency (ms): p50 " << percentileMs(sortedLatencies, 0.5)
+           << ", p99 " << percentileMs(sortedLatencies, 0.99)
+           << ", max " << percentileMs(sortedLatencies, 1.0) << std::endl;
+    report << "Batch sizes:";
+    for (const std::pair<const int, uint64_t>& entry : batchSizeHistogram) {
+        report << " " << entry.first << ": " << entry.second
+               << " (" << (100.0 * double(entry.second) / double(numBatches)) << "%)";
+    }
+    return report.str();
+}
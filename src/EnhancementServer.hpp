@@ -0,0 +1,130 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ENHANCEMENTSERVER_HPP_
+#define ENHANCEMENTSERVER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <boost/shared_ptr.hpp>
+#include "GridPredictor.hpp"
+#include "CpuSlicer.hpp"
+
+struct EnhancementServerSettings {
+    EnhancementServerSettings() : maxBatchSize(8), batchWindowUs(2000), slicingThreads(1), reportIntervalS(10) {}
+    std::string socketPath;
+    //! Path to folder containing effect data
+    std::string modelPath;
+    //! Maximum number of requests sharing one inference call
+    int maxBatchSize;
+    //! Maximum time the oldest queued request waits for further requests to join its batch
+    int batchWindowUs;
+    //! Threads used for slicing one request (requests of different clients are sliced concurrently)
+    int slicingThreads;
+    //! Interval in which the metrics are written to the log (0 = only on shutdown)
+    int reportIntervalS;
+};
+
+/**
+ * Keeps a model loaded and enhances images sent by other processes over a Unix domain socket
+ * (see EnhancementProtocol.hpp). Each connection is served by its own thread, which downscales the
+ * image and queues it for inference. A single inference thread collects queued requests into batches
+ * for up to batchWindowUs and predicts all of their grids in one call. The connection threads then
+ * slice the full resolution images on the CPU concurrently.
+ */
+class EnhancementServer {
+public:
+    explicit EnhancementServer(const EnhancementServerSettings& settings);
+    ~EnhancementServer();
+    //! Loads the model and starts listening on the socket.
+    bool start();
+    //! Serves requests until stop is called (e.g., from a signal handler).
+    void run();
+    //! Can be called from any thread or from a signal handler.
+    void stop() { running = false; }
+    //! \return Queue time, batch size distribution and latency percentiles.
+    std::string getMetricsReport();
+
+private:
+    struct InferenceJob {
+        InferenceJob() : enqueueTimeUs(0), queueTimeUs(0), batchSize(0), done(false) {}
+        FrameDataPtr lowresImage;
+        GridCoefficientsPtr grid;
+        uint64_t enqueueTimeUs, queueTimeUs;
+        int batchSize;
+        bool done;
+    };
+    typedef boost::shared_ptr<InferenceJob> InferenceJobPtr;
+
+    void acceptLoop();
+    void inferenceLoop();
+    void handleClient(int clientSocket);
+    //! Blocks until the grid of lowresImage was predicted. \return nullptr if inference failed.
+    GridCoefficientsPtr predictGrid(const FrameDataPtr& lowresImage, uint64_t& queueTimeUs, int& batchSize);
+    void recordRequest(uint64_t queueTimeUs, uint64_t latencyUs);
+    void recordBatch(int batchSize);
+
+    EnhancementServerSettings settings;
+    std::atomic<bool> running;
+    int serverSocket;
+    GridPredictor gridPredictor;
+    CpuSlicer cpuSlicer;
+
+    // Client connections
+    std::mutex clientMutex;
+    std::set<int> clientSockets;
+    std::vector<std::thread> clientThreads;
+    std::vector<std::thread::id> finishedClientThreads;
+
+    // Inference queue
+    std::mutex queueMutex;
+    std::condition_variable queueConditionVariable;
+    std::condition_variable jobDoneConditionVariable;
+    std::deque<InferenceJobPtr> jobQueue;
+    std::thread inferenceThread;
+
+    // Metrics (the latest MAX_LATENCY_SAMPLES requests are used for the percentiles)
+    std::mutex metricsMutex;
+    uint64_t numRequests, numFailedRequests;
+    std::vector<uint64_t> queueTimesUs, latenciesUs;
+    size_t nextSampleIndex;
+    std::map<int, uint64_t> batchSizeHistogram;
+};
+
+#endif /* ENHANCEMENTSERVER_HPP_ */
@@ -0,0 +1,74 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstddef>
+#include "MemoryAccounting.hpp"
+#include "FrameData.hpp"
+
+FrameData::FrameData() : pixels(NULL), w(0), h(0), ownsPixels(true) {
+}
+
+FrameData::FrameData(int w, int h) : pixels(NULL), w(0), h(0), ownsPixels(true) {
+    allocate(w, h);
+}
+
+FrameData::~FrameData() {
+    release();
+}
+
+void FrameData::release() {
+    if (pixels && ownsPixels) {
+        delete[] pixels;
+        MemoryAccounting::get()->release(MEMORY_FRAMES, size_t(w)*size_t(h)*4);
+    }
+    pixels = NULL;
+}
+
+void FrameData::allocate(int w, int h) {
+    if (pixels && ownsPixels && this->w == w && this->h == h) {
+        return;
+    }
+    release();
+    pixels = new uint8_t[size_t(w)*size_t(h)*4];
+    MemoryAccounting::get()->allocate(MEMORY_FRAMES, size_t(w)*size_t(h)*4);
+    ownsPixels = true;
+    this->w = w;
+    this->h = h;
+}
+
+void FrameData::wrap(uint8_t *externalPixels, int w, int h) {
+    release();
+    pixels = externalPixels;
+    ownsPixels = false;
+    this->w = w;
+    this->h = h;
+}
@@ -36,12 +36,27 @@
 #include <cstdint>
 #include <boost/shared_ptr.hpp>
 
+//! Pixel layouts of frames exchanged with other processes or delivered by cameras (YUV: see YuvFrame)
+enum FrameFormat {
+    FRAME_FORMAT_RGBA8 = 0, FRAME_FORMAT_BGR8 = 1, FRAME_FORMAT_YUYV = 2, FRAME_FORMAT_NV12 = 3
+};
+
+//! 32-bit RGBA image
 struct FrameData {
 public:
     FrameData();
+    FrameData(int w, int h);
     ~FrameData();
+    //! (Re-)allocates the pixel data if the size differs from the current one.
+    void allocate(int w, int h);
+    //! Uses pixel data owned by someone else (e.g., shared memory) without copying it.
+    void wrap(uint8_t *externalPixels, int w, int h);
     uint8_t *pixels;
     int w, h;
+
+private:
+    void release();
+    bool ownsPixels;
 };
 
 typedef boost::shared_ptr<FrameData> FrameDataPtr;
@@ -0,0 +1,75 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FRAMESOURCE_HPP_
+#define FRAMESOURCE_HPP_
+
+#include <chrono>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+#include "YuvFrame.hpp"
+
+//! Source of the frames displayed by the viewer (e.g., a camera or frames shared by another process)
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+    /*!
+     * frameImage may afterwards reference memory of the source (see FrameData::wrap). It stays valid until
+     * releaseFrame or the next call to readFrame.
+     * \return Returns false if no new frame is available
+     */
+    virtual bool readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage)=0;
+    //! \return Whether readYuvFrame can currently deliver frames in their native YUV layout.
+    virtual bool supportsYuv() { return false; }
+    /*!
+     * Reads the next frame without converting it to RGBA. downscaledImage is still the RGBA network input.
+     * \return Returns false if no new frame is available or the source doesn't deliver YUV frames.
+     */
+    virtual bool readYuvFrame(YuvFramePtr yuvFrame, FrameDataPtr downscaledImage) { return false; }
+    //! Called when the viewer doesn't use the data of the last frame anymore.
+    virtual void releaseFrame() {}
+    //! \return The resolution of the frames.
+    virtual glm::ivec2 getResolution()=0;
+    //! Requests a new resolution. \return The resolution the source actually uses.
+    virtual glm::ivec2 setResolution(const glm::ivec2& resolution) { return getResolution(); }
+    //! \return Time spent converting and downscaling the last frame (excluding waiting for the frame)
+    virtual float getLastConversionTimeMs()=0;
+    //! \return The capture time of the last frame in nanoseconds (by default, the time it was read).
+    virtual uint64_t getLastTimestampNs() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+};
+
+typedef boost::shared_ptr<FrameSource> FrameSourcePtr;
+
+#endif /* FRAMESOURCE_HPP_ */
@@ -0,0 +1,104 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <boost/filesystem.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "GridFile.hpp"
+#include "GridCache.hpp"
+
+using namespace sgl;
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+GridCache::GridCache(const std::string& directory) : directory(directory), numHits(0), numMisses(0) {
+    if (!this->directory.empty() && this->directory.back() != '/') {
+        this->directory += "/";
+    }
+    boost::system::error_code errorCode;
+    boost::filesystem::create_directories(this->directory, errorCode);
+    if (errorCode) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in GridCache::GridCache: Couldn't create \"" + directory + "\".");
+    }
+}
+
+uint64_t GridCache::computeContentHash(const FrameData& lowresImage, const std::string& modelId) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (char c : modelId) {
+        hash = (hash ^ uint64_t(uint8_t(c))) * FNV_PRIME;
+    }
+    size_t numPixels = size_t(lowresImage.w) * size_t(lowresImage.h);
+    for (size_t i = 0; i < numPixels; i++) {
+        // The alpha channel isn't used by the network
+        for (int c = 0; c < 3; c++) {
+            hash = (hash ^ uint64_t(lowresImage.pixels[i*4 + c])) * FNV_PRIME;
+        }
+    }
+    return hash;
+}
+
+std::string GridCache::getFilename(uint64_t contentHash) {
+    char hashString[17];
+    snprintf(hashString, sizeof(hashString), "%016llx", (unsigned long long)contentHash);
+    return directory + hashString + GRID_FILE_EXTENSION;
+}
+
+GridCoefficientsPtr GridCache::lookup(uint64_t contentHash, const std::string& modelId) {
+    std::string storedModelId;
+    uint64_t storedContentHash = 0;
+    GridCoefficientsPtr grid;
+    std::string filename = getFilename(contentHash);
+    if (boost::filesystem::exists(filename)) {
+        grid = loadGridFile(filename, storedModelId, storedContentHash);
+    }
+
+    if (!grid || storedModelId != modelId || storedContentHash != contentHash) {
+        numMisses++;
+        return GridCoefficientsPtr();
+    }
+    numHits++;
+    return grid;
+}
+
+bool GridCache::store(uint64_t contentHash, const std::string& modelId, const GridCoefficients& grid) {
+    // Write to a temporary file first so that concurrent exports never read partially written files
+    std::string filename = getFilename(contentHash);
+    std::string temporaryFilename = filename + "." + boost::filesystem::unique_path().string() + ".tmp";
+    if (!saveGridFile(temporaryFilename, grid, modelId, contentHash)) {
+        return false;
+    }
+    boost::system::error_code errorCode;
+    boost::filesystem::rename(temporaryFilename, filename, errorCode);
+    return !errorCode;
+}
@@ -0,0 +1,66 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GRIDCACHE_HPP_
+#define GRIDCACHE_HPP_
+
+#include <string>
+#include <cstdint>
+#include "FrameData.hpp"
+#include "GridCoefficients.hpp"
+
+/**
+ * Directory of grid files (see GridFile.hpp) indexed by the hash of the network input and the model.
+ * As the grid only depends on the 256x256 input of the network, inference can be skipped for every image
+ * whose downscaled version was already seen with the same model.
+ */
+class GridCache {
+public:
+    //! \param directory: Folder the grid files are stored in (created if it doesn't exist)
+    explicit GridCache(const std::string& directory);
+    //! \return FNV-1a hash of the RGB values of lowresImage and the model id
+    static uint64_t computeContentHash(const FrameData& lowresImage, const std::string& modelId);
+    //! \return nullptr if no grid is stored for this hash and model
+    GridCoefficientsPtr lookup(uint64_t contentHash, const std::string& modelId);
+    bool store(uint64_t contentHash, const std::string& modelId, const GridCoefficients& grid);
+
+    uint64_t getNumHits() const { return numHits; }
+    uint64_t getNumMisses() const { return numMisses; }
+
+private:
+    std::string getFilename(uint64_t contentHash);
+
+    std::string directory;
+    uint64_t numHits, numMisses;
+};
+
+#endif /* GRIDCACHE_HPP_ */
@@ -0,0 +1,65 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GRIDCOEFFICIENTS_HPP_
+#define GRIDCOEFFICIENTS_HPP_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <glm/glm.hpp>
+
+/**
+ * Bilateral grid of affine transform coefficients predicted by GridPredictor.
+ * The coefficients are stored as three consecutive 3D RGBA grids of size gridSize, one for each row of
+ * the 3x4 affine color transform (i.e., the same layout as the grid textures used by GridRenderer).
+ */
+struct GridCoefficients {
+public:
+    GridCoefficients() {}
+    GridCoefficients(const glm::ivec3& gridSize, const float *data)
+            : gridSize(gridSize), coefficients(data, data + getNumCoefficients(gridSize)) {}
+
+    //! \return The data of one row of the affine transform (a 3D RGBA grid of size gridSize)
+    inline const float *getRow(int i) const {
+        return &coefficients.front() + i*gridSize.x*gridSize.y*gridSize.z*4;
+    }
+    static inline size_t getNumCoefficients(const glm::ivec3& gridSize) {
+        return size_t(3*4) * size_t(gridSize.x) * size_t(gridSize.y) * size_t(gridSize.z);
+    }
+
+    glm::ivec3 gridSize;
+    std::vector<float> coefficients;
+};
+
+typedef boost::shared_ptr<GridCoefficients> GridCoefficientsPtr;
+
+#endif /* GRIDCOEFFICIENTS_HPP_ */
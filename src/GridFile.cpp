@@ -0,0 +1,113 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <vector>
+#include <glm/gtc/packing.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "GridFile.hpp"
+
+using namespace sgl;
+
+// Limits the memory allocated when reading corrupt files
+const size_t MAX_GRID_COEFFICIENTS = size_t(1) << 26;
+
+bool saveGridFile(
+        const std::string& filename, const GridCoefficients& grid, const std::string& modelId,
+        uint64_t contentHash) {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in saveGridFile: Couldn't open file \"" + filename + "\".");
+        return false;
+    }
+
+    GridFileHeader header;
+    header.magic = GRID_FILE_MAGIC;
+    header.version = GRID_FILE_VERSION;
+    header.gridSize[0] = grid.gridSize.x;
+    header.gridSize[1] = grid.gridSize.y;
+    header.gridSize[2] = grid.gridSize.z;
+    header.modelIdLength = uint32_t(modelId.size());
+    header.contentHash = contentHash;
+
+    std::vector<uint16_t> halfCoefficients(grid.coefficients.size());
+    for (size_t i = 0; i < grid.coefficients.size(); i++) {
+        halfCoefficients.at(i) = glm::packHalf1x16(grid.coefficients.at(i));
+    }
+
+    file.write((const char*)&header, sizeof(header));
+    file.write(modelId.data(), std::streamsize(modelId.size()));
+    file.write((const char*)&halfCoefficients.front(), std::streamsize(halfCoefficients.size() * sizeof(uint16_t)));
+    file.close();
+    return !file.fail();
+}
+
+GridCoefficientsPtr loadGridFile(const std::string& filename, std::string& modelId, uint64_t& contentHash) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return GridCoefficientsPtr();
+    }
+
+    GridFileHeader header;
+    file.read((char*)&header, sizeof(header));
+    glm::ivec3 gridSize(header.gridSize[0], header.gridSize[1], header.gridSize[2]);
+    if (!file || header.magic != GRID_FILE_MAGIC || header.version != GRID_FILE_VERSION
+            || gridSize.x <= 0 || gridSize.y <= 0 || gridSize.z <= 0
+            || GridCoefficients::getNumCoefficients(gridSize) > MAX_GRID_COEFFICIENTS
+            || header.modelIdLength > 4096) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in loadGridFile: \"" + filename + "\" is no valid grid file.");
+        return GridCoefficientsPtr();
+    }
+
+    modelId.resize(header.modelIdLength);
+    if (header.modelIdLength > 0) {
+        file.read(&modelId.at(0), std::streamsize(header.modelIdLength));
+    }
+    std::vector<uint16_t> halfCoefficients(GridCoefficients::getNumCoefficients(gridSize));
+    file.read((char*)&halfCoefficients.front(), std::streamsize(halfCoefficients.size() * sizeof(uint16_t)));
+    if (!file) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in loadGridFile: \"" + filename + "\" is truncated.");
+        return GridCoefficientsPtr();
+    }
+
+    GridCoefficientsPtr grid(new GridCoefficients);
+    grid->gridSize = gridSize;
+    grid->coefficients.resize(halfCoefficients.size());
+    for (size_t i = 0; i < halfCoefficients.size(); i++) {
+        grid->coefficients.at(i) = glm::unpackHalf1x16(halfCoefficients.at(i));
+    }
+    contentHash = header.contentHash;
+    return grid;
+}
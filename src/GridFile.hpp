@@ -0,0 +1,69 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GRIDFILE_HPP_
+#define GRIDFILE_HPP_
+
+#include <string>
+#include <cstdint>
+#include "GridCoefficients.hpp"
+
+/*
+ * Sidecar file (.hdrgrid) storing a predicted grid, so that outputs can be rendered at any resolution
+ * without running the network again.
+ *
+ * GridFileHeader | model id (modelIdLength bytes, no terminator) | coefficients (16-bit floats)
+ *
+ * The coefficients are stored as half floats, which is the same precision as the RGBA16F grid textures.
+ */
+
+const uint32_t GRID_FILE_MAGIC = 0x47524448; // "HDRG"
+const uint32_t GRID_FILE_VERSION = 1;
+const char *const GRID_FILE_EXTENSION = ".hdrgrid";
+
+struct GridFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t gridSize[3];
+    uint32_t modelIdLength;
+    //! Hash of the network input the grid was predicted from (see GridCache::computeContentHash)
+    uint64_t contentHash;
+};
+
+//! \param modelId: Identifies the model (i.e., the path to the folder containing the effect data)
+bool saveGridFile(
+        const std::string& filename, const GridCoefficients& grid, const std::string& modelId,
+        uint64_t contentHash);
+//! \return nullptr if the file couldn't be read
+GridCoefficientsPtr loadGridFile(const std::string& filename, std::string& modelId, uint64_t& contentHash);
+
+#endif /* GRIDFILE_HPP_ */
@@ -49,7 +49,11 @@
  */
 
 #include "GridPredictor.hpp"
+#include <tensorflow/core/framework/allocator.h>
+#include <tensorflow/core/public/version.h>
 #include <Utils/File/Logfile.hpp>
+#include "Tracer.hpp"
+#include "PerfCounters.hpp"
 
 // Downscaled image width/heigth
 const int DSC_IMG_SIZE = 256;
@@ -59,66 +63,241 @@ const std::string graphFilename = "frozen_graph.pb";
 
 using namespace sgl;
 
-GridPredictor::GridPredictor() : session(NULL) {
+GridPredictor::GridPredictor() : session(NULL), graphLoaded(false), batchingSupported(true),
+        graphDefMemory(MEMORY_GRAPH_DEFS), numInputTensors(0), graphBytes(0), sessionMemory(MEMORY_TF_SESSIONS) {
 }
 
 GridPredictor::~GridPredictor() {
+    MemoryAccounting::get()->removeReclaimer(this);
     if (session) {
         session->Close();
+        delete session;
     }
 }
 
-bool GridPredictor::loadGraph(const std::string& path) {
-    // 1. Create Tensorflow session
-    tf::Status status = tf::NewSession(tf::SessionOptions(), &session);
+void GridPredictor::enableAllocatorStats() {
+#if TF_MAJOR_VERSION < 2 || (TF_MAJOR_VERSION == 2 && TF_MINOR_VERSION < 3)
+    tf::EnableCPUAllocatorStats(true);
+#else
+    tf::EnableCPUAllocatorStats();
+#endif
+    MemoryAccounting::get()->setAllocatorStatsProvider(MEMORY_TF_SESSIONS, [](size_t& bytes) {
+#if TF_MAJOR_VERSION < 2 && TF_MINOR_VERSION < 14
+        // Older versions fill in the statistics instead of returning an optional value
+        tf::AllocatorStats stats;
+        tf::cpu_allocator()->GetStats(&stats);
+        bytes = size_t(stats.bytes_in_use);
+#else
+        absl::optional<tf::AllocatorStats> stats = tf::cpu_allocator()->GetStats();
+        if (!stats) {
+            return false;
+        }
+        bytes = size_t(stats->bytes_in_use);
+#endif
+        return true;
+    });
+}
 
-    if (!status.ok()) {
-        Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
+bool GridPredictor::loadGraph(const std::string& path, int numThreads, bool checkMemoryBudget) {
+    graphLoaded = false;
+    modelPath = path;
+
+    // The graph definition and the weights copied to the session need about twice the size of the file
+    tf::uint64 graphFileSize = 0;
+    tf::Env::Default()->GetFileSize(std::string() + path + graphFilename, &graphFileSize);
+    if (checkMemoryBudget
+            && !MemoryAccounting::get()->ensureBudget(2 * size_t(graphFileSize), "GridPredictor::loadGraph")) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in GridPredictor::loadGraph: \"" + path
+                + "\" doesn't fit into the memory budget.");
         return false;
     }
 
-    // 2. Load network graph definition from file
-    status = tf::ReadBinaryProto(tf::Env::Default(), std::string() + path + graphFilename, &graphDef);
+    // 1. Create Tensorflow session
+    tf::SessionOptions sessionOptions;
+    if (numThreads > 0) {
+        sessionOptions.config.set_intra_op_parallelism_threads(numThreads);
+        sessionOptions.config.set_inter_op_parallelism_threads(1);
+    }
+    tf::Status status = tf::NewSession(sessionOptions, &session);
+
     if (!status.ok()) {
         Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
         return false;
     }
-    //tf::graph::SetDefaultDevice("/cpu:0", &graphDef);
 
-    // 3. Create session from loaded graph definition
-    status = session->Create(graphDef);
+    {
+        std::lock_guard<std::mutex> lock(graphDefMutex);
+        // 2. Load network graph definition from file
+        status = tf::ReadBinaryProto(tf::Env::Default(), std::string() + path + graphFilename, &graphDef);
+        if (!status.ok()) {
+            Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
+            return false;
+        }
+        //tf::graph::SetDefaultDevice("/cpu:0", &graphDef);
+        graphDefMemory.set(graphDef.ByteSizeLong());
+
+        // 3. Create session from loaded graph definition
+        status = session->Create(graphDef);
+        if (!status.ok()) {
+            Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
+            return false;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(tensorPoolMutex);
+        graphBytes = graphDefMemory.get();
+        updateSessionMemory();
+    }
+    MemoryAccounting::get()->addReclaimer(this, RECLAIM_PRIORITY_UNUSED_STATE);
+
+    // 4. Determine the grid size with a first inference call
+    tf::Tensor inputTensor = acquireInputTensor();
+    std::vector<tf::Tensor> outputs;
+    status = session->Run({{inputName, inputTensor}}, {outputName}, {}, &outputs);
+    releaseInputTensor(inputTensor);
     if (!status.ok()) {
         Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
         return false;
     }
-
-    // 4. Initialize class member data
-    inputTensor = tf::Tensor(tf::DT_FLOAT, tf::TensorShape({1, DSC_IMG_SIZE, DSC_IMG_SIZE, 3}));
-    inputs = {{inputName, inputTensor}};
-    status = session->Run(inputs, {outputName}, {}, &outputs);
     gridSize = glm::ivec3(outputs[0].dim_size(3), outputs[0].dim_size(2), outputs[0].dim_size(1));
 
+    graphLoaded = true;
     return true;
 }
 
-float *GridPredictor::computeGridCoefficients(FrameDataPtr &lowresImage) {
-    float* inputPixels = inputTensor.flat<float>().data();
+size_t GridPredictor::reclaimMemory(size_t bytesNeeded) {
+    size_t releasedBytes;
+    {
+        std::lock_guard<std::mutex> lock(graphDefMutex);
+        releasedBytes = graphDefMemory.get();
+        // Clear keeps the memory of repeated fields, so the data is swapped into a temporary object instead
+        tf::GraphDef().Swap(&graphDef);
+        graphDefMemory.set(0);
+    }
+    // Nothing left to reclaim until the next call to loadGraph
+    MemoryAccounting::get()->removeReclaimer(this);
+    return releasedBytes;
+}
+
+std::string GridPredictor::getReclaimerName() const {
+    return "graph definition of \"" + modelPath + "\"";
+}
+
+void GridPredictor::updateSessionMemory() const {
+    sessionMemory.set(graphBytes + numInputTensors * size_t(DSC_IMG_SIZE * DSC_IMG_SIZE * 3) * sizeof(float));
+}
+
+tf::Tensor GridPredictor::acquireInputTensor() const {
+    std::lock_guard<std::mutex> lock(tensorPoolMutex);
+    if (!freeInputTensors.empty()) {
+        tf::Tensor inputTensor = freeInputTensors.back();
+        freeInputTensors.pop_back();
+        return inputTensor;
+    }
+    numInputTensors++;
+    updateSessionMemory();
+    return tf::Tensor(tf::DT_FLOAT, tf::TensorShape({1, DSC_IMG_SIZE, DSC_IMG_SIZE, 3}));
+}
+
+void GridPredictor::releaseInputTensor(const tf::Tensor& inputTensor) const {
+    std::lock_guard<std::mutex> lock(tensorPoolMutex);
+    freeInputTensors.push_back(inputTensor);
+}
+
+size_t GridPredictor::getNumPooledTensors() const {
+    std::lock_guard<std::mutex> lock(tensorPoolMutex);
+    return numInputTensors;
+}
+
+void GridPredictor::fillInputTensor(float *inputPixels, const FrameData &lowresImage) {
     for (int y = 0; y < DSC_IMG_SIZE; ++y) {
         for (int x = 0; x < DSC_IMG_SIZE; ++x) {
             // 3 color channels
             for (int c = 0; c < 3; ++c) {
-                inputPixels[c+3*(x+DSC_IMG_SIZE*y)] = lowresImage->pixels[c+4*(x+DSC_IMG_SIZE*y)]/255.0f;
+                inputPixels[c+3*(x+DSC_IMG_SIZE*y)] = lowresImage.pixels[c+4*(x+DSC_IMG_SIZE*y)]/255.0f;
             }
         }
     }
+}
 
-    tf::Status status = session->Run(inputs, {outputName}, {}, &outputs);
+GridCoefficientsPtr GridPredictor::computeGridCoefficients(const FrameData &lowresImage) const {
+    TRACE_SCOPE("GridPredictor::computeGridCoefficients");
+    if (!graphLoaded) {
+        Logfile::get()->writeError("ERROR in GridPredictor::computeGridCoefficients: No graph loaded.");
+        return GridCoefficientsPtr();
+    }
+    tf::Tensor inputTensor = acquireInputTensor();
+    {
+        PERF_SCOPE("GridPredictor::fillInputTensor", DSC_IMG_SIZE * DSC_IMG_SIZE);
+        fillInputTensor(inputTensor.flat<float>().data(), lowresImage);
+    }
+
+    tf::Status status;
+    std::vector<tf::Tensor> outputs;
+    {
+        TRACE_SCOPE("Session::Run");
+        PERF_SCOPE("Session::Run", DSC_IMG_SIZE * DSC_IMG_SIZE);
+        status = session->Run({{inputName, inputTensor}}, {outputName}, {}, &outputs);
+    }
+    releaseInputTensor(inputTensor);
     if (!status.ok()) {
-        Logfile::get()->writeError(std::string() + "ERROR in GridPredictor::loadGraph: " + status.ToString());
-        return nullptr;
+        Logfile::get()->writeError(
+                std::string() + "ERROR in GridPredictor::computeGridCoefficients: " + status.ToString());
+        return GridCoefficientsPtr();
+    }
+
+    // Affine transform coefficients (copied, as the output tensor belongs to this call only)
+    const float *coefficientData = outputs[0].flat<float>().data();
+    return GridCoefficientsPtr(new GridCoefficients(gridSize, coefficientData));
+}
+
+bool GridPredictor::computeGridCoefficientsBatch(
+        const std::vector<FrameDataPtr> &lowresImages, std::vector<GridCoefficientsPtr> &grids) const {
+    TRACE_SCOPE("GridPredictor::computeGridCoefficientsBatch");
+    grids.clear();
+    int batchSize = int(lowresImages.size());
+    if (batchSize == 0) {
+        return true;
+    }
+    if (!graphLoaded) {
+        Logfile::get()->writeError("ERROR in GridPredictor::computeGridCoefficientsBatch: No graph loaded.");
+        return false;
     }
 
-    // Affine transform coefficients
-    float* coefficientData = outputs[0].flat<float>().data();
-    return coefficientData;
+    if (batchSize > 1 && batchingSupported.load()) {
+        tf::Tensor batchTensor(tf::DT_FLOAT, tf::TensorShape({batchSize, DSC_IMG_SIZE, DSC_IMG_SIZE, 3}));
+        float *batchPixels = batchTensor.flat<float>().data();
+        for (int i = 0; i < batchSize; ++i) {
+            fillInputTensor(batchPixels + i*DSC_IMG_SIZE*DSC_IMG_SIZE*3, *lowresImages.at(i));
+        }
+
+        std::vector<tf::Tensor> batchOutputs;
+        tf::Status status = session->Run({{inputName, batchTensor}}, {outputName}, {}, &batchOutputs);
+        size_t numCoefficients = GridCoefficients::getNumCoefficients(gridSize);
+        if (status.ok() && size_t(batchOutputs[0].NumElements()) == numCoefficients * size_t(batchSize)) {
+            const float *coefficientData = batchOutputs[0].flat<float>().data();
+            for (int i = 0; i < batchSize; ++i) {
+                grids.push_back(GridCoefficientsPtr(
+                        new GridCoefficients(gridSize, coefficientData + i*numCoefficients)));
+            }
+            return true;
+        }
+
+        // Graphs frozen with a fixed batch size of one can't process batches
+        Logfile::get()->writeInfo(
+                std::string() + "INFO in GridPredictor::computeGridCoefficientsBatch: Graph doesn't support "
+                + "batched inference, falling back to one inference call per image. " + status.ToString());
+        batchingSupported = false;
+    }
+
+    for (int i = 0; i < batchSize; ++i) {
+        GridCoefficientsPtr grid = computeGridCoefficients(*lowresImages.at(i));
+        if (!grid) {
+            grids.clear();
+            return false;
+        }
+        grids.push_back(grid);
+    }
+    return true;
 }
@@ -33,39 +33,104 @@
 #ifndef GRIDPREDICTOR_HPP_
 #define GRIDPREDICTOR_HPP_
 
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <boost/shared_ptr.hpp>
 #include <glm/glm.hpp>
 #include <tensorflow/core/public/session.h>
+#include <tensorflow/core/public/session_options.h>
 #include <tensorflow/core/platform/env.h>
 #include <tensorflow/core/graph/graph.h>
 #include <tensorflow/core/graph/default_device.h>
 #include "FrameData.hpp"
+#include "GridCoefficients.hpp"
+#include "MemoryAccounting.hpp"
 
 namespace tf = tensorflow;
 
-//! Used to compute the bilateral grid containing affine transform coefficients
-class GridPredictor {
+/**
+ * Used to compute the bilateral grid containing affine transform coefficients.
+ * After loadGraph, the inference functions are thread-safe, so one loaded session can serve many threads
+ * (TensorFlow sessions support concurrent calls to Run). Each call takes an input tensor from a pool and
+ * returns the grid as a reference-counted copy owned by the caller.
+ * The memory of the session and of the graph definition is reported to MemoryAccounting. The graph definition
+ * isn't needed anymore once the session was created, so it can be released when the memory budget is exceeded.
+ */
+class GridPredictor : public MemoryReclaimer {
 public:
     GridPredictor();
     ~GridPredictor();
-    //! \param path: Path to folder containing graph data
-    bool loadGraph(const std::string& path);
+    GridPredictor(const GridPredictor&) = delete;
+    GridPredictor& operator=(const GridPredictor&) = delete;
+    /*!
+     * Not thread-safe (must be called before the predictor is shared).
+     * \param path: Path to folder containing graph data
+     * \param numThreads: Maximum number of threads used by TensorFlow for one inference call
+     * (0 = TensorFlow's default, i.e. all cores). Useful when multiple predictors run in parallel.
+     * \param checkMemoryBudget: Whether to make room for the graph in the memory budget before loading it. This may
+     * call reclaimers that aren't thread-safe, so it must be false when loading on a background thread (the caller
+     * then checks the budget on the main thread when it receives the predictor).
+     * \return false if the graph couldn't be loaded (e.g. if it doesn't fit into the memory budget).
+     */
+    bool loadGraph(const std::string& path, int numThreads = 0, bool checkMemoryBudget = true);
     /*!
      * \param lowresImage: 256x256 32-bit RGBA image
-     * \return Returns the affine transform coefficients stored in the grid
+     * \return The affine transform coefficients stored in the grid (or an empty pointer on failure)
      */
-    float *computeGridCoefficients(FrameDataPtr &lowresImage);
+    GridCoefficientsPtr computeGridCoefficients(const FrameData &lowresImage) const;
+    /*!
+     * Predicts the grids of multiple images in one inference call if the graph supports a dynamic batch
+     * dimension. Otherwise, the images are processed one after another.
+     * \param lowresImages: 256x256 32-bit RGBA images
+     * \param grids: Is filled with the affine transform coefficients of each image
+     */
+    bool computeGridCoefficientsBatch(
+            const std::vector<FrameDataPtr> &lowresImages, std::vector<GridCoefficientsPtr> &grids) const;
 
     // Getters
-    glm::ivec3 getGridSize() { return gridSize; }
+    glm::ivec3 getGridSize() const { return gridSize; }
+    //! \return The number of input tensors allocated so far (i.e. the maximum number of concurrent calls)
+    size_t getNumPooledTensors() const;
+
+    //! Converts the 8-bit RGBA image to the normalized RGB float layout of the network input
+    static void fillInputTensor(float *inputPixels, const FrameData &lowresImage);
+    /*!
+     * Makes the CPU allocator of TensorFlow collect statistics, which MemoryAccounting uses for the memory of
+     * the sessions instead of the estimates of the predictors. Costs a lock per allocation, so it is only
+     * enabled when a memory budget is set. Has to be called before the first session is created.
+     */
+    static void enableAllocatorStats();
+
+    // MemoryReclaimer (releases the retained graph definition)
+    virtual size_t reclaimMemory(size_t bytesNeeded);
+    virtual std::string getReclaimerName() const;
 
 private:
+    tf::Tensor acquireInputTensor() const;
+    void releaseInputTensor(const tf::Tensor& inputTensor) const;
+    //! Estimate of the session memory: Weights of the graph and the pooled input tensors (needs tensorPoolMutex)
+    void updateSessionMemory() const;
+
     tensorflow::Session *session;
-    tensorflow::GraphDef graphDef;
-    tf::Tensor inputTensor;
-    std::vector<std::pair<std::string, tf::Tensor>> inputs;
-    std::vector<tf::Tensor> outputs;
+    bool graphLoaded;
+    std::string modelPath;
     glm::ivec3 gridSize;
+    mutable std::atomic<bool> batchingSupported;
+
+    // Only needed for creating the session
+    std::mutex graphDefMutex;
+    tensorflow::GraphDef graphDef;
+    TrackedMemory graphDefMemory;
+
+    // Input tensors not used by a call at the moment
+    mutable std::mutex tensorPoolMutex;
+    mutable std::vector<tf::Tensor> freeInputTensors;
+    mutable size_t numInputTensors;
+    size_t graphBytes;
+    mutable TrackedMemory sessionMemory;
 };
 
+typedef boost::shared_ptr<GridPredictor> GridPredictorPtr;
 
 #endif /* GRIDPREDICTOR_HPP_ */
@@ -50,7 +50,7 @@
 
 
 #include <string>
-#include <fstream>
+#include <algorithm>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <Utils/File/Logfile.hpp>
@@ -59,52 +59,126 @@
 #include <Graphics/Window.hpp>
 #include <Utils/AppSettings.hpp>
 #include <Math/Math.hpp>
+#include "GuideParameters.hpp"
+#include "Tracer.hpp"
 #include "GridRenderer.hpp"
 
 using namespace sgl;
 
-void loadBytesFromFile(const std::string& filename, int bytes, char *buffer) {
-    std::ifstream file(filename.c_str(), std::ios::binary);
-    if(!file.is_open()) {
-        Logfile::get()->writeError(
-                std::string() + "ERROR in loadFileContent: Couldn't load file \"" + filename + "\".");
-    }
-    file.read(buffer, bytes);
-    file.close();
-}
-
-GridRenderer::GridRenderer() {
+GridRenderer::GridRenderer() : gridValid(false), inputFormat(FRAME_FORMAT_RGBA8), renderScale(1.0f),
+        slicingTimerQueryIndex(0), slicingTimeMs(0.0f), textureMemory(MEMORY_TEXTURES) {
     gridRenderShader = ShaderManager->getShaderProgram(
             {"ApplyCoefficients.Vertex", "ApplyCoefficients.Fragment"});
     blitShader = ShaderManager->getShaderProgram(
             {"Blit.Vertex", "Blit.Fragment"});
+    lutRenderShader = ShaderManager->getShaderProgram(
+            {"ApplyLut.Vertex", "ApplyLut.Fragment"});
+
+    glGenQueries(2, slicingTimerQueries);
+    slicingTimerQueryIssued[0] = slicingTimerQueryIssued[1] = false;
 }
 
-void GridRenderer::initialize(const std::string& path) {
-    gridPredictor = GridPredictor();
-    gridPredictor.loadGraph(path);
-    glm::ivec3 gridSize = gridPredictor.getGridSize();
+GridRenderer::~GridRenderer() {
+    glDeleteQueries(2, slicingTimerQueries);
+}
+
+bool GridRenderer::initialize(const std::string& path) {
+    // Otherwise, the old session would count towards the memory budget while the new one is loaded
+    gridPredictor = GridPredictorPtr();
+    gridTextures.clear();
+    gridValid = false;
+    updateTextureMemory();
+
+    GridPredictorPtr newGridPredictor;
+    GuideParameters guide;
+    if (!loadModel(path, newGridPredictor, guide)) {
+        return false;
+    }
+    setModel(newGridPredictor, guide);
+    return true;
+}
+
+bool GridRenderer::loadModel(
+        const std::string& path, GridPredictorPtr& gridPredictor, GuideParameters& guide, bool checkMemoryBudget) {
+    TRACE_SCOPE("GridRenderer::loadModel");
+    gridPredictor = GridPredictorPtr(new GridPredictor);
+    if (!gridPredictor->loadGraph(path, 0, checkMemoryBudget)) {
+        gridPredictor = GridPredictorPtr();
+        return false;
+    }
+    guide.load(path);
+    return true;
+}
+
+void GridRenderer::setModel(const GridPredictorPtr& gridPredictor, const GuideParameters& guide) {
+    this->gridPredictor = gridPredictor;
+    gridValid = false;
+    glm::ivec3 gridSize = gridPredictor->getGridSize();
 
     TextureSettings settings;
     settings.type = TEXTURE_3D;
     settings.internalFormat = GL_RGBA16F;
+    // Same boundary handling as CpuSlicer
+    settings.textureWrapS = GL_CLAMP_TO_EDGE;
+    settings.textureWrapT = GL_CLAMP_TO_EDGE;
+    settings.textureWrapR = GL_CLAMP_TO_EDGE;
     gridTextures.clear();
     for (int i = 0; i < 3; ++i) {
         TexturePtr gridTexture = TextureManager->createEmptyTexture(
                 gridSize.x, gridSize.y, gridSize.z, settings);
         gridTextures.push_back(gridTexture);
     }
+    updateTextureMemory();
+
+    setGuideUniforms(guide);
+    tileChangeDetector.invalidate();
+}
+
+void GridRenderer::updateTextureMemory() {
+    size_t bytes = 0;
+    if (!gridTextures.empty()) {
+        // RGBA16F
+        glm::ivec3 gridSize = gridPredictor->getGridSize();
+        bytes += gridTextures.size() * size_t(gridSize.x) * size_t(gridSize.y) * size_t(gridSize.z) * 8;
+    }
+    if (lutTexture) {
+        // RGB16F
+        size_t lutSize = size_t(lutTexture->getW());
+        bytes += lutSize * lutSize * lutSize * 6;
+    }
+    // RGBA8 render targets
+    const sgl::TexturePtr renderTargets[] = { scaledOutputTexture, tiledOutputTexture, readbackTexture };
+    for (const sgl::TexturePtr& texture : renderTargets) {
+        if (texture) {
+            bytes += size_t(texture->getW()) * size_t(texture->getH()) * 4;
+        }
+    }
+    textureMemory.set(bytes);
+}
 
-    loadGuideParameters(path);
+void GridRenderer::setInputFormat(FrameFormat format, const sgl::TexturePtr &chromaTexture) {
+    inputFormat = format;
+    this->chromaTexture = chromaTexture;
+}
+
+glm::ivec2 GridRenderer::getImageSize(sgl::TexturePtr &imageTexture) {
+    if (inputFormat == FRAME_FORMAT_YUYV) {
+        // Two pixels per texel
+        return glm::ivec2(imageTexture->getW() * 2, imageTexture->getH());
+    }
+    return glm::ivec2(imageTexture->getW(), imageTexture->getH());
 }
 
 AABB2 getRenderRect(sgl::TexturePtr &imageTexture) {
+    return getRenderRect(float(imageTexture->getW()) / imageTexture->getH());
+}
+
+AABB2 getRenderRect(float imageRatio) {
     Window *window = AppSettings::get()->getMainWindow();
 
     AABB2 renderRect;
     glm::vec2 extent;
     float windowRatio = float(window->getWidth())/window->getHeight();
-    float imageRatio = float(imageTexture->getW()) / imageTexture->getH();
     if (windowRatio >= imageRatio) {
         extent = glm::vec2(imageRatio/windowRatio, 1.0f);
     } else {
@@ -118,77 +192,230 @@ AABB2 getRenderRect(sgl::TexturePtr &imageTexture) {
 
 
 void GridRenderer::renderTransformedImage(sgl::TexturePtr &imageTexture, FrameDataPtr &lowresImage) {
-    // Set-up the vertex data of the rectangle
-    AABB2 renderRect = getRenderRect(imageTexture);
-    std::vector<VertexTextured> fullscreenQuad(createTexturedQuad(renderRect));
+    TRACE_SCOPE("GridRenderer::renderTransformedImage");
+    if (predictGrid(lowresImage)) {
+        renderSlicedImage(imageTexture);
+    }
+}
 
-    // Feed the shader with the data and render the quad
-    int stride = sizeof(VertexTextured);
-    GeometryBufferPtr geomBuffer = Renderer->createGeometryBuffer(
-            sizeof(VertexTextured)*fullscreenQuad.size(), &fullscreenQuad.front());
-    sgl::ShaderAttributesPtr gridRenderData = ShaderManager->createShaderAttributes(gridRenderShader);
-    gridRenderData->addGeometryBuffer(
-            geomBuffer, "vertexPosition", ATTRIB_FLOAT, 3, 0, stride);
-    gridRenderData->addGeometryBuffer(
-            geomBuffer, "vertexTexCoord", ATTRIB_FLOAT, 2, sizeof(glm::vec3), stride);
+bool GridRenderer::predictGrid(FrameDataPtr &lowresImage) {
+    TRACE_SCOPE("GridRenderer::predictGrid");
+    if (!gridPredictor) {
+        return false;
+    }
+    GridCoefficientsPtr grid = gridPredictor->computeGridCoefficients(*lowresImage);
+    if (!grid) {
+        return false;
+    }
 
+    uploadGrid(*grid);
+    return true;
+}
 
-    float *affineCoefficients = gridPredictor.computeGridCoefficients(lowresImage);
-    glm::ivec3 gridSize = gridPredictor.getGridSize();
+void GridRenderer::uploadGrid(const GridCoefficients &grid) {
+    TRACE_SCOPE("GridRenderer::uploadGrid");
+    const glm::ivec3 &gridSize = grid.gridSize;
+    for (int i = 0; i < 3; ++i) {
+        gridTextures[i]->uploadPixelData(
+                gridSize.x, gridSize.y, gridSize.z, grid.getRow(i),
+                PixelFormat(GL_RGBA, GL_FLOAT));
+    }
+    gridValid = true;
+    tileChangeDetector.updateGrid(grid);
+}
 
+void GridRenderer::setGridRenderUniforms(sgl::TexturePtr &imageTexture) {
     gridRenderShader->setUniform("image", imageTexture, 0);
+    gridRenderShader->setUniform("inputFormat", int(inputFormat));
+    if (inputFormat == FRAME_FORMAT_NV12) {
+        gridRenderShader->setUniform("chromaImage", chromaTexture, 4);
+    }
     for (int i = 0; i < 3; ++i) {
-        float *data = affineCoefficients + i*gridSize.x*gridSize.y*gridSize.z*4;
-        TexturePtr gridTexture = gridTextures[i];
-        gridTexture->uploadPixelData(
-                gridSize.x, gridSize.y, gridSize.z, data,
-                PixelFormat(GL_RGBA, GL_FLOAT));
         std::string texUniformName = std::string() + "affineGridRow" + sgl::toString(i);
-        gridRenderShader->setUniform(texUniformName.c_str(), gridTexture, i+1);
+        gridRenderShader->setUniform(texUniformName.c_str(), gridTextures[i], i+1);
+    }
+}
+
+void GridRenderer::renderSlicedImage(sgl::TexturePtr &imageTexture) {
+    TRACE_SCOPE("GridRenderer::renderSlicedImage");
+    setGridRenderUniforms(imageTexture);
+
+    glm::ivec2 imageSize = getImageSize(imageTexture);
+    AABB2 renderRect = getRenderRect(float(imageSize.x) / imageSize.y);
+    if (renderScale >= 1.0f) {
+        beginSlicingTimer();
+        renderQuad(gridRenderShader, createTexturedQuad(renderRect));
+        endSlicingTimer();
+        return;
     }
 
-    Renderer->render(gridRenderData);
+    // Slice into a texture at reduced resolution and upscale it when blitting it to the screen
+    Window *window = AppSettings::get()->getMainWindow();
+    int scaledWidth = std::max(int((renderRect.max.x - renderRect.min.x) * 0.5f * window->getWidth() * renderScale), 1);
+    int scaledHeight = std::max(int((renderRect.max.y - renderRect.min.y) * 0.5f * window->getHeight() * renderScale), 1);
+    if (!scaledOutputTexture || scaledOutputTexture->getW() != scaledWidth
+            || scaledOutputTexture->getH() != scaledHeight) {
+        scaledOutputTexture = TextureManager->createEmptyTexture(scaledWidth, scaledHeight);
+        scaledOutputFbo = Renderer->createFBO();
+        scaledOutputFbo->bindTexture(scaledOutputTexture);
+        updateTextureMemory();
+    }
+
+    Renderer->bindFBO(scaledOutputFbo);
+    glViewport(0, 0, scaledWidth, scaledHeight);
+    beginSlicingTimer();
+    renderQuad(gridRenderShader, createFullscreenQuad());
+    endSlicingTimer();
+    Renderer->unbindFBO();
+    glViewport(0, 0, window->getWidth(), window->getHeight());
+
+    blitShader->setUniform("inputTexture", scaledOutputTexture);
+    blitShader->setUniform("inputFormat", int(FRAME_FORMAT_RGBA8));
+    renderQuad(blitShader, createTexturedQuad(renderRect));
 }
 
-void GridRenderer::renderNormalImage(sgl::TexturePtr &imageTexture, FrameDataPtr &lowresImage) {
-    // Set-up the vertex data of the rectangle
+void GridRenderer::detectChangedTiles(const FrameData &frame) {
+    TRACE_SCOPE("GridRenderer::detectChangedTiles");
+    tileChangeDetector.update(frame);
+}
+
+void GridRenderer::renderSlicedImageIncremental(sgl::TexturePtr &imageTexture) {
+    TRACE_SCOPE("GridRenderer::renderSlicedImageIncremental");
+    glm::ivec2 imageSize = getImageSize(imageTexture);
+    if (!tiledOutputTexture || tiledOutputTexture->getW() != imageSize.x
+            || tiledOutputTexture->getH() != imageSize.y) {
+        tiledOutputTexture = TextureManager->createEmptyTexture(imageSize.x, imageSize.y);
+        tiledOutputFbo = Renderer->createFBO();
+        tiledOutputFbo->bindTexture(tiledOutputTexture);
+        tileChangeDetector.invalidate();
+        updateTextureMemory();
+    }
+
+    // Rows of the output texture correspond to rows of the frame, so the tiles can be used as scissor rects
+    tileChangeDetector.getChangedTileRects(changedTileRects);
+    if (!changedTileRects.empty()) {
+        setGridRenderUniforms(imageTexture);
+        Renderer->bindFBO(tiledOutputFbo);
+        glViewport(0, 0, imageSize.x, imageSize.y);
+        glEnable(GL_SCISSOR_TEST);
+        beginSlicingTimer();
+        std::vector<VertexTextured> quad = createFullscreenQuad();
+        for (const glm::ivec4 &rect : changedTileRects) {
+            glScissor(rect.x, rect.y, rect.z - rect.x, rect.w - rect.y);
+            renderQuad(gridRenderShader, quad);
+        }
+        endSlicingTimer();
+        glDisable(GL_SCISSOR_TEST);
+        Renderer->unbindFBO();
+        Window *window = AppSettings::get()->getMainWindow();
+        glViewport(0, 0, window->getWidth(), window->getHeight());
+    } else {
+        slicingTimeMs = 0.0f;
+    }
+    tileChangeDetector.markSliced();
+
+    blitShader->setUniform("inputTexture", tiledOutputTexture, 0);
+    blitShader->setUniform("inputFormat", int(FRAME_FORMAT_RGBA8));
+    renderQuad(blitShader, createTexturedQuad(getRenderRect(float(imageSize.x) / imageSize.y)));
+}
+
+void GridRenderer::renderSlicedImageToMemory(sgl::TexturePtr &imageTexture, uint8_t *pixels) {
+    TRACE_SCOPE("GridRenderer::renderSlicedImageToMemory");
+    glm::ivec2 imageSize = getImageSize(imageTexture);
+    int width = imageSize.x;
+    int height = imageSize.y;
+    if (!readbackTexture || readbackTexture->getW() != width || readbackTexture->getH() != height) {
+        readbackTexture = TextureManager->createEmptyTexture(width, height);
+        readbackFbo = Renderer->createFBO();
+        readbackFbo->bindTexture(readbackTexture);
+        updateTextureMemory();
+    }
+
+    setGridRenderUniforms(imageTexture);
+    Renderer->bindFBO(readbackFbo);
+    glViewport(0, 0, width, height);
+    renderQuad(gridRenderShader, createFullscreenQuad());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    Renderer->unbindFBO();
+
+    Window *window = AppSettings::get()->getMainWindow();
+    glViewport(0, 0, window->getWidth(), window->getHeight());
+}
+
+void GridRenderer::setColorLut(const ColorLut &lut) {
+    TextureSettings settings;
+    settings.type = TEXTURE_3D;
+    settings.internalFormat = GL_RGB16F;
+    settings.textureWrapS = GL_CLAMP_TO_EDGE;
+    settings.textureWrapT = GL_CLAMP_TO_EDGE;
+    settings.textureWrapR = GL_CLAMP_TO_EDGE;
+    lutTexture = TextureManager->createEmptyTexture(lut.size, lut.size, lut.size, settings);
+    lutTexture->uploadPixelData(lut.size, lut.size, lut.size, &lut.entries.front(), PixelFormat(GL_RGB, GL_FLOAT));
+    lutRenderShader->setUniform("lutSize", float(lut.size));
+    updateTextureMemory();
+}
+
+void GridRenderer::renderLutImage(sgl::TexturePtr &imageTexture) {
+    TRACE_SCOPE("GridRenderer::renderLutImage");
+    lutRenderShader->setUniform("image", imageTexture, 0);
+    lutRenderShader->setUniform("colorLut", lutTexture, 1);
     AABB2 renderRect = getRenderRect(imageTexture);
-    std::vector<VertexTextured> fullscreenQuad(createTexturedQuad(renderRect));
+    beginSlicingTimer();
+    renderQuad(lutRenderShader, createTexturedQuad(renderRect));
+    endSlicingTimer();
+}
 
+void GridRenderer::renderNormalImage(sgl::TexturePtr &imageTexture, FrameDataPtr &lowresImage) {
+    glm::ivec2 imageSize = getImageSize(imageTexture);
+    AABB2 renderRect = getRenderRect(float(imageSize.x) / imageSize.y);
+    blitShader->setUniform("inputTexture", imageTexture, 0);
+    blitShader->setUniform("inputFormat", int(inputFormat));
+    if (inputFormat == FRAME_FORMAT_NV12) {
+        blitShader->setUniform("chromaImage", chromaTexture, 1);
+    }
+    renderQuad(blitShader, createTexturedQuad(renderRect));
+}
+
+void GridRenderer::renderQuad(sgl::ShaderProgramPtr &shader, const std::vector<VertexTextured> &quad) {
     // Feed the shader with the data and render the quad
     int stride = sizeof(VertexTextured);
     GeometryBufferPtr geomBuffer = Renderer->createGeometryBuffer(
-            sizeof(VertexTextured)*fullscreenQuad.size(), &fullscreenQuad.front());
-    sgl::ShaderAttributesPtr renderData = ShaderManager->createShaderAttributes(blitShader);
+            sizeof(VertexTextured)*quad.size(), (void*)&quad.front());
+    sgl::ShaderAttributesPtr renderData = ShaderManager->createShaderAttributes(shader);
     renderData->addGeometryBuffer(
             geomBuffer, "vertexPosition", ATTRIB_FLOAT, 3, 0, stride);
     renderData->addGeometryBuffer(
             geomBuffer, "vertexTexCoord", ATTRIB_FLOAT, 2, sizeof(glm::vec3), stride);
-    blitShader->setUniform("inputTexture", imageTexture);
-
     Renderer->render(renderData);
 }
 
-// See https://github.com/mgharbi/hdrnet/blob/master/benchmark/src/renderer.cc for more details
-void GridRenderer::loadGuideParameters(const std::string& path) {
-    glm::mat3x4 ccm;
-    glm::vec4 mixMatrix;
-    glm::vec3 shifts[16];
-    glm::vec3 slopes[16];
+void GridRenderer::beginSlicingTimer() {
+    // Read back the query issued two frames ago (if it is available) to avoid stalling the pipeline
+    GLuint query = slicingTimerQueries[slicingTimerQueryIndex];
+    if (slicingTimerQueryIssued[slicingTimerQueryIndex]) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsedNs = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+            slicingTimeMs = elapsedNs / 1e6f;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
 
-    loadBytesFromFile(
-            std::string() + path + "guide_ccm_f32_3x4.bin", sizeof(glm::mat3x4), (char*)&ccm);
-    loadBytesFromFile(
-            std::string() + path + "guide_mix_matrix_f32_1x4.bin", sizeof(glm::vec4), (char*)&mixMatrix);
-    loadBytesFromFile(
-            std::string() + path + "guide_shifts_f32_16x3.bin", 16*3*sizeof(float), (char*)shifts);
-    loadBytesFromFile(
-            std::string() + path + "guide_slopes_f32_16x3.bin", 16*3*sizeof(float), (char*)slopes);
+void GridRenderer::endSlicingTimer() {
+    glEndQuery(GL_TIME_ELAPSED);
+    slicingTimerQueryIssued[slicingTimerQueryIndex] = true;
+    slicingTimerQueryIndex = (slicingTimerQueryIndex + 1) % 2;
+}
 
-    gridRenderShader->setUniform("guideCCM", ccm);
-    gridRenderShader->setUniform("mixMatrix", mixMatrix);
-    gridRenderShader->setUniformArray("guideShifts", shifts, 16);
-    gridRenderShader->setUniformArray("guideSlopes", slopes, 16);
+void GridRenderer::setGuideUniforms(const GuideParameters& guide) {
+    gridRenderShader->setUniform("guideCCM", guide.ccm);
+    gridRenderShader->setUniform("mixMatrix", guide.mixMatrix);
+    gridRenderShader->setUniformArray("guideShifts", guide.shifts, NUM_GUIDE_SEGMENTS);
+    gridRenderShader->setUniformArray("guideSlopes", guide.slopes, NUM_GUIDE_SEGMENTS);
 }
 
 
@@ -204,3 +431,15 @@ std::vector<VertexTextured> GridRenderer::createTexturedQuad(const AABB2 &render
             VertexTextured(glm::vec3(min.x,max.y,0), glm::vec2(1, 0))};
     return quad;
 }
+
+std::vector<VertexTextured> GridRenderer::createFullscreenQuad() {
+    // Maps the texture coordinates 1:1 to the render target (no mirroring)
+    std::vector<VertexTextured> quad{
+            VertexTextured(glm::vec3(1,1,0), glm::vec2(1, 1)),
+            VertexTextured(glm::vec3(-1,-1,0), glm::vec2(0, 0)),
+            VertexTextured(glm::vec3(1,-1,0), glm::vec2(1, 0)),
+            VertexTextured(glm::vec3(-1,-1,0), glm::vec2(0, 0)),
+            VertexTextured(glm::vec3(1,1,0), glm::vec2(1, 1)),
+            VertexTextured(glm::vec3(-1,1,0), glm::vec2(0, 1))};
+    return quad;
+}
@@ -34,35 +34,146 @@
 #define GRIDRENDERER_HPP_
 
 #include <vector>
+#include <GL/glew.h>
 #include <Math/Geometry/AABB2.hpp>
 #include <Graphics/Shader/ShaderManager.hpp>
 #include <Graphics/Texture/TextureManager.hpp>
 #include <Graphics/Renderer.hpp>
+#include <Graphics/Buffers/FBO.hpp>
 #include <Graphics/Mesh/Vertex.hpp>
 #include "GridPredictor.hpp"
+#include "GuideParameters.hpp"
 #include "FrameData.hpp"
+#include "ColorLut.hpp"
+#include "TileChangeDetector.hpp"
+#include "MemoryAccounting.hpp"
+
+//! \return The largest centered rectangle (in normalized device coordinates) with the aspect ratio of the image
+sgl::AABB2 getRenderRect(sgl::TexturePtr& imageTexture);
+sgl::AABB2 getRenderRect(float imageRatio);
 
 //! Used for rendering an image with a filter applied
 class GridRenderer
 {
 public:
     GridRenderer();
-    //! \param path: Path to folder containing effect data
-    void initialize(const std::string& path);
+    ~GridRenderer();
+    /*!
+     * The previously loaded model is released first.
+     * \param path: Path to folder containing effect data
+     * \return false if the model couldn't be loaded (e.g. if it doesn't fit into the memory budget).
+     */
+    bool initialize(const std::string& path);
+    /*!
+     * The part of initialize without OpenGL calls, so it can run in a background thread (e.g. during the cold
+     * start, see StartupLoader): Creates the TensorFlow session, runs the first inference and loads the guide.
+     * \param checkMemoryBudget: See GridPredictor::loadGraph (must be false on background threads).
+     */
+    static bool loadModel(
+            const std::string& path, GridPredictorPtr& gridPredictor, GuideParameters& guide,
+            bool checkMemoryBudget = true);
+    //! Uses a model loaded with loadModel (creates the grid textures, so it has to be called on the main thread).
+    void setModel(const GridPredictorPtr& gridPredictor, const GuideParameters& guide);
+    //! \return Whether a model was loaded successfully (by initialize or setModel).
+    bool hasModel() { return bool(gridPredictor); }
     //! Renders imageTexture with filter applied. Transform coefficients are predicted using lowresImage.
     void renderTransformedImage(sgl::TexturePtr& imageTexture, FrameDataPtr& lowresImage);
     //! Renders imageTexture normally (no filter applied).
     void renderNormalImage(sgl::TexturePtr& imageTexture, FrameDataPtr& lowresImage);
 
+    //! Predicts the transform coefficients using lowresImage and uploads them to the grid textures.
+    bool predictGrid(FrameDataPtr& lowresImage);
+    //! Uploads a grid predicted elsewhere (e.g. loaded from a file). Its size must match the loaded graph.
+    void uploadGrid(const GridCoefficients& grid);
+    //! Renders imageTexture with filter applied using the grid of the last call to predictGrid/uploadGrid.
+    void renderSlicedImage(sgl::TexturePtr& imageTexture);
+    /*!
+     * Renders imageTexture with filter applied at its own resolution and reads the result back.
+     * \param pixels: Destination of the 32-bit RGBA image (rows in the same order as in imageTexture)
+     */
+    void renderSlicedImageToMemory(sgl::TexturePtr& imageTexture, uint8_t *pixels);
+    /*!
+     * Incremental slicing for mostly static scenes: frame is the data uploaded to the image texture. Has to be
+     * called for every new frame before the frame data is released (see FrameSource::releaseFrame).
+     */
+    void detectChangedTiles(const FrameData& frame);
+    /*!
+     * Slices only the tiles that changed since the last call (all tiles if the grid changed) into an output
+     * texture at image resolution, which is then drawn to the screen. The render scale isn't used.
+     */
+    void renderSlicedImageIncremental(sgl::TexturePtr& imageTexture);
+    TileChangeDetector& getTileChangeDetector() { return tileChangeDetector; }
+    //! \return Whether predictGrid was called successfully since the last call to initialize.
+    bool hasGrid() { return gridValid; }
+
+    //! Uploads a color LUT baked from a model (see LutBaker) for use with renderLutImage.
+    void setColorLut(const ColorLut& lut);
+    bool hasColorLut() { return bool(lutTexture); }
+    //! Renders imageTexture with the color LUT applied (no inference and no grid needed).
+    void renderLutImage(sgl::TexturePtr& imageTexture);
+
+    /*!
+     * Sets the layout of the image textures passed to the render functions (see YuvFrame).
+     * FRAME_FORMAT_YUYV: RGBA8 texture of half the image width. FRAME_FORMAT_NV12: R8 luma texture and
+     * an RG8 texture of half the resolution (chromaTexture) with the interleaved U V samples.
+     */
+    void setInputFormat(FrameFormat format, const sgl::TexturePtr& chromaTexture = sgl::TexturePtr());
+    //! \return The size of the image stored in imageTexture in pixels (depends on the input format).
+    glm::ivec2 getImageSize(sgl::TexturePtr& imageTexture);
+
+    //! Fraction of the display resolution the slicing pass renders at (the result is upscaled).
+    void setRenderScale(float scale) { renderScale = scale; }
+    //! \return The GPU time of the slicing pass (measured a few frames ago to avoid pipeline stalls).
+    float getSlicingTimeMs() { return slicingTimeMs; }
+
+    //! Quad covering renderRect with the image mirrored horizontally (like a mirror for the webcam)
+    static std::vector<sgl::VertexTextured> createTexturedQuad(const sgl::AABB2& renderRect);
+    static std::vector<sgl::VertexTextured> createFullscreenQuad();
+    static void renderQuad(sgl::ShaderProgramPtr& shader, const std::vector<sgl::VertexTextured>& quad);
+
 private:
-    void loadGuideParameters(const std::string& path);
-    std::vector<sgl::VertexTextured> createTexturedQuad(const sgl::AABB2& renderRect);
+    void setGuideUniforms(const GuideParameters& guide);
+    void setGridRenderUniforms(sgl::TexturePtr& imageTexture);
+    void beginSlicingTimer();
+    void endSlicingTimer();
+    //! Reports the size of all textures of the renderer to MemoryAccounting (called when one is (re-)created)
+    void updateTextureMemory();
 
-    GridPredictor gridPredictor;
+    GridPredictorPtr gridPredictor;
     std::vector<sgl::TexturePtr> gridTextures;
+    bool gridValid;
 
     sgl::ShaderProgramPtr gridRenderShader;
     sgl::ShaderProgramPtr blitShader;
+    FrameFormat inputFormat;
+    sgl::TexturePtr chromaTexture;
+
+    // Color LUT approximation of the filter
+    sgl::ShaderProgramPtr lutRenderShader;
+    sgl::TexturePtr lutTexture;
+
+    // Reduced resolution rendering
+    float renderScale;
+    sgl::TexturePtr scaledOutputTexture;
+    sgl::FramebufferObjectPtr scaledOutputFbo;
+
+    // Output of the incremental slicing
+    TileChangeDetector tileChangeDetector;
+    sgl::TexturePtr tiledOutputTexture;
+    sgl::FramebufferObjectPtr tiledOutputFbo;
+    std::vector<glm::ivec4> changedTileRects;
+
+    // Full resolution rendering for read back
+    sgl::TexturePtr readbackTexture;
+    sgl::FramebufferObjectPtr readbackFbo;
+
+    // Double-buffered GPU timer queries for the slicing pass
+    GLuint slicingTimerQueries[2];
+    bool slicingTimerQueryIssued[2];
+    int slicingTimerQueryIndex;
+    float slicingTimeMs;
+
+    TrackedMemory textureMemory;
 };
 
 #endif /* GRIDRENDERER_HPP_ */
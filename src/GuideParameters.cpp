@@ -0,0 +1,83 @@
+/*
+ * Code for handling input files from: https://github.com/mgharbi/hdrnet/blob/master/benchmark/src/processor.cc
+ *
+ * Copyright 2016 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *
+ * License of other parts of the code:
+ *
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ */
+
+#include <fstream>
+#include <Utils/File/Logfile.hpp>
+#include "GuideParameters.hpp"
+
+using namespace sgl;
+
+bool loadBytesFromFile(const std::string& filename, int bytes, char *buffer) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if(!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in loadFileContent: Couldn't load file \"" + filename + "\".");
+        return false;
+    }
+    file.read(buffer, bytes);
+    file.close();
+    return true;
+}
+
+GuideParameters::GuideParameters() : ccm(1.0f), mixMatrix(0.0f) {
+}
+
+bool GuideParameters::load(const std::string& path) {
+    bool success = true;
+    success = loadBytesFromFile(
+            std::string() + path + "guide_ccm_f32_3x4.bin", sizeof(glm::mat3x4), (char*)&ccm) && success;
+    success = loadBytesFromFile(
+            std::string() + path + "guide_mix_matrix_f32_1x4.bin", sizeof(glm::vec4), (char*)&mixMatrix) && success;
+    success = loadBytesFromFile(
+            std::string() + path + "guide_shifts_f32_16x3.bin", 16*3*sizeof(float), (char*)shifts) && success;
+    success = loadBytesFromFile(
+            std::string() + path + "guide_slopes_f32_16x3.bin", 16*3*sizeof(float), (char*)slopes) && success;
+    return success;
+}
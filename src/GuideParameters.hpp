@@ -0,0 +1,68 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUIDEPARAMETERS_HPP_
+#define GUIDEPARAMETERS_HPP_
+
+#include <string>
+#include <glm/glm.hpp>
+
+//! Number of piecewise linear segments of the guidance map curves
+const int NUM_GUIDE_SEGMENTS = 16;
+
+/**
+ * Parameters of the guidance map computing the grid depth coordinate from a full resolution pixel.
+ * See https://github.com/mgharbi/hdrnet/blob/master/benchmark/src/renderer.cc for more details.
+ */
+struct GuideParameters {
+public:
+    GuideParameters();
+    //! \param path: Path to folder containing effect data. \return false if a file couldn't be read.
+    bool load(const std::string& path);
+
+    //! \param color: RGB color with alpha = 1. \return The guidance value (i.e., the depth in the grid).
+    inline float computeGuidance(const glm::vec4& color) const {
+        glm::vec3 temp = color * ccm;
+        glm::vec3 acc(0.0f);
+        for (int i = 0; i < NUM_GUIDE_SEGMENTS; ++i) {
+            acc += slopes[i] * glm::max(glm::vec3(0.0f), temp - shifts[i]);
+        }
+        return glm::clamp(glm::dot(mixMatrix, glm::vec4(acc, 1.0f)), 0.0f, 1.0f);
+    }
+
+    glm::mat3x4 ccm;
+    glm::vec4 mixMatrix;
+    glm::vec3 shifts[NUM_GUIDE_SEGMENTS];
+    glm::vec3 slopes[NUM_GUIDE_SEGMENTS];
+};
+
+#endif /* GUIDEPARAMETERS_HPP_ */
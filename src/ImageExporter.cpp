@@ -0,0 +1,282 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <boost/filesystem.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "GridFile.hpp"
+#include "ImageUtils.hpp"
+#include "MemoryAccounting.hpp"
+#include "ImageExporter.hpp"
+
+using namespace sgl;
+
+static double getTimeMs() {
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ImageExporter::ImageExporter(const ImageExportSettings& settings)
+        : settings(settings), numInferenceRuns(0), inferenceTimeMs(0.0), slicingTimeMs(0.0), ioTimeMs(0.0) {
+    if (!settings.gridCacheDirectory.empty()) {
+        gridCache = boost::shared_ptr<GridCache>(new GridCache(settings.gridCacheDirectory));
+    }
+}
+
+bool ImageExporter::run() {
+    if (!settings.lutFilename.empty()) {
+        if (!colorLut.loadCubeFile(settings.lutFilename)) {
+            return false;
+        }
+    } else {
+        GuideParameters guide;
+        if (!guide.load(settings.modelPath)) {
+            return false;
+        }
+        cpuSlicer.setGuideParameters(guide);
+    }
+
+    boost::system::error_code errorCode;
+    boost::filesystem::create_directories(settings.outputDirectory, errorCode);
+    std::vector<std::string> inputFiles = collectImageFiles(settings.inputPaths);
+    if (inputFiles.empty()) {
+        Logfile::get()->writeError("ERROR in ImageExporter::run: No input images specified.");
+        return false;
+    }
+
+    double startTime = getTimeMs();
+    int numFailed = 0;
+    for (size_t i = 0; i < inputFiles.size(); i++) {
+        if (!exportImage(inputFiles.at(i))) {
+            numFailed++;
+        }
+        if (MemoryAccounting::get()->hasBudgetFailure()) {
+            // Fails fast instead of trying the remaining images (the report was logged by MemoryAccounting)
+            numFailed += int(inputFiles.size() - i - 1);
+            break;
+        }
+    }
+    double totalTimeMs = getTimeMs() - startTime;
+
+    std::stringstream summary;
+    summary << std::fixed << std::setprecision(2);
+    summary << "Exported " << (inputFiles.size() - numFailed) << " of " << inputFiles.size() << " images in "
+            << totalTimeMs / 1000.0 << " s (" << numInferenceRuns << " inference runs";
+    if (gridCache) {
+        summary << ", " << gridCache->getNumHits() << " cached grids";
+    }
+    summary << ", " << (settings.renditions.size() + 1) << " rendition(s) per image)" << std::endl;
+    summary << "Time: inference " << inferenceTimeMs << " ms, slicing " << slicingTimeMs
+            << " ms, image I/O " << ioTimeMs << " ms (not overlapped with slicing)" << std::endl;
+    summary << MemoryAccounting::get()->getSummary();
+    Logfile::get()->writeInfo(summary.str());
+    return numFailed == 0;
+}
+
+GridCoefficientsPtr ImageExporter::getGrid(const FrameDataPtr& lowresImage, uint64_t contentHash) {
+    if (gridCache) {
+        GridCoefficientsPtr grid = gridCache->lookup(contentHash, settings.modelPath);
+        if (grid) {
+            return grid;
+        }
+    }
+
+    // Only create the TensorFlow session once it is actually needed
+    if (!gridPredictor) {
+        gridPredictor = GridPredictorPtr(new GridPredictor);
+        if (!gridPredictor->loadGraph(settings.modelPath)) {
+            return GridCoefficientsPtr();
+        }
+    }
+
+    double startTime = getTimeMs();
+    GridCoefficientsPtr grid = gridPredictor->computeGridCoefficients(*lowresImage);
+    inferenceTimeMs += getTimeMs() - startTime;
+    numInferenceRuns++;
+    if (!grid) {
+        return GridCoefficientsPtr();
+    }
+
+    if (gridCache) {
+        gridCache->store(contentHash, settings.modelPath, *grid);
+    }
+    return grid;
+}
+
+bool ImageExporter::exportImage(const std::string& inputFilename) {
+    double startTime = getTimeMs();
+    FrameData input;
+    if (!loadImageFile(inputFilename, input)) {
+        return false;
+    }
+    ioTimeMs += getTimeMs() - startTime;
+    if (!MemoryAccounting::get()->checkBudget("ImageExporter::exportImage")) {
+        return false;
+    }
+
+    // The LUT approximation needs neither the network nor a grid
+    uint64_t contentHash = 0;
+    GridCoefficientsPtr grid;
+    if (colorLut.size == 0) {
+        FrameDataPtr lowresImage(new FrameData);
+        downscaleForInference(input, *lowresImage);
+        contentHash = GridCache::computeContentHash(*lowresImage, settings.modelPath);
+        grid = getGrid(lowresImage, contentHash);
+        if (!grid) {
+            return false;
+        }
+    }
+
+    std::string outputFilename = (boost::filesystem::path(settings.outputDirectory)
+            / boost::filesystem::path(inputFilename).stem()).string();
+    bool success = exportRenditions(input, grid.get(), outputFilename);
+    if (settings.saveGrids && grid) {
+        startTime = getTimeMs();
+        success = saveGridFile(outputFilename + GRID_FILE_EXTENSION, *grid, settings.modelPath, contentHash)
+                && success;
+        ioTimeMs += getTimeMs() - startTime;
+    }
+    return success;
+}
+
+bool ImageExporter::exportRenditions(
+        const FrameData& input, const GridCoefficients *grid, const std::string& outputFilename) {
+    std::vector<ExportRendition> renditions;
+    renditions.push_back(ExportRendition("", settings.outputSize));
+    renditions.insert(renditions.end(), settings.renditions.begin(), settings.renditions.end());
+    glm::ivec2 inputSize(input.w, input.h);
+    std::vector<glm::ivec2> sizes;
+    for (const ExportRendition& rendition : renditions) {
+        sizes.push_back(computeOutputSize(inputSize, rendition.size));
+    }
+    std::vector<size_t> order(renditions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sizes](size_t i, size_t j) {
+        return sizes[i].x * sizes[i].y > sizes[j].x * sizes[j].y;
+    });
+
+    // Resized input and output of each rendition (all of them stay allocated until the writers are done)
+    size_t renditionBytes = 0;
+    for (const glm::ivec2& size : sizes) {
+        renditionBytes += size_t(size.x) * size_t(size.y) * 4 * 2;
+    }
+    if (!MemoryAccounting::get()->ensureBudget(renditionBytes, "ImageExporter::exportRenditions")) {
+        return false;
+    }
+
+    // The grid is resolution independent, so the input is resized before slicing (i.e. smaller renditions are
+    // slices of a prefiltered input, not downscaled outputs). Each downscaled input is computed from the
+    // smallest larger one, so the downscaling cost stays small compared to slicing the largest rendition.
+    std::vector<FrameDataPtr> resizedInputs, outputs(renditions.size());
+    std::vector<std::thread> writerThreads;
+    std::vector<char> writeSuccess(renditions.size(), 0);
+    const FrameData *prefilteredInput = &input;
+    for (size_t i : order) {
+        double startTime = getTimeMs();
+        const glm::ivec2& size = sizes[i];
+        const FrameData *sliceInput = &input;
+        if (size != inputSize) {
+            bool downscaling = size.x <= prefilteredInput->w && size.y <= prefilteredInput->h;
+            FrameDataPtr resizedInput(new FrameData);
+            resizeImage(downscaling ? *prefilteredInput : input, *resizedInput, size.x, size.y);
+            resizedInputs.push_back(resizedInput);
+            sliceInput = resizedInput.get();
+        }
+        if (size.x <= input.w && size.y <= input.h) {
+            prefilteredInput = sliceInput;
+        }
+
+        outputs[i] = FrameDataPtr(new FrameData);
+        if (grid) {
+            cpuSlicer.slice(*sliceInput, *grid, *outputs[i]);
+        } else {
+            colorLut.apply(*sliceInput, *outputs[i]);
+        }
+        slicingTimeMs += getTimeMs() - startTime;
+
+        // Encoding (mostly single-threaded) overlaps with slicing the next rendition
+        std::string filename = outputFilename + renditions[i].suffix + settings.outputExtension;
+        FrameDataPtr output = outputs[i];
+        char *success = &writeSuccess[i];
+        writerThreads.push_back(std::thread([filename, output, success]() {
+            *success = saveImageFile(filename, *output);
+        }));
+    }
+
+    double startTime = getTimeMs();
+    for (std::thread& writerThread : writerThreads) {
+        writerThread.join();
+    }
+    ioTimeMs += getTimeMs() - startTime;
+    return std::find(writeSuccess.begin(), writeSuccess.end(), 0) == writeSuccess.end();
+}
+
+bool ImageExporter::renderFromGridFile(
+        const std::string& gridFilename, const std::string& inputFilename, const std::string& outputFilename,
+        const glm::ivec2& outputSize, const std::string& modelPath) {
+    std::string modelId;
+    uint64_t contentHash = 0;
+    GridCoefficientsPtr grid = loadGridFile(gridFilename, modelId, contentHash);
+    if (!grid) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in ImageExporter::renderFromGridFile: Couldn't load \"" + gridFilename + "\".");
+        return false;
+    }
+
+    GuideParameters guide;
+    if (!guide.load(modelPath.empty() ? modelId : modelPath)) {
+        return false;
+    }
+    CpuSlicer cpuSlicer;
+    cpuSlicer.setGuideParameters(guide);
+
+    FrameData input;
+    if (!loadImageFile(inputFilename, input)) {
+        return false;
+    }
+    glm::ivec2 size = computeOutputSize(glm::ivec2(input.w, input.h), outputSize);
+    FrameData resizedInput;
+    const FrameData *sliceInput = &input;
+    if (size != glm::ivec2(input.w, input.h)) {
+        resizeImage(input, resizedInput, size.x, size.y);
+        sliceInput = &resizedInput;
+    }
+
+    FrameData output;
+    cpuSlicer.slice(*sliceInput, *grid, output);
+    return saveImageFile(outputFilename, output);
+}
@@ -0,0 +1,114 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGEEXPORTER_HPP_
+#define IMAGEEXPORTER_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <glm/glm.hpp>
+#include "GridPredictor.hpp"
+#include "GridCache.hpp"
+#include "CpuSlicer.hpp"
+#include "ColorLut.hpp"
+
+//! Additional output image sliced from the grid of an exported image (e.g. a preview or thumbnail)
+struct ExportRendition {
+    ExportRendition() : size(0, 0) {}
+    ExportRendition(const std::string& suffix, const glm::ivec2& size) : suffix(suffix), size(size) {}
+    //! Appended to the file name of the image (e.g. "_thumb")
+    std::string suffix;
+    //! Same meaning as ImageExportSettings::outputSize
+    glm::ivec2 size;
+};
+
+struct ImageExportSettings {
+    ImageExportSettings() : outputSize(0, 0), saveGrids(false), outputExtension(".png") {}
+    //! Path to folder containing effect data (also used as model id of the grids)
+    std::string modelPath;
+    //! Image files or folders containing image files
+    std::vector<std::string> inputPaths;
+    std::string outputDirectory;
+    //! Size of the exported images (0 = size of the input image; one component 0 = keep aspect ratio)
+    glm::ivec2 outputSize;
+    //! Further sizes written next to each exported image. The network only runs once per image.
+    std::vector<ExportRendition> renditions;
+    //! Folder of the content-hash grid cache (empty = no cache)
+    std::string gridCacheDirectory;
+    //! Whether to save the grid next to each exported image
+    bool saveGrids;
+    std::string outputExtension;
+    //! Color LUT (.cube) applied instead of running the network (empty = full model)
+    std::string lutFilename;
+};
+
+/**
+ * Batch export of filtered images without a window. The network only runs for images whose grid isn't in
+ * the grid cache yet; the TensorFlow session isn't even created if all grids are cached.
+ */
+class ImageExporter {
+public:
+    explicit ImageExporter(const ImageExportSettings& settings);
+    //! \return false if an image couldn't be exported
+    bool run();
+
+    /*!
+     * Renders an image from a stored grid without running the network.
+     * \param modelPath: Folder containing the guide parameters (empty = model id stored in the grid file)
+     */
+    static bool renderFromGridFile(
+            const std::string& gridFilename, const std::string& inputFilename, const std::string& outputFilename,
+            const glm::ivec2& outputSize, const std::string& modelPath);
+
+private:
+    bool exportImage(const std::string& inputFilename);
+    /*!
+     * Slices all renditions (largest first) and writes them concurrently.
+     * \param grid: NULL if the color LUT is applied instead
+     */
+    bool exportRenditions(const FrameData& input, const GridCoefficients *grid, const std::string& outputFilename);
+    //! \return The grid from the cache or from the network
+    GridCoefficientsPtr getGrid(const FrameDataPtr& lowresImage, uint64_t contentHash);
+
+    ImageExportSettings settings;
+    GridPredictorPtr gridPredictor;
+    boost::shared_ptr<GridCache> gridCache;
+    CpuSlicer cpuSlicer;
+    ColorLut colorLut;
+
+    // Statistics
+    int numInferenceRuns;
+    double inferenceTimeMs, slicingTimeMs, ioTimeMs;
+};
+
+#endif /* IMAGEEXPORTER_HPP_ */
@@ -0,0 +1,126 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/opencv.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "ImageUtils.hpp"
+
+using namespace sgl;
+
+static bool isImageFile(const boost::filesystem::path& path) {
+    std::string extension = boost::algorithm::to_lower_copy(path.extension().string());
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".bmp"
+            || extension == ".tif" || extension == ".tiff" || extension == ".webp";
+}
+
+std::vector<std::string> collectImageFiles(const std::vector<std::string>& paths) {
+    std::vector<std::string> imageFiles;
+    for (const std::string& path : paths) {
+        if (!boost::filesystem::is_directory(path)) {
+            imageFiles.push_back(path);
+            continue;
+        }
+        std::vector<std::string> directoryFiles;
+        boost::filesystem::directory_iterator end;
+        for (boost::filesystem::directory_iterator it(path); it != end; ++it) {
+            if (boost::filesystem::is_regular_file(it->path()) && isImageFile(it->path())) {
+                directoryFiles.push_back(it->path().string());
+            }
+        }
+        std::sort(directoryFiles.begin(), directoryFiles.end());
+        imageFiles.insert(imageFiles.end(), directoryFiles.begin(), directoryFiles.end());
+    }
+    return imageFiles;
+}
+
+bool loadImageFile(const std::string& filename, FrameData& image) {
+    cv::Mat bgrMat = cv::imread(filename);
+    if (bgrMat.empty()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in loadImageFile: Couldn't load image \"" + filename + "\".");
+        return false;
+    }
+
+    image.allocate(bgrMat.cols, bgrMat.rows);
+    cv::Mat rgbaMat(bgrMat.rows, bgrMat.cols, CV_8UC4, image.pixels);
+#if (CV_VERSION_MAJOR <= 2)
+    cv::cvtColor(bgrMat, rgbaMat, CV_BGR2RGBA, 4);
+#else
+    cv::cvtColor(bgrMat, rgbaMat, cv::COLOR_BGR2RGBA, 4);
+#endif
+    return true;
+}
+
+bool saveImageFile(const std::string& filename, const FrameData& image) {
+    cv::Mat rgbaMat(image.h, image.w, CV_8UC4, image.pixels);
+    cv::Mat bgrMat;
+#if (CV_VERSION_MAJOR <= 2)
+    cv::cvtColor(rgbaMat, bgrMat, CV_RGBA2BGR, 3);
+#else
+    cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR, 3);
+#endif
+    if (!cv::imwrite(filename, bgrMat)) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in saveImageFile: Couldn't save image \"" + filename + "\".");
+        return false;
+    }
+    return true;
+}
+
+void resizeImage(const FrameData& input, FrameData& output, int width, int height) {
+    output.allocate(width, height);
+    cv::Mat inputMat(input.h, input.w, CV_8UC4, input.pixels);
+    cv::Mat outputMat(height, width, CV_8UC4, output.pixels);
+    bool downscaling = width <= input.w && height <= input.h;
+    cv::resize(inputMat, outputMat, cv::Size(width, height), 0, 0, downscaling ? cv::INTER_AREA : cv::INTER_CUBIC);
+}
+
+void downscaleForInference(const FrameData& input, FrameData& lowresImage) {
+    resizeImage(input, lowresImage, NETWORK_INPUT_SIZE, NETWORK_INPUT_SIZE);
+}
+
+glm::ivec2 computeOutputSize(const glm::ivec2& inputSize, const glm::ivec2& requestedSize) {
+    if (requestedSize.x <= 0 && requestedSize.y <= 0) {
+        return inputSize;
+    }
+    if (requestedSize.y <= 0) {
+        return glm::ivec2(requestedSize.x, std::max(requestedSize.x * inputSize.y / inputSize.x, 1));
+    }
+    if (requestedSize.x <= 0) {
+        return glm::ivec2(std::max(requestedSize.y * inputSize.x / inputSize.y, 1), requestedSize.y);
+    }
+    return requestedSize;
+}
@@ -0,0 +1,60 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IMAGEUTILS_HPP_
+#define IMAGEUTILS_HPP_
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+
+//! Width/height of the network input
+const int NETWORK_INPUT_SIZE = 256;
+
+//! \return The files in paths, where directories are replaced by the image files they contain (sorted by name).
+std::vector<std::string> collectImageFiles(const std::vector<std::string>& paths);
+//! Loads an image file (any format supported by OpenCV) as 32-bit RGBA image.
+bool loadImageFile(const std::string& filename, FrameData& image);
+//! Saves a 32-bit RGBA image (the format is determined by the file extension, alpha is dropped).
+bool saveImageFile(const std::string& filename, const FrameData& image);
+//! Resizes input to width x height (area filter when downscaling, cubic filter when upscaling).
+void resizeImage(const FrameData& input, FrameData& output, int width, int height);
+//! Downscales input to the 256x256 input of the network.
+void downscaleForInference(const FrameData& input, FrameData& lowresImage);
+/*!
+ * \param requestedSize: Size requested by the user. If a component is 0, the aspect ratio of the input
+ * image is kept (if both are 0, the input size is used).
+ */
+glm::ivec2 computeOutputSize(const glm::ivec2& inputSize, const glm::ivec2& requestedSize);
+
+#endif /* IMAGEUTILS_HPP_ */
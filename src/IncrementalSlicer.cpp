@@ -0,0 +1,77 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "Tracer.hpp"
+#include "IncrementalSlicer.hpp"
+
+IncrementalSlicer::IncrementalSlicer(const CpuSlicer& cpuSlicer, int tileSize, float changeThreshold)
+        : cpuSlicer(cpuSlicer), tileChangeDetector(tileSize, 1e-3f, changeThreshold) {
+}
+
+const FrameData& IncrementalSlicer::slice(const FrameData& input, const GridCoefficients& grid) {
+    TRACE_SCOPE("IncrementalSlicer::slice");
+    if (output.w != input.w || output.h != input.h) {
+        output.allocate(input.w, input.h);
+        tileChangeDetector.invalidate();
+    }
+    tileChangeDetector.update(input);
+    tileChangeDetector.updateGrid(grid);
+    tileChangeDetector.getChangedTileRects(changedRects);
+
+    // The rectangles are distributed dynamically, as they differ in size
+    int numThreads = std::min(cpuSlicer.getNumThreads(), int(changedRects.size()));
+    std::atomic<size_t> nextRectIndex(0);
+    auto sliceRects = [this, &input, &grid, &nextRectIndex]() {
+        size_t rectIndex;
+        while ((rectIndex = nextRectIndex++) < changedRects.size()) {
+            const glm::ivec4& rect = changedRects[rectIndex];
+            cpuSlicer.sliceRegion(input, grid, output, rect.x, rect.y, rect.z, rect.w);
+        }
+    };
+    if (numThreads <= 1) {
+        sliceRects();
+    } else {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < numThreads; i++) {
+            threads.push_back(std::thread(sliceRects));
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    tileChangeDetector.markSliced();
+    return output;
+}
@@ -0,0 +1,63 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INCREMENTALSLICER_HPP_
+#define INCREMENTALSLICER_HPP_
+
+#include "CpuSlicer.hpp"
+#include "TileChangeDetector.hpp"
+
+/**
+ * Slices frames of a mostly static sequence (e.g. a surveillance camera) on the CPU. The output of the last
+ * frame is kept, and only the tiles whose input changed are sliced again (all tiles if the grid changed).
+ */
+class IncrementalSlicer {
+public:
+    /*!
+     * \param cpuSlicer: Used for slicing the changed tiles (with its guide parameters and threads)
+     * \param changeThreshold: See TileChangeDetector
+     */
+    explicit IncrementalSlicer(const CpuSlicer& cpuSlicer, int tileSize = 64, float changeThreshold = 3.0f);
+    //! \return The sliced frame. Stays valid until the next call.
+    const FrameData& slice(const FrameData& input, const GridCoefficients& grid);
+    //! Slices all tiles with the next call (e.g. after the guide parameters of the slicer changed).
+    void invalidate() { tileChangeDetector.invalidate(); }
+    const TileChangeDetector& getTileChangeDetector() const { return tileChangeDetector; }
+
+private:
+    const CpuSlicer& cpuSlicer;
+    TileChangeDetector tileChangeDetector;
+    FrameData output;
+    std::vector<glm::ivec4> changedRects;
+};
+
+#endif /* INCREMENTALSLICER_HPP_ */
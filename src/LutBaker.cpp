@@ -0,0 +1,211 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <Utils/File/Logfile.hpp>
+#include "ImageUtils.hpp"
+#include "LutBaker.hpp"
+
+using namespace sgl;
+
+//! Calibration images are downscaled to this size (longer side) to keep baking and evaluation fast
+const int MAX_CALIBRATION_IMAGE_SIZE = 512;
+
+static double getTimeMs() {
+    return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LutBaker::LutBaker(const std::string& modelPath, int lutSize) : modelPath(modelPath), lutSize(lutSize),
+        cpuSlicer(1), offsetSums(size_t(lutSize) * size_t(lutSize) * size_t(lutSize), glm::vec3(0.0f)),
+        weightSums(size_t(lutSize) * size_t(lutSize) * size_t(lutSize), 0.0f), modelTimeMs(0.0) {
+}
+
+bool LutBaker::loadModel() {
+    GuideParameters guide;
+    if (!guide.load(modelPath)) {
+        return false;
+    }
+    cpuSlicer.setGuideParameters(guide);
+    gridPredictor = GridPredictorPtr(new GridPredictor);
+    // Single-threaded like ColorLut::apply, so that the reported speedup compares the same amount of compute
+    return gridPredictor->loadGraph(modelPath, 1);
+}
+
+bool LutBaker::addCalibrationImage(const std::string& filename) {
+    FrameDataPtr input(new FrameData);
+    if (!loadImageFile(filename, *input)) {
+        return false;
+    }
+    glm::ivec2 size(input->w, input->h);
+    if (std::max(size.x, size.y) > MAX_CALIBRATION_IMAGE_SIZE) {
+        glm::ivec2 requestedSize = size.x >= size.y
+                ? glm::ivec2(MAX_CALIBRATION_IMAGE_SIZE, 0) : glm::ivec2(0, MAX_CALIBRATION_IMAGE_SIZE);
+        size = computeOutputSize(size, requestedSize);
+        FrameDataPtr resizedInput(new FrameData);
+        resizeImage(*input, *resizedInput, size.x, size.y);
+        input = resizedInput;
+    }
+
+    // Full model: downscaling, inference and slicing
+    double startTime = getTimeMs();
+    FrameDataPtr lowresImage(new FrameData);
+    downscaleForInference(*input, *lowresImage);
+    GridCoefficientsPtr grid = gridPredictor->computeGridCoefficients(*lowresImage);
+    if (!grid) {
+        return false;
+    }
+    FrameDataPtr output(new FrameData);
+    cpuSlicer.slice(*input, *grid, *output);
+    modelTimeMs += getTimeMs() - startTime;
+
+    // Splat the offsets into the eight surrounding LUT entries
+    const float scale = float(lutSize - 1);
+    size_t numPixels = size_t(input->w) * size_t(input->h);
+    for (size_t i = 0; i < numPixels; i++) {
+        const uint8_t *inputPixel = input->pixels + i*4;
+        const uint8_t *outputPixel = output->pixels + i*4;
+        glm::vec3 inputColor = glm::vec3(inputPixel[0], inputPixel[1], inputPixel[2]) / 255.0f;
+        glm::vec3 offset = glm::vec3(outputPixel[0], outputPixel[1], outputPixel[2]) / 255.0f - inputColor;
+
+        glm::vec3 position = inputColor * scale;
+        glm::ivec3 index0 = glm::min(glm::ivec3(position), glm::ivec3(lutSize - 2));
+        glm::vec3 weight = position - glm::vec3(index0);
+        for (int corner = 0; corner < 8; corner++) {
+            int dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+            float cornerWeight = (dx ? weight.x : 1.0f - weight.x) * (dy ? weight.y : 1.0f - weight.y)
+                    * (dz ? weight.z : 1.0f - weight.z);
+            size_t entry = size_t(index0.x + dx + lutSize * (index0.y + dy + lutSize * (index0.z + dz)));
+            offsetSums[entry] += cornerWeight * offset;
+            weightSums[entry] += cornerWeight;
+        }
+    }
+
+    calibrationInputs.push_back(input);
+    modelOutputs.push_back(output);
+    return true;
+}
+
+ColorLut LutBaker::bake() const {
+    // Average offset of every entry with sufficient support
+    const float minWeight = 1e-3f;
+    size_t numEntries = offsetSums.size();
+    std::vector<glm::vec3> offsets(numEntries, glm::vec3(0.0f));
+    std::vector<bool> known(numEntries, false);
+    size_t numKnown = 0;
+    for (size_t i = 0; i < numEntries; i++) {
+        if (weightSums[i] > minWeight) {
+            offsets[i] = offsetSums[i] / weightSums[i];
+            known[i] = true;
+            numKnown++;
+        }
+    }
+
+    // Grow the known region by one layer per iteration (mean offset of the known 6-neighbors).
+    // If there are no known entries at all, the identity transform remains.
+    while (numKnown > 0 && numKnown < numEntries) {
+        std::vector<glm::vec3> newOffsets = offsets;
+        std::vector<bool> newKnown = known;
+        for (int b = 0; b < lutSize; b++) {
+            for (int g = 0; g < lutSize; g++) {
+                for (int r = 0; r < lutSize; r++) {
+                    size_t entry = size_t(r + lutSize * (g + lutSize * b));
+                    if (known[entry]) {
+                        continue;
+                    }
+                    const int neighbors[6][3] = { {-1,0,0}, {1,0,0}, {0,-1,0}, {0,1,0}, {0,0,-1}, {0,0,1} };
+                    glm::vec3 offsetSum(0.0f);
+                    int numNeighbors = 0;
+                    for (int n = 0; n < 6; n++) {
+                        int nr = r + neighbors[n][0], ng = g + neighbors[n][1], nb = b + neighbors[n][2];
+                        if (nr < 0 || ng < 0 || nb < 0 || nr >= lutSize || ng >= lutSize || nb >= lutSize) {
+                            continue;
+                        }
+                        size_t neighborEntry = size_t(nr + lutSize * (ng + lutSize * nb));
+                        if (known[neighborEntry]) {
+                            offsetSum += offsets[neighborEntry];
+                            numNeighbors++;
+                        }
+                    }
+                    if (numNeighbors > 0) {
+                        newOffsets[entry] = offsetSum / float(numNeighbors);
+                        newKnown[entry] = true;
+                        numKnown++;
+                    }
+                }
+            }
+        }
+        offsets.swap(newOffsets);
+        known.swap(newKnown);
+    }
+
+    ColorLut lut(lutSize);
+    for (size_t i = 0; i < numEntries; i++) {
+        lut.entries[i] = glm::clamp(lut.entries[i] + offsets[i], glm::vec3(0.0f), glm::vec3(1.0f));
+    }
+    return lut;
+}
+
+LutApproximationError LutBaker::evaluate(const ColorLut& lut) const {
+    LutApproximationError error;
+    error.modelTimeMs = modelTimeMs;
+    double absoluteErrorSum = 0.0, squaredErrorSum = 0.0;
+    size_t numValues = 0;
+
+    for (size_t i = 0; i < calibrationInputs.size(); i++) {
+        FrameData lutOutput;
+        double startTime = getTimeMs();
+        lut.apply(*calibrationInputs.at(i), lutOutput);
+        error.lutTimeMs += getTimeMs() - startTime;
+
+        const FrameData& modelOutput = *modelOutputs.at(i);
+        size_t numPixels = size_t(modelOutput.w) * size_t(modelOutput.h);
+        for (size_t p = 0; p < numPixels; p++) {
+            for (int c = 0; c < 3; c++) {
+                double difference = double(lutOutput.pixels[p*4 + c]) - double(modelOutput.pixels[p*4 + c]);
+                absoluteErrorSum += std::abs(difference);
+                squaredErrorSum += difference * difference;
+            }
+        }
+        numValues += numPixels * 3;
+    }
+
+    if (numValues > 0) {
+        error.meanAbsoluteError = absoluteErrorSum / double(numValues);
+        double meanSquaredError = squaredErrorSum / double(numValues);
+        error.rootMeanSquareError = std::sqrt(meanSquaredError);
+        error.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+    }
+    return error;
+}
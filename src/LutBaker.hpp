@@ -0,0 +1,86 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LUTBAKER_HPP_
+#define LUTBAKER_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "GridPredictor.hpp"
+#include "CpuSlicer.hpp"
+#include "ColorLut.hpp"
+
+struct LutApproximationError {
+    LutApproximationError() : meanAbsoluteError(0.0), rootMeanSquareError(0.0), psnr(0.0),
+            modelTimeMs(0.0), lutTimeMs(0.0) {}
+    //! Errors of the LUT output compared to the output of the full model (on the scale 0-255)
+    double meanAbsoluteError, rootMeanSquareError, psnr;
+    /*!
+     * Processing time of all calibration images with the full model (downscaling, inference, slicing) and the LUT.
+     * Both run on a single thread.
+     */
+    double modelTimeMs, lutTimeMs;
+};
+
+/**
+ * Approximates the (locally varying) transform of a model by one global 3D color LUT. The model is run on a set
+ * of calibration images, and the output color of every pixel is splatted with trilinear weights into the LUT
+ * cells surrounding its input color. The LUT reproduces the average color transform over the calibration set.
+ * Cells not covered by any calibration pixel are extrapolated from their neighbors.
+ */
+class LutBaker {
+public:
+    //! \param modelPath: Path to folder containing effect data.
+    LutBaker(const std::string& modelPath, int lutSize = 33);
+    bool loadModel();
+    //! Runs the model on the image and accumulates its pixels. Large images are downscaled first.
+    bool addCalibrationImage(const std::string& filename);
+    int getNumCalibrationImages() const { return int(calibrationInputs.size()); }
+    ColorLut bake() const;
+    //! Compares the LUT against the model output on the calibration images (i.e., not on a held-out set).
+    LutApproximationError evaluate(const ColorLut& lut) const;
+
+private:
+    std::string modelPath;
+    int lutSize;
+    GridPredictorPtr gridPredictor;
+    CpuSlicer cpuSlicer;
+
+    //! Accumulated color offsets (output - input) and trilinear weights per LUT entry
+    std::vector<glm::vec3> offsetSums;
+    std::vector<float> weightSums;
+    std::vector<FrameDataPtr> calibrationInputs, modelOutputs;
+    double modelTimeMs;
+};
+
+#endif /* LUTBAKER_HPP_ */
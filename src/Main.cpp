@@ -31,13 +31,189 @@
  */
 
 #include <iostream>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
 #include <Utils/File/FileUtils.hpp>
+#include <Utils/File/Logfile.hpp>
 #include <Utils/AppSettings.hpp>
 #include <Graphics/Window.hpp>
 
+#ifndef _WIN32
+#include "EnhancementServer.hpp"
+#endif
+#include "CommandLine.hpp"
+#include "ImageExporter.hpp"
+#include "ImageUtils.hpp"
+#include "LutBaker.hpp"
+#include "VideoProcessor.hpp"
 #include "MainApp.hpp"
+#include "GridPredictor.hpp"
+#include "MemoryAccounting.hpp"
+#include "StartupLoader.hpp"
+#include "Tracer.hpp"
+
+//! Parses a size of the form WxH (e.g. 3840x2160 or 1920x0 to keep the aspect ratio).
+glm::ivec2 parseSize(const std::string& sizeString) {
+    glm::ivec2 size(0, 0);
+    size_t separatorPos = sizeString.find('x');
+    if (separatorPos != std::string::npos) {
+        size.x = std::atoi(sizeString.substr(0, separatorPos).c_str());
+        size.y = std::atoi(sizeString.substr(separatorPos + 1).c_str());
+    }
+    return size;
+}
+
+//! \return The model directory passed with --model (by default, the first filter of the viewer).
+std::string getModelPath(int argc, char *argv[]) {
+    std::string modelPath = getOption(
+            argc, argv, "--model",
+            sgl::AppSettings::get()->getDataDirectory() + "pretrained_models/photoshop/eboye/");
+    if (!modelPath.empty() && modelPath.back() != '/') {
+        modelPath += "/";
+    }
+    return modelPath;
+}
+
+#ifndef _WIN32
+EnhancementServer *enhancementServer = NULL;
+
+void stopEnhancementServer(int signal) {
+    if (enhancementServer) {
+        enhancementServer->stop();
+    }
+}
+
+int runEnhancementServer(int argc, char *argv[]) {
+    EnhancementServerSettings settings;
+    settings.socketPath = getOption(argc, argv, "--server");
+    settings.modelPath = getModelPath(argc, argv);
+    settings.maxBatchSize = std::atoi(getOption(argc, argv, "--max-batch", "8").c_str());
+    settings.batchWindowUs = std::atoi(getOption(argc, argv, "--batch-window-us", "2000").c_str());
+    settings.slicingThreads = std::atoi(getOption(argc, argv, "--slicing-threads", "1").c_str());
+    settings.reportIntervalS = std::atoi(getOption(argc, argv, "--report-interval", "10").c_str());
+
+    enhancementServer = new EnhancementServer(settings);
+    if (!enhancementServer->start()) {
+        delete enhancementServer;
+        return 1;
+    }
+    signal(SIGINT, stopEnhancementServer);
+    signal(SIGTERM, stopEnhancementServer);
+    enhancementServer->run();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    delete enhancementServer;
+    enhancementServer = NULL;
+    return 0;
+}
+#endif
+
+int runImageExport(int argc, char *argv[]) {
+    ImageExportSettings settings;
+    settings.modelPath = getModelPath(argc, argv);
+    settings.inputPaths = getOptionValues(argc, argv, "--input");
+    settings.outputDirectory = getOption(argc, argv, "--export");
+    settings.outputSize = parseSize(getOption(argc, argv, "--size"));
+    settings.gridCacheDirectory = getOption(argc, argv, "--grid-cache");
+    settings.saveGrids = hasOption(argc, argv, "--save-grids");
+    settings.outputExtension = "." + getOption(argc, argv, "--format", "png");
+    settings.lutFilename = getOption(argc, argv, "--lut");
+    // --rendition <name>:<WxH> writes <image>_<name> in addition (e.g. --rendition thumb:256x0)
+    for (const std::string& renditionString : getOptionValues(argc, argv, "--rendition")) {
+        size_t separatorPos = renditionString.find(':');
+        if (separatorPos == std::string::npos) {
+            std::cerr << "Usage: --rendition <name>:<WxH>" << std::endl;
+            return 1;
+        }
+        settings.renditions.push_back(ExportRendition(
+                "_" + renditionString.substr(0, separatorPos),
+                parseSize(renditionString.substr(separatorPos + 1))));
+    }
+
+    ImageExporter exporter(settings);
+    return exporter.run() ? 0 : 1;
+}
+
+int runGridRendering(int argc, char *argv[]) {
+    // The model is only needed for the guide parameters; by default, the model stored in the grid file is used
+    std::string modelPath;
+    if (hasOption(argc, argv, "--model")) {
+        modelPath = getModelPath(argc, argv);
+    }
+    bool success = ImageExporter::renderFromGridFile(
+            getOption(argc, argv, "--render-grid"), getOption(argc, argv, "--input"),
+            getOption(argc, argv, "--output"), parseSize(getOption(argc, argv, "--size")), modelPath);
+    return success ? 0 : 1;
+}
+
+int runLutBaking(int argc, char *argv[]) {
+    std::string lutFilename = getOption(argc, argv, "--bake-lut");
+    std::vector<std::string> calibrationFiles = collectImageFiles(getOptionValues(argc, argv, "--input"));
+    if (lutFilename.empty() || calibrationFiles.empty()) {
+        std::cerr << "Usage: hdrnetviewer --bake-lut <file.cube> --input <image or folder> [--input ...] "
+                  << "[--lut-size N] [--model <folder>]" << std::endl;
+        return 1;
+    }
+
+    std::string modelPath = getModelPath(argc, argv);
+    int lutSize = std::max(std::atoi(getOption(argc, argv, "--lut-size", "33").c_str()), 2);
+    LutBaker lutBaker(modelPath, lutSize);
+    if (!lutBaker.loadModel()) {
+        return 1;
+    }
+    for (const std::string& calibrationFile : calibrationFiles) {
+        lutBaker.addCalibrationImage(calibrationFile);
+    }
+    if (lutBaker.getNumCalibrationImages() == 0) {
+        sgl::Logfile::get()->writeError("ERROR in runLutBaking: No calibration image could be processed.");
+        return 1;
+    }
+
+    ColorLut lut = lutBaker.bake();
+    if (!lut.saveCubeFile(lutFilename, modelPath)) {
+        return 1;
+    }
+
+    LutApproximationError error = lutBaker.evaluate(lut);
+    char summary[512];
+    snprintf(summary, sizeof(summary),
+             "Baked %dx%dx%d LUT from %d images. Error compared to the model on the calibration images: "
+             "MAE %.2f, RMSE %.2f, PSNR %.2f dB. Single-threaded time: model %.1f ms, LUT %.1f ms (speedup %.1fx)",
+             lutSize, lutSize, lutSize, lutBaker.getNumCalibrationImages(), error.meanAbsoluteError,
+             error.rootMeanSquareError, error.psnr, error.modelTimeMs, error.lutTimeMs,
+             error.modelTimeMs / std::max(error.lutTimeMs, 1e-3));
+    sgl::Logfile::get()->writeInfo(summary);
+    std::cout << summary << std::endl;
+    return 0;
+}
+
+int runVideoProcessing(int argc, char *argv[]) {
+    VideoProcessingSettings settings;
+    settings.modelPath = getModelPath(argc, argv);
+    settings.inputFilename = getOption(argc, argv, "--video");
+    settings.outputFilename = getOption(argc, argv, "--output");
+    settings.numWorkers = std::atoi(getOption(argc, argv, "--workers", "0").c_str());
+    settings.threadsPerWorker = std::max(std::atoi(getOption(argc, argv, "--threads-per-worker", "1").c_str()), 1);
+    settings.codec = getOption(argc, argv, "--codec", "MJPG");
+    settings.keepSegments = hasOption(argc, argv, "--keep-segments");
+    settings.incrementalSlicing = hasOption(argc, argv, "--incremental");
+    settings.tileChangeThreshold = float(std::atof(getOption(argc, argv, "--tile-threshold", "3").c_str()));
+    if (settings.outputFilename.empty()) {
+        std::cerr << "Usage: hdrnetviewer --video <input> --output <file> [--workers N] "
+                  << "[--threads-per-worker N] [--codec FOURCC] [--keep-segments] [--incremental] "
+                  << "[--tile-threshold T]" << std::endl;
+        return 1;
+    }
+
+    VideoProcessor videoProcessor(settings);
+    return videoProcessor.run() ? 0 : 1;
+}
 
 int main(int argc, char *argv[]) {
+    // Measures the cold start of the viewer (see StartupLoader::logMilestone)
+    StartupLoaderPtr startupLoader(new StartupLoader);
     sgl::FileUtils::get()->initialize("hdrnet-viewer", argc, argv);
 
     // Load the file containing the app settings
@@ -48,16 +224,82 @@ int main(int argc, char *argv[]) {
         sgl::AppSettings::get()->setDataDirectory(DATA_PATH);
     }
 #endif
+
+    // Record a trace from the start (written on exit)
+    std::string traceFile = getOption(argc, argv, "--trace");
+    Tracer::setThreadName("main");
+    if (!traceFile.empty()) {
+        Tracer::get()->start();
+    }
+
+    // Hard memory ceiling in MiB (e.g. when many instances run on one host)
+    int memoryBudgetMiB = std::atoi(getOption(argc, argv, "--memory-budget", "0").c_str());
+    if (memoryBudgetMiB > 0) {
+        MemoryAccounting::get()->setBudget(size_t(memoryBudgetMiB) * 1024 * 1024);
+        // The budget is checked against the memory TensorFlow actually allocated instead of estimates
+        GridPredictor::enableAllocatorStats();
+    }
+
+    // Headless modes (the trace is written when they return)
+    int exitCode = -1;
+    if (hasOption(argc, argv, "--server")) {
+#ifdef _WIN32
+        // The server uses Unix domain sockets (EnhancementServer.cpp isn't built on Windows)
+        sgl::Logfile::get()->writeError("ERROR in main: --server isn't supported on Windows.");
+        exitCode = 1;
+#else
+        exitCode = runEnhancementServer(argc, argv);
+#endif
+    } else if (hasOption(argc, argv, "--export")) {
+        exitCode = runImageExport(argc, argv);
+    } else if (hasOption(argc, argv, "--render-grid")) {
+        exitCode = runGridRendering(argc, argv);
+    } else if (hasOption(argc, argv, "--video")) {
+        exitCode = runVideoProcessing(argc, argv);
+    } else if (hasOption(argc, argv, "--bake-lut")) {
+        exitCode = runLutBaking(argc, argv);
+    }
+    if (exitCode >= 0) {
+        if (!traceFile.empty()) {
+            Tracer::get()->stop();
+            Tracer::get()->writeChromeTrace(traceFile);
+        }
+        return exitCode;
+    }
+
+    ViewerSettings viewerSettings;
+    viewerSettings.sharedMemoryInput = getOption(argc, argv, "--shm-input");
+    viewerSettings.sharedMemoryOutput = getOption(argc, argv, "--shm-output");
+    viewerSettings.sharedMemoryOutputSlots = std::max(
+            std::atoi(getOption(argc, argv, "--shm-output-slots", "4").c_str()), 2);
+    viewerSettings.traceFile = traceFile;
+    viewerSettings.lutFile = getOption(argc, argv, "--lut");
+    viewerSettings.nativeYuv = hasOption(argc, argv, "--native-yuv");
+
+    // The webcam is opened and the first filter is loaded while the window is created and the shaders are
+    // compiled (--serial-startup does everything one after another, e.g. for comparing the cold start times)
+    if (!hasOption(argc, argv, "--serial-startup")) {
+        bool openWebcam = viewerSettings.sharedMemoryInput.empty();
+        startupLoader->start(openWebcam, viewerSettings.nativeYuv, MainApp::getFilterPaths().front());
+    }
+
     sgl::AppSettings::get()->setLoadGUI();
 
     sgl::AppSettings::get()->createWindow();
     sgl::AppSettings::get()->initializeSubsystems();
+    startupLoader->logMilestone("window created");
 
-    sgl::AppLogic *app = new MainApp();
+    sgl::AppLogic *app = new MainApp(viewerSettings, startupLoader);
     app->run();
     delete app;
 
+    // Still recording if the trace wasn't saved with F9
+    if (!traceFile.empty() && Tracer::isEnabled()) {
+        Tracer::get()->stop();
+        Tracer::get()->writeChromeTrace(traceFile);
+    }
+
     sgl::AppSettings::get()->release();
 
-    return 0;
+    return MemoryAccounting::get()->hasBudgetFailure() ? 1 : 0;
 }
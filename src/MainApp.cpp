@@ -30,6 +30,9 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "Webcam.hpp"
+#include "Tracer.hpp"
+#include "PerfCounters.hpp"
 #include "MainApp.hpp"
 
 #include <ImGui/ImGuiWrapper.hpp>
@@ -54,23 +57,16 @@
 #include <Graphics/Texture/Bitmap.hpp>
 #include <GL/glew.h>
 #include <climits>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 
 void openglErrorCallback() {
     std::cerr << "Application callback" << std::endl;
 }
 
-MainApp::MainApp() {
-    sgl::EventManager::get()->addListener(sgl::RESOLUTION_CHANGED_EVENT,
-            [this](sgl::EventPtr event){ this->resolutionChanged(event); });
-    sgl::Renderer->setErrorCallback(&openglErrorCallback);
-    sgl::Renderer->setDebugVerbosity(sgl::DEBUG_OUTPUT_CRITICAL_ONLY);
-
-    // Webcam data
-    webcam.open();
-    frameImage = FrameDataPtr(new FrameData);
-    downscaledImage = FrameDataPtr(new FrameData);
-
-    filters = {
+std::vector<std::string> MainApp::getFilterPaths() {
+    std::vector<std::string> filters = {
             //"pretrained_models/photoshop/instagram/",
             "pretrained_models/photoshop/eboye/",
             "pretrained_models/faces/",
@@ -87,6 +83,35 @@ MainApp::MainApp() {
     for (std::string& filter : filters) {
         filter = sgl::AppSettings::get()->getDataDirectory() + filter;
     }
+    return filters;
+}
+
+MainApp::MainApp(const ViewerSettings& settings, const StartupLoaderPtr& startupLoader)
+        : settings(settings), startupLoader(startupLoader) {
+    sgl::EventManager::get()->addListener(sgl::RESOLUTION_CHANGED_EVENT,
+            [this](sgl::EventPtr event){ this->resolutionChanged(event); });
+    sgl::Renderer->setErrorCallback(&openglErrorCallback);
+    sgl::Renderer->setDebugVerbosity(sgl::DEBUG_OUTPUT_CRITICAL_ONLY);
+
+    // Webcam data (or frames shared by another process). The startup loader opens the webcam in the background.
+    bool parallelStartup = startupLoader && startupLoader->isStarted();
+    if (!settings.sharedMemoryInput.empty()) {
+        sharedMemorySource = boost::shared_ptr<SharedMemoryFrameSource>(new SharedMemoryFrameSource);
+        sharedMemorySource->open(settings.sharedMemoryInput);
+        frameSource = sharedMemorySource;
+    } else if (!parallelStartup) {
+        Webcam *webcam = new Webcam;
+        webcam->open(0, settings.nativeYuv);
+        frameSource = FrameSourcePtr(webcam);
+    }
+    captureResolution = qualityController.getCaptureResolution();
+    frameImage = FrameDataPtr(new FrameData);
+    downscaledImage = FrameDataPtr(new FrameData);
+    yuvFrame = YuvFramePtr(new YuvFrame);
+    useNativeYuv = settings.nativeYuv;
+
+    filters = getFilterPaths();
+    // Same order as the paths
     filterNames = {
             //"Instagram",
             "Eboye",
@@ -102,8 +127,21 @@ MainApp::MainApp() {
     };
     filterIndex = 0;
 
-    // Filter
-    gridRenderer.initialize(filters[filterIndex].c_str());
+    // Filter (the shaders were compiled by the constructor of the grid renderer)
+    if (parallelStartup) {
+        // The raw camera feed is shown until the startup loader has loaded the model
+        waitingForStartupModel = true;
+    } else {
+        gridRenderer.initialize(filters[filterIndex].c_str());
+    }
+    logStartupMilestone("viewer initialized");
+    if (!settings.lutFile.empty()) {
+        ColorLut lut;
+        if (lut.loadCubeFile(settings.lutFile)) {
+            gridRenderer.setColorLut(lut);
+            useColorLut = true;
+        }
+    }
 }
 
 MainApp::~MainApp() {
@@ -119,16 +157,42 @@ void MainApp::processSDLEvent(const SDL_Event &event) {
 }
 
 void MainApp::render() {
+    TRACE_SCOPE("MainApp::render");
     sgl::Window *window = sgl::AppSettings::get()->getMainWindow();
     glViewport(0, 0, window->getWidth(), window->getHeight());
 
-    if (webcam.readFrame(frameImage, downscaledImage)) {
-        if (!frameTexture) {
-            frameTexture = sgl::TextureManager->createEmptyTexture(frameImage->w, frameImage->h);
-            downscaledTexture = sgl::TextureManager->createEmptyTexture(downscaledImage->w, downscaledImage->h);
+    if (startupLoader) {
+        updateStartupLoading();
+    }
+    if (!frameSource) {
+        // The webcam is still being opened
+        sgl::Renderer->clearFramebuffer(GL_COLOR_BUFFER_BIT, sgl::Color(0, 0, 0));
+        renderGUI();
+        return;
+    }
+    updateCaptureResolution();
+
+    StageTimings timings;
+    // Comparisons and LUTs sample the frame with their own shaders, which only read RGBA textures
+    bool readYuv = useNativeYuv && !comparisonMode && !useColorLut && frameSource->supportsYuv();
+    bool newFrame = readYuv ? frameSource->readYuvFrame(yuvFrame, downscaledImage)
+            : frameSource->readFrame(frameImage, downscaledImage);
+    if (newFrame) {
+        TRACE_SCOPE("MainApp::uploadFrame");
+        uint64_t uploadStartTime = sgl::Timer->getTicksMicroseconds();
+        float &conversionTimeMs = readYuv ? yuvConversionTimeMs : rgbaConversionTimeMs;
+        conversionTimeMs = 0.9f * conversionTimeMs + 0.1f * frameSource->getLastConversionTimeMs();
+        if (readYuv) {
+            uploadYuvFrame();
+        } else {
+            uploadFrame();
         }
-        frameTexture->uploadPixelData(frameImage->w, frameImage->h, frameImage->pixels);
-        downscaledTexture->uploadPixelData(downscaledImage->w, downscaledImage->h, downscaledImage->pixels);
+        frameSource->releaseFrame();
+        timings.captureMs = frameSource->getLastConversionTimeMs()
+                + (sgl::Timer->getTicksMicroseconds() - uploadStartTime) / 1000.0f;
+        logStartupMilestone("first frame");
+    } else {
+        timings.captureMs = lastTimings.captureMs;
     }
 
     glm::mat4 newProjMat(sgl::matrixOrthogonalProjection(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f));
@@ -138,20 +202,223 @@ void MainApp::render() {
 
     sgl::Renderer->clearFramebuffer(GL_COLOR_BUFFER_BIT, sgl::Color(0, 0, 0));
 
-    if (frameTexture) {
+    bool rgbaFrame = frameFormat == FRAME_FORMAT_RGBA8;
+    if (frameTexture && comparisonMode && rgbaFrame) {
+        if (newFrame) {
+            comparisonRenderer->predictGrids(downscaledImage);
+        }
+        comparisonRenderer->render(frameTexture);
+        sgl::Renderer->errorCheck();
+    } else if (frameTexture) {
         if (sgl::Keyboard->isKeyDown(SDLK_SPACE)) {
             gridRenderer.renderNormalImage(frameTexture, downscaledImage);
+        } else if (useColorLut && rgbaFrame) {
+            gridRenderer.renderLutImage(frameTexture);
+            timings.slicingMs = gridRenderer.getSlicingTimeMs();
+            logStartupMilestone("first filtered frame");
+        } else if (!gridRenderer.hasModel()) {
+            // Raw camera feed until the model is loaded (or if it couldn't be loaded)
+            gridRenderer.renderNormalImage(frameTexture, downscaledImage);
         } else {
-            gridRenderer.renderTransformedImage(frameTexture, downscaledImage);
+            // Between two inference runs, the grid of the last prediction is reused
+            if (newFrame && (qualityController.shouldRunInference() || !gridRenderer.hasGrid())) {
+                uint64_t inferenceStartTime = sgl::Timer->getTicksMicroseconds();
+                gridRenderer.predictGrid(downscaledImage);
+                timings.inferenceMs = (sgl::Timer->getTicksMicroseconds() - inferenceStartTime) / 1000.0f;
+                timings.inferenceRan = true;
+            }
+            if (gridRenderer.hasGrid()) {
+                gridRenderer.setRenderScale(qualityController.getRenderScale());
+                if (incrementalSlicing && tilesDetected) {
+                    gridRenderer.renderSlicedImageIncremental(frameTexture);
+                } else {
+                    gridRenderer.renderSlicedImage(frameTexture);
+                }
+                timings.slicingMs = gridRenderer.getSlicingTimeMs();
+                qualityController.update(timings);
+                logStartupMilestone("first filtered frame");
+                if (newFrame && !settings.sharedMemoryOutput.empty()) {
+                    writeOutputFrame();
+                }
+            }
         }
 
         sgl::Renderer->errorCheck();
     }
 
+    lastTimings = timings;
+    if (PerfCounters::isEnabled()) {
+        PerfCounters::get()->endFrame();
+    }
+    checkMemoryBudget();
     renderGUI();
 }
 
+void MainApp::updateStartupLoading() {
+    if (!frameSource) {
+        frameSource = startupLoader->takeFrameSource();
+    }
+    GridPredictorPtr gridPredictor;
+    GuideParameters guide;
+    if (startupLoader->takeModel(gridPredictor, guide)) {
+        // Dropped if another filter was selected in the meantime. The model was loaded without checking the
+        // memory budget (the reclaimers may only be called on the main thread), so this is done here.
+        if (waitingForStartupModel) {
+            if (MemoryAccounting::get()->ensureBudget(0, "MainApp::updateStartupLoading")) {
+                gridRenderer.setModel(gridPredictor, guide);
+            } else {
+                sgl::Logfile::get()->writeError(
+                        "ERROR in MainApp::updateStartupLoading: The model doesn't fit into the memory budget.");
+            }
+        }
+        waitingForStartupModel = false;
+    } else if (!startupLoader->isModelPending()) {
+        // Failed to load (see the log)
+        waitingForStartupModel = false;
+    }
+}
+
+void MainApp::logStartupMilestone(const std::string& name) {
+    if (startupLoader) {
+        startupLoader->logMilestone(name);
+    }
+}
+
+void MainApp::selectFilter(int index) {
+    filterIndex = index;
+    std::cout << filters[filterIndex] << std::endl;
+    // Replaces the model of the startup loader if it isn't loaded yet
+    waitingForStartupModel = false;
+    gridRenderer.initialize(filters[filterIndex]);
+}
+
+void MainApp::checkMemoryBudget() {
+    if (quitRequested) {
+        return;
+    }
+    // Also covers models that couldn't be loaded because of the budget (see GridPredictor::loadGraph)
+    if (MemoryAccounting::get()->checkBudget("MainApp::render")) {
+        return;
+    }
+    sgl::Logfile::get()->writeError("ERROR in MainApp::checkMemoryBudget: Memory budget exceeded, quitting.");
+    SDL_Event quitEvent;
+    quitEvent.type = SDL_QUIT;
+    SDL_PushEvent(&quitEvent);
+    quitRequested = true;
+}
+
+void MainApp::updateTextureMemory() {
+    size_t bytes = 0;
+    if (frameTexture) {
+        // R8 luma texture for NV12 frames, RGBA8 otherwise
+        size_t bytesPerTexel = frameFormat == FRAME_FORMAT_NV12 ? 1 : 4;
+        bytes += size_t(frameTexture->getW()) * size_t(frameTexture->getH()) * bytesPerTexel;
+    }
+    if (chromaTexture) {
+        // RG8
+        bytes += size_t(chromaTexture->getW()) * size_t(chromaTexture->getH()) * 2;
+    }
+    if (downscaledTexture) {
+        bytes += size_t(downscaledTexture->getW()) * size_t(downscaledTexture->getH()) * 4;
+    }
+    frameTextureMemory.set(bytes);
+}
+
+void MainApp::uploadFrame() {
+    if (!frameTexture || frameFormat != FRAME_FORMAT_RGBA8
+            || frameTexture->getW() != frameImage->w || frameTexture->getH() != frameImage->h) {
+        frameTexture = sgl::TextureManager->createEmptyTexture(frameImage->w, frameImage->h);
+        downscaledTexture = sgl::TextureManager->createEmptyTexture(downscaledImage->w, downscaledImage->h);
+        frameFormat = FRAME_FORMAT_RGBA8;
+        chromaTexture = sgl::TexturePtr();
+        gridRenderer.setInputFormat(frameFormat);
+        updateTextureMemory();
+    }
+    PERF_SCOPE("MainApp::uploadFrame", uint64_t(frameImage->w) * uint64_t(frameImage->h));
+    frameTexture->uploadPixelData(frameImage->w, frameImage->h, frameImage->pixels);
+    downscaledTexture->uploadPixelData(downscaledImage->w, downscaledImage->h, downscaledImage->pixels);
+    if (incrementalSlicing) {
+        gridRenderer.detectChangedTiles(*frameImage);
+        tilesDetected = true;
+    }
+    frameSize = glm::ivec2(frameImage->w, frameImage->h);
+    lastUploadBytes = size_t(frameImage->w) * size_t(frameImage->h) * 4;
+}
+
+void MainApp::uploadYuvFrame() {
+    int w = yuvFrame->w, h = yuvFrame->h;
+    // YUYV: Two pixels per RGBA texel. NV12: Full resolution luma and half resolution chroma texture.
+    int textureWidth = yuvFrame->format == FRAME_FORMAT_YUYV ? w / 2 : w;
+    if (!frameTexture || frameFormat != yuvFrame->format
+            || frameTexture->getW() != textureWidth || frameTexture->getH() != h) {
+        frameFormat = yuvFrame->format;
+        chromaTexture = sgl::TexturePtr();
+        if (frameFormat == FRAME_FORMAT_YUYV) {
+            frameTexture = sgl::TextureManager->createEmptyTexture(textureWidth, h);
+        } else {
+            sgl::TextureSettings settings;
+            settings.internalFormat = GL_R8;
+            frameTexture = sgl::TextureManager->createEmptyTexture(w, h, settings);
+            settings.internalFormat = GL_RG8;
+            chromaTexture = sgl::TextureManager->createEmptyTexture(w / 2, h / 2, settings);
+        }
+        downscaledTexture = sgl::TextureManager->createEmptyTexture(downscaledImage->w, downscaledImage->h);
+        gridRenderer.setInputFormat(frameFormat, chromaTexture);
+        updateTextureMemory();
+    }
+
+    PERF_SCOPE("MainApp::uploadYuvFrame", uint64_t(w) * uint64_t(h));
+    const uint8_t *luma = yuvFrame->getLumaPlane();
+    if (frameFormat == FRAME_FORMAT_YUYV) {
+        frameTexture->uploadPixelData(textureWidth, h, (void*)luma, sgl::PixelFormat(GL_RGBA, GL_UNSIGNED_BYTE));
+    } else {
+        // Rows of the 8-bit planes aren't necessarily 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        frameTexture->uploadPixelData(w, h, (void*)luma, sgl::PixelFormat(GL_RED, GL_UNSIGNED_BYTE));
+        chromaTexture->uploadPixelData(
+                w / 2, h / 2, (void*)yuvFrame->getChromaPlane(), sgl::PixelFormat(GL_RG, GL_UNSIGNED_BYTE));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    downscaledTexture->uploadPixelData(downscaledImage->w, downscaledImage->h, downscaledImage->pixels);
+    tilesDetected = false;
+    frameSize = glm::ivec2(w, h);
+    lastUploadBytes = yuvFrame->data.size();
+}
+
+void MainApp::updateCaptureResolution() {
+    glm::ivec2 requestedResolution = qualityController.getCaptureResolution();
+    if (requestedResolution == captureResolution) {
+        return;
+    }
+
+    if (frameSource->setResolution(requestedResolution) != requestedResolution) {
+        // Not supported by the camera, so go back to the previous capture resolution
+        qualityController.captureResolutionRejected();
+        frameSource->setResolution(qualityController.getCaptureResolution());
+    }
+    captureResolution = qualityController.getCaptureResolution();
+}
+
+void MainApp::writeOutputFrame() {
+    if (!outputRing.isOpen()) {
+        // The ring is sized for the first frame; consumers map it once
+        outputRing.create(
+                settings.sharedMemoryOutput, settings.sharedMemoryOutputSlots, frameSize.x, frameSize.y);
+    }
+    if (!outputRing.isOpen() || frameSize.x > outputRing.getMaxWidth()
+            || frameSize.y > outputRing.getMaxHeight()) {
+        return;
+    }
+
+    // Read back directly into the shared memory
+    uint8_t *outputPixels = outputRing.beginWrite();
+    gridRenderer.renderSlicedImageToMemory(frameTexture, outputPixels);
+    outputRing.commitWrite(frameSize.x, frameSize.y, FRAME_FORMAT_RGBA8, frameSource->getLastTimestampNs());
+    numOutputFrames++;
+}
+
 void MainApp::renderGUI() {
+    TRACE_SCOPE("MainApp::renderGUI");
     sgl::ImGuiWrapper::get()->renderStart();
 
     if (showSettingsWindow) {
@@ -168,28 +435,271 @@ void MainApp::renderGUI() {
 
             // Selection of displayed model
             if (ImGui::Combo("Filter", &filterIndex, filterNames.data(), filterNames.size())) {
-                std::cout << filters[filterIndex] << std::endl;
-                gridRenderer.initialize(filters[filterIndex].c_str());
+                selectFilter(filterIndex);
+            }
+            if (waitingForStartupModel) {
+                ImGui::Text("Loading filter...");
+            }
+
+            if (gridRenderer.hasColorLut()) {
+                ImGui::Checkbox("Use color LUT (no inference)", &useColorLut);
+            }
+            if (ImGui::Checkbox("Incremental slicing (tiles)", &incrementalSlicing)) {
+                // The tiles are hashed starting with the next frame. They are always sliced at full resolution.
+                tilesDetected = false;
+                qualityController.setRenderScaleEnabled(!incrementalSlicing);
+                gridRenderer.getTileChangeDetector().resetStatistics();
+            }
+            if (incrementalSlicing) {
+                TileChangeDetector& tileChangeDetector = gridRenderer.getTileChangeDetector();
+                float changeThreshold = tileChangeDetector.getChangeThreshold();
+                if (ImGui::SliderFloat("Tile change threshold", &changeThreshold, 0.0f, 16.0f, "%.1f")) {
+                    tileChangeDetector.setChangeThreshold(changeThreshold);
+                    tileChangeDetector.resetStatistics();
+                }
+                ImGui::Text("Re-sliced tiles: %.1f%%",
+                            gridRenderer.getTileChangeDetector().getChangedTileRatio() * 100.0);
+            }
+
+            ImGui::Separator();
+            renderComparisonGUI();
+
+            ImGui::Separator();
+            renderQualityControllerGUI();
+
+            if (settings.nativeYuv) {
+                ImGui::Separator();
+                renderNativeYuvGUI();
+            }
+
+            if (sharedMemorySource || outputRing.isOpen()) {
+                ImGui::Separator();
+                renderSharedMemoryGUI();
+            }
+
+            ImGui::Separator();
+            renderPerfCountersGUI();
+
+            ImGui::Separator();
+            renderMemoryGUI();
+
+            ImGui::Separator();
+            if (ImGui::Button(Tracer::isEnabled() ? "Stop and save trace (F9)" : "Record trace (F9)")) {
+                toggleTracing();
             }
         }
         ImGui::End();
     }
+    if (comparisonMode && frameTexture) {
+        renderComparisonLabels();
+    }
 
     sgl::ImGuiWrapper::get()->renderEnd();
 }
 
+void MainApp::renderComparisonGUI() {
+    bool filtersChanged = false;
+    if (ImGui::Checkbox("Compare filters", &comparisonMode)) {
+        filtersChanged = comparisonMode;
+    }
+    if (!comparisonMode) {
+        return;
+    }
+
+    filtersChanged = ImGui::SliderInt("Views", &numComparisonViews, 2, ComparisonRenderer::MAX_VIEWS)
+            || filtersChanged;
+    for (int i = 0; i < numComparisonViews; i++) {
+        std::string label = std::string() + "View " + sgl::toString(i + 1);
+        filtersChanged = ImGui::Combo(
+                label.c_str(), &comparisonFilterIndices[i], filterNames.data(), filterNames.size())
+                || filtersChanged;
+    }
+    if (filtersChanged) {
+        updateComparisonFilters();
+    }
+}
+
+void MainApp::updateComparisonFilters() {
+    if (!comparisonRenderer) {
+        comparisonRenderer = boost::shared_ptr<ComparisonRenderer>(new ComparisonRenderer);
+    }
+    std::vector<std::string> comparisonFilters;
+    for (int i = 0; i < numComparisonViews; i++) {
+        comparisonFilters.push_back(filters.at(comparisonFilterIndices[i] % int(filters.size())));
+    }
+    comparisonRenderer->setFilters(comparisonFilters);
+}
+
+void MainApp::renderComparisonLabels() {
+    ImDrawList *drawList = ImGui::GetForegroundDrawList();
+    for (int i = 0; i < comparisonRenderer->getNumViews(); i++) {
+        sgl::AABB2 viewRect = comparisonRenderer->getViewRect(frameTexture, i);
+        // Views of filters that couldn't be loaded are skipped, so the filter is looked up by its path
+        const std::string& filterPath = comparisonRenderer->getFilterPath(i);
+        size_t filterIndex = size_t(std::find(filters.begin(), filters.end(), filterPath) - filters.begin());
+        std::string filterName = filterIndex < filters.size() ? filterNames.at(filterIndex) : filterPath;
+        char label[256];
+        snprintf(label, sizeof(label), "%s (%.1f ms)", filterName.c_str(), comparisonRenderer->getInferenceTimeMs(i));
+        ImVec2 position(viewRect.min.x + 8.0f, viewRect.min.y + 8.0f);
+        ImVec2 textSize = ImGui::CalcTextSize(label);
+        drawList->AddRectFilled(
+                ImVec2(position.x - 4.0f, position.y - 2.0f),
+                ImVec2(position.x + textSize.x + 4.0f, position.y + textSize.y + 2.0f), IM_COL32(0, 0, 0, 160));
+        drawList->AddText(position, IM_COL32(255, 255, 255, 255), label);
+    }
+}
+
+void MainApp::renderQualityControllerGUI() {
+    bool adaptiveQuality = qualityController.isEnabled();
+    if (ImGui::Checkbox("Adaptive quality", &adaptiveQuality)) {
+        qualityController.setEnabled(adaptiveQuality);
+    }
+    float frameTimeBudget = qualityController.getFrameTimeBudget();
+    if (ImGui::SliderFloat("Frame budget (ms)", &frameTimeBudget, 2.0f, 100.0f, "%.1f")) {
+        qualityController.setFrameTimeBudget(frameTimeBudget);
+    }
+
+    glm::ivec2 resolution = qualityController.getCaptureResolution();
+    ImGui::Text("Render scale: %d%%", int(qualityController.getRenderScale() * 100.0f));
+    ImGui::Text("Inference every %d frame(s)", qualityController.getInferenceInterval());
+    ImGui::Text("Capture resolution: %dx%d", resolution.x, resolution.y);
+    if (qualityController.isEnabled()) {
+        ImGui::Text("Capture %.2f ms, inference %.2f ms, slicing %.2f ms",
+                    qualityController.getSmoothedCaptureTime(), qualityController.getSmoothedInferenceTime(),
+                    qualityController.getSmoothedSlicingTime());
+        ImGui::Text("Estimated frame time: %.2f ms", qualityController.getEstimatedFrameTime());
+        ImGui::Text("Last decision: %s", qualityController.getLastDecision().c_str());
+    } else {
+        ImGui::Text("Capture %.2f ms, inference %.2f ms, slicing %.2f ms",
+                    lastTimings.captureMs, lastTimings.inferenceMs, lastTimings.slicingMs);
+    }
+}
+
+void MainApp::renderNativeYuvGUI() {
+    if (!frameSource) {
+        ImGui::Text("Native YUV: Opening the camera...");
+        return;
+    }
+    if (!frameSource->supportsYuv()) {
+        ImGui::Text("Native YUV: Camera doesn't deliver raw YUYV/NV12 frames");
+        return;
+    }
+    ImGui::Checkbox("Native YUV frames", &useNativeYuv);
+    if (comparisonMode || useColorLut) {
+        ImGui::Text("(Comparisons and color LUTs use RGBA frames)");
+    }
+    size_t rgbaBytes = size_t(frameSize.x) * size_t(frameSize.y) * 4;
+    ImGui::Text("Upload: %.0f KiB/frame (RGBA: %.0f KiB)", lastUploadBytes / 1024.0, rgbaBytes / 1024.0);
+    ImGui::Text("CPU conversion: YUV %.2f ms, RGBA %.2f ms", yuvConversionTimeMs, rgbaConversionTimeMs);
+}
+
+void MainApp::renderPerfCountersGUI() {
+    bool perfCountersEnabled = PerfCounters::isEnabled();
+    if (ImGui::Checkbox("Hardware counters", &perfCountersEnabled)) {
+        if (perfCountersEnabled) {
+            PerfCounters::get()->start();
+        } else {
+            PerfCounters::get()->stop();
+        }
+    }
+    if (!PerfCounters::get()->getLastError().empty()) {
+        ImGui::TextWrapped("%s", PerfCounters::get()->getLastError().c_str());
+    }
+    if (!perfCountersEnabled) {
+        return;
+    }
+
+    // Only the calling thread is counted (e.g. not the TensorFlow thread pool of Session::Run)
+    ImGui::Columns(5, "PerfCounters");
+    ImGui::Text("Stage"); ImGui::NextColumn();
+    ImGui::Text("Mcycles/frame"); ImGui::NextColumn();
+    ImGui::Text("IPC"); ImGui::NextColumn();
+    ImGui::Text("Bytes/px"); ImGui::NextColumn();
+    ImGui::Text("Br.miss/px"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (const PerfStageStatistics& stage : PerfCounters::get()->getStatistics()) {
+        const PerfCounterValues& total = stage.total;
+        ImGui::Text("%s", stage.stage.c_str()); ImGui::NextColumn();
+        ImGui::Text("%.3f", double(total.cycles) * 1e-6 / double(std::max(stage.numFrames, uint64_t(1))));
+        ImGui::NextColumn();
+        ImGui::Text("%.2f", total.getIpc()); ImGui::NextColumn();
+        ImGui::Text("%.2f", total.getBytesPerPixel()); ImGui::NextColumn();
+        ImGui::Text("%.4f", total.getBranchMissesPerPixel()); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void MainApp::renderMemoryGUI() {
+    MemoryAccounting *memoryAccounting = MemoryAccounting::get();
+    ImGui::Columns(3, "Memory");
+    ImGui::Text("Category"); ImGui::NextColumn();
+    ImGui::Text("Current"); ImGui::NextColumn();
+    ImGui::Text("Peak"); ImGui::NextColumn();
+    ImGui::Separator();
+    size_t totalUsage = 0;
+    for (const MemoryCategoryUsage& usage : memoryAccounting->getUsageStatistics()) {
+        // Without allocator statistics, the memory of the TensorFlow sessions is an estimate
+        ImGui::Text("%s%s", usage.name.c_str(), usage.fromAllocatorStats ? " (allocator)" : "");
+        ImGui::NextColumn();
+        ImGui::Text("%s", formatMemorySize(usage.current).c_str()); ImGui::NextColumn();
+        ImGui::Text("%s", formatMemorySize(usage.peak).c_str()); ImGui::NextColumn();
+        totalUsage += usage.current;
+    }
+    ImGui::Separator();
+    ImGui::Text("Total"); ImGui::NextColumn();
+    ImGui::Text("%s", formatMemorySize(totalUsage).c_str()); ImGui::NextColumn();
+    ImGui::Text("%s", formatMemorySize(memoryAccounting->getPeakTotalUsage()).c_str()); ImGui::NextColumn();
+    ImGui::Columns(1);
+
+    if (memoryAccounting->getBudget() > 0) {
+        ImGui::Text("Budget: %s", formatMemorySize(memoryAccounting->getBudget()).c_str());
+    } else {
+        ImGui::Text("Budget: unlimited (see --memory-budget)");
+    }
+}
+
+void MainApp::renderSharedMemoryGUI() {
+    if (sharedMemorySource) {
+        ImGui::Text("Input ring: %s", settings.sharedMemoryInput.c_str());
+        ImGui::Text("Skipped frames: %llu, overruns: %llu",
+                    (unsigned long long)sharedMemorySource->getNumSkippedFrames(),
+                    (unsigned long long)sharedMemorySource->getNumOverruns());
+    }
+    if (outputRing.isOpen()) {
+        ImGui::Text("Output ring: %s (%llu frames written)",
+                    settings.sharedMemoryOutput.c_str(), (unsigned long long)numOutputFrames);
+    }
+}
+
+void MainApp::toggleTracing() {
+    if (!Tracer::isEnabled()) {
+        Tracer::get()->start();
+        return;
+    }
+
+    Tracer::get()->stop();
+    std::string filename = settings.traceFile;
+    if (filename.empty()) {
+        char timeString[32];
+        time_t currentTime = time(NULL);
+        strftime(timeString, sizeof(timeString), "%Y-%m-%d_%H-%M-%S", localtime(&currentTime));
+        filename = std::string() + "hdrnet_trace_" + timeString + ".json";
+    }
+    Tracer::get()->writeChromeTrace(filename);
+}
+
 void MainApp::update(float dt) {
     AppLogic::update(dt);
 
+    if (sgl::Keyboard->keyPressed(SDLK_F9)) {
+        toggleTracing();
+    }
+
     if (sgl::Keyboard->keyPressed(SDLK_UP)) {
-        filterIndex = (filterIndex + 1) % int(filters.size());
-        std::cout << filters[filterIndex] << std::endl;
-        gridRenderer.initialize(filters[filterIndex]);
+        selectFilter((filterIndex + 1) % int(filters.size()));
     }
     if (sgl::Keyboard->keyPressed(SDLK_DOWN)) {
-        filterIndex = (filterIndex-1 + int(filters.size())) % int(filters.size());
-        std::cout << filters[filterIndex] << std::endl;
-        gridRenderer.initialize(filters[filterIndex]);
+        selectFilter((filterIndex-1 + int(filters.size())) % int(filters.size()));
     }
 
 }
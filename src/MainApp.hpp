@@ -40,29 +40,122 @@
 #include <vector>
 #include <glm/glm.hpp>
 #include "GridRenderer.hpp"
-#include "Webcam.hpp"
+#include "ComparisonRenderer.hpp"
+#include "QualityController.hpp"
+#include "SharedMemoryFrameSource.hpp"
+#include "SharedMemoryRing.hpp"
+#include "YuvFrame.hpp"
+#include "MemoryAccounting.hpp"
+#include "StartupLoader.hpp"
+
+//! Settings of the viewer passed on the command line
+struct ViewerSettings {
+    //! Name of a shared memory frame ring to read the input frames from instead of the webcam
+    std::string sharedMemoryInput;
+    //! Name of a shared memory frame ring the filtered frames are written to
+    std::string sharedMemoryOutput;
+    int sharedMemoryOutputSlots = 4;
+    //! File the trace is written to when recording is stopped with F9 (by default, a name with a time stamp)
+    std::string traceFile;
+    //! Color LUT (.cube) that can be applied instead of running the network (see --bake-lut)
+    std::string lutFile;
+    //! Requests YUYV/NV12 frames from the webcam that are uploaded and converted to RGB on the GPU
+    bool nativeYuv = false;
+};
 
 class MainApp : public sgl::AppLogic {
 public:
-    MainApp();
+    /*!
+     * \param startupLoader: Opens the webcam and loads the first filter in the background (see StartupLoader).
+     * Without it, both happen in the constructor.
+     */
+    explicit MainApp(const ViewerSettings& settings = ViewerSettings(),
+                     const StartupLoaderPtr& startupLoader = StartupLoaderPtr());
     ~MainApp();
     void render();
     void update(float dt);
     void resolutionChanged(sgl::EventPtr event);
     void processSDLEvent(const SDL_Event &event);
+    //! Model folders of the filters that can be selected (the first one is shown at startup)
+    static std::vector<std::string> getFilterPaths();
 
 private:
+    //! Picks up the webcam and the model once the startup loader is done with them
+    void updateStartupLoading();
+    void logStartupMilestone(const std::string& name);
+    void selectFilter(int index);
+    //! Uploads the RGBA frame (and the network input) to frameTexture
+    void uploadFrame();
+    //! Uploads the planes of yuvFrame as they are; the shaders convert them to RGB
+    void uploadYuvFrame();
     void renderGUI();
+    void renderNativeYuvGUI();
+    void renderQualityControllerGUI();
+    //! Applies the capture resolution requested by the quality controller to the camera
+    void updateCaptureResolution();
+    //! Writes the filtered frame to the shared memory output ring
+    void writeOutputFrame();
+    void renderSharedMemoryGUI();
+    //! Starts recording a trace or stops recording and writes it (bound to F9)
+    void toggleTracing();
+    //! Hardware counters per pipeline stage (averaged over the frames since they were started)
+    void renderPerfCountersGUI();
+    //! Usage per category (see MemoryAccounting)
+    void renderMemoryGUI();
+    //! Reports the size of the frame textures to MemoryAccounting (called when they are (re-)created)
+    void updateTextureMemory();
+    //! Reclaims memory if the budget is exceeded and quits if it can't be met
+    void checkMemoryBudget();
+    void renderComparisonGUI();
+    //! Filter name and inference time on top of each view of the comparison
+    void renderComparisonLabels();
+    void updateComparisonFilters();
     bool showSettingsWindow = true;
 
-    Webcam webcam;
+    ViewerSettings settings;
+    StartupLoaderPtr startupLoader;
+    bool waitingForStartupModel = false;
+    FrameSourcePtr frameSource;
     FrameDataPtr frameImage;
     FrameDataPtr downscaledImage;
     sgl::TexturePtr frameTexture;
     sgl::TexturePtr downscaledTexture;
+    FrameFormat frameFormat = FRAME_FORMAT_RGBA8; ///< Layout of frameTexture
+    glm::ivec2 frameSize = glm::ivec2(0, 0);
+
+    // Native YUV frames (only used when no pass needs the RGBA frame, i.e. not for comparisons and LUTs)
+    YuvFramePtr yuvFrame;
+    sgl::TexturePtr chromaTexture; ///< UV plane of NV12 frames
+    bool useNativeYuv = false;
+    float rgbaConversionTimeMs = 0.0f;
+    float yuvConversionTimeMs = 0.0f;
+    size_t lastUploadBytes = 0;
+    TrackedMemory frameTextureMemory{MEMORY_TEXTURES};
+    bool quitRequested = false;
 
     // Lighting & rendering
     GridRenderer gridRenderer;
+    bool useColorLut = false;
+    //! Only re-slices the tiles that changed (for mostly static scenes)
+    bool incrementalSlicing = false;
+    //! Whether the tiles of the current RGBA frame were hashed (not the case for YUV frames)
+    bool tilesDetected = false;
+
+    // Multiple filters side by side
+    boost::shared_ptr<ComparisonRenderer> comparisonRenderer;
+    bool comparisonMode = false;
+    int numComparisonViews = 2;
+    int comparisonFilterIndices[ComparisonRenderer::MAX_VIEWS] = {0, 1, 2, 3};
+
+    // Adaptive quality
+    QualityController qualityController;
+    StageTimings lastTimings;
+    glm::ivec2 captureResolution;
+
+    // Frame exchange with other processes
+    boost::shared_ptr<SharedMemoryFrameSource> sharedMemorySource;
+    SharedMemoryRing outputRing;
+    uint64_t numOutputFrames = 0;
 
     // User interaction
     std::vector<std::string> filters;
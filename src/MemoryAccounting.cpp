@@ -0,0 +1,238 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <Utils/File/Logfile.hpp>
+#include "MemoryAccounting.hpp"
+
+using namespace sgl;
+
+std::string formatMemorySize(size_t bytes) {
+    std::stringstream stream;
+    stream << std::fixed << std::setprecision(1) << double(bytes) / (1024.0 * 1024.0) << " MiB";
+    return stream.str();
+}
+
+void TrackedMemory::set(size_t newBytes) {
+    if (newBytes > bytes) {
+        MemoryAccounting::get()->allocate(category, newBytes - bytes);
+    } else if (newBytes < bytes) {
+        MemoryAccounting::get()->release(category, bytes - newBytes);
+    }
+    bytes = newBytes;
+}
+
+MemoryAccounting *MemoryAccounting::get() {
+    static MemoryAccounting memoryAccounting;
+    return &memoryAccounting;
+}
+
+MemoryAccounting::MemoryAccounting() : peakTotalUsage(0), budget(0), budgetFailure(false) {
+    for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++) {
+        trackedUsage[i] = 0;
+        peakUsage[i] = 0;
+    }
+}
+
+void MemoryAccounting::updatePeak(MemoryCategory category, size_t usage) {
+    size_t peak = peakUsage[category].load(std::memory_order_relaxed);
+    while (usage > peak && !peakUsage[category].compare_exchange_weak(peak, usage, std::memory_order_relaxed)) {}
+}
+
+void MemoryAccounting::allocate(MemoryCategory category, size_t bytes) {
+    size_t usage = trackedUsage[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    updatePeak(category, usage);
+}
+
+void MemoryAccounting::release(MemoryCategory category, size_t bytes) {
+    trackedUsage[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryAccounting::setAllocatorStatsProvider(MemoryCategory category, std::function<bool(size_t&)> provider) {
+    std::lock_guard<std::mutex> lock(providerMutex);
+    allocatorStatsProviders[category] = provider;
+}
+
+std::vector<MemoryCategoryUsage> MemoryAccounting::getUsageStatistics() {
+    std::vector<MemoryCategoryUsage> statistics(NUM_MEMORY_CATEGORIES);
+    size_t totalUsage = 0;
+    for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++) {
+        MemoryCategoryUsage& usage = statistics.at(i);
+        usage.name = MEMORY_CATEGORY_NAMES[i];
+        usage.current = trackedUsage[i].load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(providerMutex);
+            size_t allocatorUsage = 0;
+            if (allocatorStatsProviders[i] && allocatorStatsProviders[i](allocatorUsage)) {
+                usage.current = allocatorUsage;
+                usage.fromAllocatorStats = true;
+            }
+        }
+        updatePeak(MemoryCategory(i), usage.current);
+        usage.peak = peakUsage[i].load(std::memory_order_relaxed);
+        totalUsage += usage.current;
+    }
+
+    size_t peak = peakTotalUsage.load(std::memory_order_relaxed);
+    while (totalUsage > peak && !peakTotalUsage.compare_exchange_weak(peak, totalUsage, std::memory_order_relaxed)) {}
+    return statistics;
+}
+
+size_t MemoryAccounting::getUsage(MemoryCategory category) {
+    return getUsageStatistics().at(category).current;
+}
+
+size_t MemoryAccounting::getTotalUsage() {
+    size_t totalUsage = 0;
+    for (const MemoryCategoryUsage& usage : getUsageStatistics()) {
+        totalUsage += usage.current;
+    }
+    return totalUsage;
+}
+
+bool MemoryAccounting::ensureBudget(size_t additionalBytes, const std::string& context) {
+    size_t maxUsage = budget;
+    if (maxUsage == 0) {
+        return true;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(reclaimerMutex);
+    size_t requiredUsage = getTotalUsage() + additionalBytes;
+    // Reclaimers may remove themselves (or others) while being called, so the list is searched again after each call
+    std::vector<MemoryReclaimer*> calledReclaimers;
+    while (requiredUsage > maxUsage) {
+        MemoryReclaimer *reclaimer = NULL;
+        for (const ReclaimerEntry& entry : reclaimers) {
+            if (std::find(calledReclaimers.begin(), calledReclaimers.end(), entry.reclaimer)
+                    == calledReclaimers.end()) {
+                reclaimer = entry.reclaimer;
+                break;
+            }
+        }
+        if (!reclaimer) {
+            break;
+        }
+        calledReclaimers.push_back(reclaimer);
+
+        std::string reclaimerName = reclaimer->getReclaimerName();
+        size_t releasedBytes = reclaimer->reclaimMemory(requiredUsage - maxUsage);
+        if (releasedBytes > 0) {
+            Logfile::get()->writeInfo(
+                    "INFO in MemoryAccounting::ensureBudget: Released " + formatMemorySize(releasedBytes)
+                    + " of " + reclaimerName + " for " + context + ".");
+            requiredUsage = getTotalUsage() + additionalBytes;
+        }
+    }
+
+    if (requiredUsage <= maxUsage) {
+        return true;
+    }
+    budgetFailure = true;
+    Logfile::get()->writeError(
+            "ERROR in MemoryAccounting::ensureBudget: " + context + " needs " + formatMemorySize(requiredUsage)
+            + " in total, but the memory budget is " + formatMemorySize(maxUsage)
+            + " and no more memory can be reclaimed.\n" + getReport());
+    return false;
+}
+
+void MemoryAccounting::addReclaimer(MemoryReclaimer *reclaimer, int priority) {
+    std::lock_guard<std::recursive_mutex> lock(reclaimerMutex);
+    for (const ReclaimerEntry& entry : reclaimers) {
+        if (entry.reclaimer == reclaimer) {
+            return;
+        }
+    }
+    ReclaimerEntry entry;
+    entry.reclaimer = reclaimer;
+    entry.priority = priority;
+    std::vector<ReclaimerEntry>::iterator it = std::upper_bound(
+            reclaimers.begin(), reclaimers.end(), entry, [](const ReclaimerEntry& a, const ReclaimerEntry& b) {
+                return a.priority < b.priority;
+            });
+    reclaimers.insert(it, entry);
+}
+
+void MemoryAccounting::removeReclaimer(MemoryReclaimer *reclaimer) {
+    std::lock_guard<std::recursive_mutex> lock(reclaimerMutex);
+    for (std::vector<ReclaimerEntry>::iterator it = reclaimers.begin(); it != reclaimers.end(); ++it) {
+        if (it->reclaimer == reclaimer) {
+            reclaimers.erase(it);
+            return;
+        }
+    }
+}
+
+std::string MemoryAccounting::getSummary() {
+    std::vector<MemoryCategoryUsage> statistics = getUsageStatistics();
+    std::stringstream summary;
+    summary << "Memory:";
+    size_t totalUsage = 0;
+    for (size_t i = 0; i < statistics.size(); i++) {
+        summary << (i == 0 ? " " : ", ") << statistics.at(i).name << " " << formatMemorySize(statistics.at(i).current);
+        totalUsage += statistics.at(i).current;
+    }
+    summary << " (total " << formatMemorySize(totalUsage) << ", peak " << formatMemorySize(peakTotalUsage);
+    if (budget > 0) {
+        summary << ", budget " << formatMemorySize(budget);
+    }
+    summary << ")";
+    return summary.str();
+}
+
+std::string MemoryAccounting::getReport() {
+    std::vector<MemoryCategoryUsage> statistics = getUsageStatistics();
+    std::stringstream report;
+    report << std::left << std::setw(24) << "Category" << std::right << std::setw(14) << "Current"
+           << std::setw(14) << "Peak" << "  Source\n";
+    size_t totalUsage = 0;
+    for (const MemoryCategoryUsage& usage : statistics) {
+        report << std::left << std::setw(24) << usage.name << std::right << std::setw(14)
+               << formatMemorySize(usage.current) << std::setw(14) << formatMemorySize(usage.peak)
+               << (usage.fromAllocatorStats ? "  allocator statistics\n" : "  tracked\n");
+        totalUsage += usage.current;
+    }
+    report << std::left << std::setw(24) << "Total" << std::right << std::setw(14) << formatMemorySize(totalUsage)
+           << std::setw(14) << formatMemorySize(peakTotalUsage) << "\n";
+    report << "Budget: " << (budget > 0 ? formatMemorySize(budget) : std::string("unlimited")) << "\n";
+
+    std::lock_guard<std::recursive_mutex> lock(reclaimerMutex);
+    report << "Reclaimable state:";
+    if (reclaimers.empty()) {
+        report << " none";
+    }
+    for (const ReclaimerEntry& entry : reclaimers) {
+        report << "\n  " << entry.reclaimer->getReclaimerName();
+    }
+    return report.str();
+}
@@ -0,0 +1,183 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MEMORYACCOUNTING_HPP_
+#define MEMORYACCOUNTING_HPP_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstddef>
+
+enum MemoryCategory {
+    //! Memory of the TensorFlow sessions (weights copied from the graph and tensors)
+    MEMORY_TF_SESSIONS,
+    //! Graph definitions kept by GridPredictor after the session was created
+    MEMORY_GRAPH_DEFS,
+    //! Pixel data owned by FrameData objects
+    MEMORY_FRAMES,
+    //! GPU memory of the textures created for frames, grids and render targets
+    MEMORY_TEXTURES,
+    NUM_MEMORY_CATEGORIES
+};
+
+const char *const MEMORY_CATEGORY_NAMES[NUM_MEMORY_CATEGORIES] = {
+        "TensorFlow sessions", "Graph definitions", "Frames", "Textures"
+};
+
+/**
+ * State that can be released when the memory budget is exceeded (see MemoryAccounting::addReclaimer).
+ * reclaimMemory is called on the thread that checks the budget (ensureBudget/checkBudget). Reclaimers aren't required
+ * to be thread-safe, so while one that isn't (e.g. ComparisonRenderer) is registered, the budget must only be checked
+ * on the main thread.
+ */
+class MemoryReclaimer {
+public:
+    virtual ~MemoryReclaimer() {}
+    /*!
+     * Releases reclaimable state (and updates the accounting accordingly).
+     * \param bytesNeeded: Number of bytes the budget is exceeded by (releasing more is fine)
+     * \return The number of bytes released
+     */
+    virtual size_t reclaimMemory(size_t bytesNeeded) = 0;
+    virtual std::string getReclaimerName() const = 0;
+};
+
+//! Reclaimers with a lower priority are asked first
+const int RECLAIM_PRIORITY_UNUSED_STATE = 0; ///< State that is never needed again (e.g. retained graphs)
+const int RECLAIM_PRIORITY_IDLE_MODELS = 1; ///< Loaded models that would have to be loaded again when used
+
+struct MemoryCategoryUsage {
+    MemoryCategoryUsage() : current(0), peak(0), fromAllocatorStats(false) {}
+    std::string name;
+    size_t current;
+    size_t peak;
+    //! Whether the value was reported by the allocator (e.g. TensorFlow) instead of tracked by this program
+    bool fromAllocatorStats;
+};
+
+/**
+ * Process-wide accounting of the memory used per category (see MemoryCategory). The owners of the memory report
+ * their allocations (allocate/release are lock-free, so they can be used on hot paths). Categories for which an
+ * allocator reports its own statistics (see setAllocatorStatsProvider) use these instead of the tracked values.
+ *
+ * If a budget is set, ensureBudget releases reclaimable state until the total usage fits the budget. When this
+ * isn't possible, a report of the usage is logged and the failure is remembered (see hasBudgetFailure), so the
+ * viewer and the batch tools can stop instead of running into the memory limit of the host.
+ */
+class MemoryAccounting {
+public:
+    static MemoryAccounting *get();
+
+    void allocate(MemoryCategory category, size_t bytes);
+    void release(MemoryCategory category, size_t bytes);
+    /*!
+     * The provider returns false if the allocator statistics aren't available (e.g. not enabled in the build).
+     * Pass an empty function to remove the provider.
+     */
+    void setAllocatorStatsProvider(MemoryCategory category, std::function<bool(size_t&)> provider);
+
+    size_t getUsage(MemoryCategory category);
+    size_t getTotalUsage();
+    size_t getPeakTotalUsage() const { return peakTotalUsage; }
+    std::vector<MemoryCategoryUsage> getUsageStatistics();
+
+    //! \param bytes: Maximum total usage (0 = unlimited)
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+    /*!
+     * Reclaims memory if the current usage plus additionalBytes exceeds the budget.
+     * \param additionalBytes: Memory the caller is about to allocate
+     * \param context: Function name used in the report (e.g. "GridPredictor::loadGraph")
+     * \return false if the budget can't be met (the report is logged as an error).
+     */
+    bool ensureBudget(size_t additionalBytes, const std::string& context);
+    //! \return Whether ensureBudget failed once (the process should stop as soon as possible).
+    bool hasBudgetFailure() const { return budgetFailure; }
+    //! \return false if the budget can't be met anymore or ensureBudget failed before (e.g. for loading a model).
+    bool checkBudget(const std::string& context) { return !budgetFailure && ensureBudget(0, context); }
+
+    void addReclaimer(MemoryReclaimer *reclaimer, int priority);
+    void removeReclaimer(MemoryReclaimer *reclaimer);
+
+    //! One line with the usage of all categories (for batch summaries)
+    std::string getSummary();
+    //! Table of the current and peak usage per category and the registered reclaimers
+    std::string getReport();
+
+private:
+    MemoryAccounting();
+    void updatePeak(MemoryCategory category, size_t usage);
+
+    std::atomic<size_t> trackedUsage[NUM_MEMORY_CATEGORIES];
+    std::atomic<size_t> peakUsage[NUM_MEMORY_CATEGORIES];
+    std::atomic<size_t> peakTotalUsage;
+    std::atomic<size_t> budget;
+    std::atomic<bool> budgetFailure;
+
+    std::mutex providerMutex;
+    std::function<bool(size_t&)> allocatorStatsProviders[NUM_MEMORY_CATEGORIES];
+
+    struct ReclaimerEntry {
+        MemoryReclaimer *reclaimer;
+        int priority;
+    };
+    // Recursive, as reclaimers may destroy objects that remove their own reclaimer (e.g. idle models)
+    std::recursive_mutex reclaimerMutex;
+    std::vector<ReclaimerEntry> reclaimers;
+};
+
+/**
+ * Memory of one owner in a category (e.g. the textures of a renderer). set replaces the previously accounted size,
+ * and the memory is released when the object is destroyed.
+ */
+class TrackedMemory {
+public:
+    explicit TrackedMemory(MemoryCategory category) : category(category), bytes(0) {}
+    ~TrackedMemory() { set(0); }
+    TrackedMemory(const TrackedMemory&) = delete;
+    TrackedMemory& operator=(const TrackedMemory&) = delete;
+
+    void set(size_t newBytes);
+    size_t get() const { return bytes; }
+
+private:
+    MemoryCategory category;
+    size_t bytes;
+};
+
+//! Formats a size in MiB with one decimal place (e.g. "12.5 MiB")
+std::string formatMemorySize(size_t bytes);
+
+#endif /* MEMORYACCOUNTING_HPP_ */
@@ -0,0 +1,235 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include <Utils/File/Logfile.hpp>
+#include "PerfCounters.hpp"
+
+using namespace sgl;
+
+std::atomic<bool> PerfCounters::enabled(false);
+
+PerfCounterValues& PerfCounterValues::operator+=(const PerfCounterValues& other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cacheMisses += other.cacheMisses;
+    branchMisses += other.branchMisses;
+    numPixels += other.numPixels;
+    numCalls += other.numCalls;
+    return *this;
+}
+
+PerfCounterValues PerfCounterValues::operator-(const PerfCounterValues& other) const {
+    PerfCounterValues difference;
+    difference.cycles = cycles - other.cycles;
+    difference.instructions = instructions - other.instructions;
+    difference.cacheMisses = cacheMisses - other.cacheMisses;
+    difference.branchMisses = branchMisses - other.branchMisses;
+    difference.numPixels = numPixels - other.numPixels;
+    difference.numCalls = numCalls - other.numCalls;
+    return difference;
+}
+
+#ifdef __linux__
+const int NUM_PERF_EVENTS = 4;
+// Same order as the members of PerfCounterValues; the first event is the group leader
+const uint64_t PERF_EVENT_CONFIGS[NUM_PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+};
+
+//! Counter group of one thread (opened on the first read and closed when the thread exits)
+struct ThreadPerfCounters {
+    ThreadPerfCounters() : opened(false), openFailed(false) {
+        for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+            fds[i] = -1;
+        }
+    }
+    ~ThreadPerfCounters() {
+        close();
+    }
+
+    //! \return An error message (empty on success)
+    std::string open() {
+        for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+            perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = PERF_EVENT_CONFIGS[i];
+            attributes.read_format = PERF_FORMAT_GROUP;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            // Calling thread on any CPU
+            fds[i] = int(syscall(__NR_perf_event_open, &attributes, 0, -1, i == 0 ? -1 : fds[0], 0));
+            if (fds[i] < 0) {
+                std::string error = strerror(errno);
+                close();
+                openFailed = true;
+                return error;
+            }
+        }
+        opened = true;
+        return "";
+    }
+
+    void close() {
+        for (int i = 0; i < NUM_PERF_EVENTS; i++) {
+            if (fds[i] >= 0) {
+                ::close(fds[i]);
+                fds[i] = -1;
+            }
+        }
+        opened = false;
+    }
+
+    bool read(PerfCounterValues& values) {
+        // Layout for PERF_FORMAT_GROUP: number of events followed by one value per event
+        uint64_t buffer[1 + NUM_PERF_EVENTS];
+        if (::read(fds[0], buffer, sizeof(buffer)) != ssize_t(sizeof(buffer)) || buffer[0] != NUM_PERF_EVENTS) {
+            return false;
+        }
+        values.cycles = buffer[1];
+        values.instructions = buffer[2];
+        values.cacheMisses = buffer[3];
+        values.branchMisses = buffer[4];
+        return true;
+    }
+
+    int fds[NUM_PERF_EVENTS];
+    bool opened, openFailed;
+};
+static thread_local ThreadPerfCounters threadPerfCounters;
+#endif
+
+PerfCounters *PerfCounters::get() {
+    static PerfCounters perfCounters;
+    return &perfCounters;
+}
+
+bool PerfCounters::readThreadCounters(PerfCounterValues& values) {
+#ifdef __linux__
+    if (!threadPerfCounters.opened) {
+        if (threadPerfCounters.openFailed || !threadPerfCounters.open().empty()) {
+            return false;
+        }
+    }
+    return threadPerfCounters.read(values);
+#else
+    return false;
+#endif
+}
+
+bool PerfCounters::start() {
+#ifdef __linux__
+    // Check that the counters are available before enabling them for all threads
+    if (!threadPerfCounters.opened) {
+        threadPerfCounters.openFailed = false;
+        std::string error = threadPerfCounters.open();
+        if (!error.empty()) {
+            lastError = "perf_event_open failed (" + error + "). Hardware counters may be unavailable in "
+                    "virtual machines or disabled by /proc/sys/kernel/perf_event_paranoid.";
+            Logfile::get()->writeError("ERROR in PerfCounters::start: " + lastError);
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    currentFrame.clear();
+    statistics.clear();
+    lastError.clear();
+    enabled.store(true);
+    return true;
+#else
+    lastError = "Hardware performance counters are only supported on Linux.";
+    Logfile::get()->writeError("ERROR in PerfCounters::start: " + lastError);
+    return false;
+#endif
+}
+
+void PerfCounters::stop() {
+    enabled.store(false);
+}
+
+void PerfCounters::addSample(const char *stage, const PerfCounterValues& values) {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentFrame[stage] += values;
+}
+
+void PerfCounters::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::pair<const std::string, PerfCounterValues>& stageValues : currentFrame) {
+        PerfStageStatistics& stageStatistics = statistics[stageValues.first];
+        stageStatistics.stage = stageValues.first;
+        stageStatistics.lastFrame = stageValues.second;
+        stageStatistics.total += stageValues.second;
+        stageStatistics.numFrames++;
+    }
+    currentFrame.clear();
+}
+
+std::vector<PerfStageStatistics> PerfCounters::getStatistics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<PerfStageStatistics> stageStatistics;
+    for (std::pair<const std::string, PerfStageStatistics>& entry : statistics) {
+        stageStatistics.push_back(entry.second);
+    }
+    return stageStatistics;
+}
+
+std::string PerfCounters::getSummary() {
+    endFrame();
+    std::vector<PerfStageStatistics> stageStatistics = getStatistics();
+    std::stringstream summary;
+    summary << std::left << std::setw(34) << "Stage" << std::right << std::setw(8) << "Calls"
+            << std::setw(14) << "Mcycles/call" << std::setw(8) << "IPC" << std::setw(12) << "Cycles/px"
+            << std::setw(12) << "Bytes/px" << std::setw(14) << "Br.miss/px" << "\n";
+    summary << std::fixed;
+    for (const PerfStageStatistics& stage : stageStatistics) {
+        const PerfCounterValues& total = stage.total;
+        summary << std::left << std::setw(34) << stage.stage << std::right << std::setw(8) << total.numCalls
+                << std::setprecision(3) << std::setw(14) << double(total.cycles) * 1e-6 / double(total.numCalls)
+                << std::setprecision(2) << std::setw(8) << total.getIpc() << std::setw(12) << total.getCyclesPerPixel()
+                << std::setw(12) << total.getBytesPerPixel()
+                << std::setprecision(4) << std::setw(14) << total.getBranchMissesPerPixel() << "\n";
+    }
+    return summary.str();
+}
@@ -0,0 +1,148 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PERFCOUNTERS_HPP_
+#define PERFCOUNTERS_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#define PERF_CONCATENATE_IMPL(a, b) a##b
+#define PERF_CONCATENATE(a, b) PERF_CONCATENATE_IMPL(a, b)
+/**
+ * Counts the hardware events of the calling thread until the end of the enclosing scope and adds them to the
+ * statistics of the stage name (a string literal). numPixels is the number of pixels the stage processes.
+ * Costs a single relaxed atomic load while the counters are off.
+ */
+#define PERF_SCOPE(name, numPixels) PerfScope PERF_CONCATENATE(perfScope, __LINE__)(name, numPixels)
+
+//! Size assumed for converting cache misses to memory traffic
+const int CACHE_LINE_SIZE = 64;
+
+struct PerfCounterValues {
+    PerfCounterValues() : cycles(0), instructions(0), cacheMisses(0), branchMisses(0), numPixels(0), numCalls(0) {}
+    PerfCounterValues& operator+=(const PerfCounterValues& other);
+    PerfCounterValues operator-(const PerfCounterValues& other) const;
+
+    //! Instructions per cycle
+    double getIpc() const { return cycles > 0 ? double(instructions) / double(cycles) : 0.0; }
+    //! Memory traffic estimated from the last level cache misses
+    double getBytesPerPixel() const {
+        return numPixels > 0 ? double(cacheMisses) * CACHE_LINE_SIZE / double(numPixels) : 0.0;
+    }
+    double getCyclesPerPixel() const { return numPixels > 0 ? double(cycles) / double(numPixels) : 0.0; }
+    double getBranchMissesPerPixel() const {
+        return numPixels > 0 ? double(branchMisses) / double(numPixels) : 0.0;
+    }
+
+    uint64_t cycles, instructions, cacheMisses, branchMisses;
+    uint64_t numPixels, numCalls;
+};
+
+struct PerfStageStatistics {
+    PerfStageStatistics() : numFrames(0) {}
+    std::string stage;
+    //! Sum of all calls in the last completed frame
+    PerfCounterValues lastFrame;
+    //! Sum of all calls since the counters were started
+    PerfCounterValues total;
+    //! Number of completed frames the stage ran in
+    uint64_t numFrames;
+};
+
+/**
+ * Hardware performance counters (cycles, instructions, last level cache misses and branch misses) per pipeline
+ * stage using perf_event_open on Linux. Each thread opens its own counter group the first time it enters a
+ * PERF_SCOPE, so only the work of the calling thread is counted (e.g. not the TensorFlow thread pool of
+ * Session::Run). Only user space events are counted, which works with the default perf_event_paranoid of 2.
+ * The values of all calls of a stage are accumulated until endFrame is called.
+ */
+class PerfCounters {
+public:
+    static PerfCounters *get();
+    static inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    //! \return Whether the counters of the calling thread could be read (opens them on the first call).
+    static bool readThreadCounters(PerfCounterValues& values);
+
+    //! \return false if hardware counters aren't available (see getLastError).
+    bool start();
+    void stop();
+    const std::string& getLastError() const { return lastError; }
+    //! Called by PerfScope (only while the counters are enabled)
+    void addSample(const char *stage, const PerfCounterValues& values);
+    //! Completes the current frame (the statistics of stages without calls in this frame stay unchanged).
+    void endFrame();
+    //! Statistics of all stages ordered by name
+    std::vector<PerfStageStatistics> getStatistics();
+    //! Table of the counters per call of all stages (for batch tools)
+    std::string getSummary();
+
+private:
+    PerfCounters() {}
+
+    static std::atomic<bool> enabled;
+    std::mutex mutex;
+    std::map<std::string, PerfCounterValues> currentFrame;
+    std::map<std::string, PerfStageStatistics> statistics;
+    std::string lastError;
+};
+
+//! Adds the counter values from construction to destruction to a stage (see PERF_SCOPE).
+class PerfScope {
+public:
+    inline PerfScope(const char *stage, uint64_t numPixels) : stage(stage), numPixels(numPixels), active(false) {
+        if (PerfCounters::isEnabled()) {
+            active = PerfCounters::readThreadCounters(startValues);
+        }
+    }
+    inline ~PerfScope() {
+        PerfCounterValues endValues;
+        if (active && PerfCounters::isEnabled() && PerfCounters::readThreadCounters(endValues)) {
+            PerfCounterValues values = endValues - startValues;
+            values.numPixels = numPixels;
+            values.numCalls = 1;
+            PerfCounters::get()->addSample(stage, values);
+        }
+    }
+
+private:
+    const char *stage;
+    uint64_t numPixels;
+    bool active;
+    PerfCounterValues startValues;
+};
+
+#endif /* PERFCOUNTERS_HPP_ */
@@ -0,0 +1,258 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "QualityController.hpp"
+
+// Weight of a new measurement in the exponential moving averages
+const float SMOOTHING_FACTOR = 0.1f;
+// The budget counts as exceeded above OVER_BUDGET_FACTOR * budget and as undercut below UNDER_BUDGET_FACTOR * budget
+const float OVER_BUDGET_FACTOR = 1.05f;
+const float UNDER_BUDGET_FACTOR = 0.7f;
+// Quality is only raised if the predicted frame time stays below RAISE_TARGET_FACTOR * budget
+const float RAISE_TARGET_FACTOR = 0.85f;
+// Number of consecutive frames needed before quality is lowered/raised
+const int DEGRADE_FRAMES = 10;
+const int RAISE_FRAMES = 60;
+// Number of frames no decision is made after a knob changed
+const int COOLDOWN_FRAMES = 30;
+// Index of the capture resolution used by Webcam::open
+const int DEFAULT_CAPTURE_LEVEL = 1;
+
+QualityController::QualityController() : enabled(false), renderScaleEnabled(true), frameTimeBudget(1000.0f / 30.0f) {
+    renderScales = { 1.0f, 0.75f, 0.5f, 0.35f };
+    inferenceIntervals = { 1, 2, 3, 4, 6, 8 };
+    captureResolutions = { glm::ivec2(1280, 720), glm::ivec2(640, 480), glm::ivec2(320, 240) };
+    reset();
+}
+
+void QualityController::reset() {
+    levels[KNOB_RENDER_SCALE] = 0;
+    levels[KNOB_INFERENCE_INTERVAL] = 0;
+    levels[KNOB_CAPTURE_RESOLUTION] = DEFAULT_CAPTURE_LEVEL;
+    for (int i = 0; i < NUM_KNOBS; i++) {
+        minLevels[i] = 0;
+    }
+    maxLevels[KNOB_RENDER_SCALE] = renderScaleEnabled ? int(renderScales.size()) - 1 : 0;
+    maxLevels[KNOB_INFERENCE_INTERVAL] = int(inferenceIntervals.size()) - 1;
+    maxLevels[KNOB_CAPTURE_RESOLUTION] = int(captureResolutions.size()) - 1;
+    previousCaptureLevel = DEFAULT_CAPTURE_LEVEL;
+
+    hasMeasurements = false;
+    smoothedCaptureMs = smoothedInferenceMs = smoothedSlicingMs = 0.0f;
+    framesOverBudget = framesUnderBudget = cooldownFrames = 0;
+    frameCounter = 0;
+    lastDecision = "None";
+}
+
+void QualityController::setEnabled(bool enabled) {
+    if (this->enabled != enabled) {
+        this->enabled = enabled;
+        reset();
+    }
+}
+
+void QualityController::setRenderScaleEnabled(bool enabled) {
+    renderScaleEnabled = enabled;
+    maxLevels[KNOB_RENDER_SCALE] = enabled ? int(renderScales.size()) - 1 : 0;
+    if (levels[KNOB_RENDER_SCALE] > maxLevels[KNOB_RENDER_SCALE]) {
+        // Slicing gets more expensive, i.e., the other knobs may need to be lowered after the cool-down
+        setLevel(KNOB_RENDER_SCALE, maxLevels[KNOB_RENDER_SCALE]);
+    }
+}
+
+float QualityController::getRenderScale() const {
+    return enabled ? renderScales.at(levels[KNOB_RENDER_SCALE]) : 1.0f;
+}
+
+int QualityController::getInferenceInterval() const {
+    return enabled ? inferenceIntervals.at(levels[KNOB_INFERENCE_INTERVAL]) : 1;
+}
+
+glm::ivec2 QualityController::getCaptureResolution() const {
+    return captureResolutions.at(enabled ? levels[KNOB_CAPTURE_RESOLUTION] : DEFAULT_CAPTURE_LEVEL);
+}
+
+float QualityController::getEstimatedFrameTime() const {
+    return smoothedCaptureMs + smoothedInferenceMs / float(getInferenceInterval()) + smoothedSlicingMs;
+}
+
+bool QualityController::shouldRunInference() {
+    bool runInference = frameCounter % uint64_t(getInferenceInterval()) == 0;
+    frameCounter++;
+    return runInference;
+}
+
+bool QualityController::update(const StageTimings& timings) {
+    if (!enabled) {
+        return false;
+    }
+
+    if (!hasMeasurements) {
+        smoothedCaptureMs = timings.captureMs;
+        smoothedSlicingMs = timings.slicingMs;
+    } else {
+        smoothedCaptureMs += SMOOTHING_FACTOR * (timings.captureMs - smoothedCaptureMs);
+        smoothedSlicingMs += SMOOTHING_FACTOR * (timings.slicingMs - smoothedSlicingMs);
+    }
+    if (timings.inferenceRan) {
+        if (!hasMeasurements || smoothedInferenceMs == 0.0f) {
+            smoothedInferenceMs = timings.inferenceMs;
+        } else {
+            smoothedInferenceMs += SMOOTHING_FACTOR * (timings.inferenceMs - smoothedInferenceMs);
+        }
+    }
+    hasMeasurements = true;
+
+    if (cooldownFrames > 0) {
+        cooldownFrames--;
+        return false;
+    }
+
+    float frameTime = getEstimatedFrameTime();
+    if (frameTime > frameTimeBudget * OVER_BUDGET_FACTOR) {
+        framesOverBudget++;
+        framesUnderBudget = 0;
+    } else if (frameTime < frameTimeBudget * UNDER_BUDGET_FACTOR) {
+        framesUnderBudget++;
+        framesOverBudget = 0;
+    } else {
+        framesOverBudget = 0;
+        framesUnderBudget = 0;
+    }
+
+    if (framesOverBudget >= DEGRADE_FRAMES) {
+        return degradeQuality();
+    }
+    if (framesUnderBudget >= RAISE_FRAMES) {
+        return raiseQuality();
+    }
+    return false;
+}
+
+float QualityController::predictFrameTime(Knob knob, int newLevel) const {
+    float captureMs = smoothedCaptureMs;
+    float inferenceMs = smoothedInferenceMs / float(getInferenceInterval());
+    float slicingMs = smoothedSlicingMs;
+
+    if (knob == KNOB_RENDER_SCALE) {
+        // The slicing cost is proportional to the number of rendered pixels
+        float scaleRatio = renderScales.at(newLevel) / renderScales.at(levels[knob]);
+        slicingMs *= scaleRatio * scaleRatio;
+    } else if (knob == KNOB_INFERENCE_INTERVAL) {
+        inferenceMs = smoothedInferenceMs / float(inferenceIntervals.at(newLevel));
+    } else if (knob == KNOB_CAPTURE_RESOLUTION) {
+        glm::ivec2 oldResolution = captureResolutions.at(levels[knob]);
+        glm::ivec2 newResolution = captureResolutions.at(newLevel);
+        captureMs *= float(newResolution.x * newResolution.y) / float(oldResolution.x * oldResolution.y);
+    }
+
+    return captureMs + inferenceMs + slicingMs;
+}
+
+bool QualityController::degradeQuality() {
+    // Lower the knob of the stage contributing most to the frame time first
+    std::vector<std::pair<float, Knob>> contributions = {
+            { smoothedSlicingMs, KNOB_RENDER_SCALE },
+            { smoothedInferenceMs / float(getInferenceInterval()), KNOB_INFERENCE_INTERVAL },
+            { smoothedCaptureMs, KNOB_CAPTURE_RESOLUTION },
+    };
+    std::sort(contributions.begin(), contributions.end(),
+              [](const std::pair<float, Knob>& a, const std::pair<float, Knob>& b) { return a.first > b.first; });
+
+    for (const std::pair<float, Knob>& contribution : contributions) {
+        Knob knob = contribution.second;
+        if (levels[knob] < maxLevels[knob]) {
+            setLevel(knob, levels[knob] + 1);
+            return true;
+        }
+    }
+
+    lastDecision = "Budget can't be met at the lowest quality";
+    framesOverBudget = 0;
+    return false;
+}
+
+bool QualityController::raiseQuality() {
+    // Fresh grids are noticed most, the capture resolution is the most expensive knob to change
+    const Knob raiseOrder[] = { KNOB_INFERENCE_INTERVAL, KNOB_RENDER_SCALE, KNOB_CAPTURE_RESOLUTION };
+    for (Knob knob : raiseOrder) {
+        if (levels[knob] > minLevels[knob]
+                && predictFrameTime(knob, levels[knob] - 1) < frameTimeBudget * RAISE_TARGET_FACTOR) {
+            setLevel(knob, levels[knob] - 1);
+            return true;
+        }
+    }
+
+    framesUnderBudget = 0;
+    return false;
+}
+
+void QualityController::setLevel(Knob knob, int newLevel) {
+    // Adapt the smoothed timings to the prediction so that the hysteresis doesn't act on stale values
+    if (knob == KNOB_RENDER_SCALE) {
+        float scaleRatio = renderScales.at(newLevel) / renderScales.at(levels[knob]);
+        smoothedSlicingMs *= scaleRatio * scaleRatio;
+    } else if (knob == KNOB_CAPTURE_RESOLUTION) {
+        glm::ivec2 oldResolution = captureResolutions.at(levels[knob]);
+        glm::ivec2 newResolution = captureResolutions.at(newLevel);
+        smoothedCaptureMs *= float(newResolution.x * newResolution.y) / float(oldResolution.x * oldResolution.y);
+        previousCaptureLevel = levels[knob];
+    }
+
+    std::string direction = newLevel > levels[knob] ? "Lowered" : "Raised";
+    levels[knob] = newLevel;
+    cooldownFrames = COOLDOWN_FRAMES;
+    framesOverBudget = 0;
+    framesUnderBudget = 0;
+
+    if (knob == KNOB_RENDER_SCALE) {
+        lastDecision = direction + " render scale to " + std::to_string(int(getRenderScale() * 100.0f)) + "%";
+    } else if (knob == KNOB_INFERENCE_INTERVAL) {
+        lastDecision = direction + " inference interval to " + std::to_string(getInferenceInterval()) + " frames";
+    } else if (knob == KNOB_CAPTURE_RESOLUTION) {
+        glm::ivec2 resolution = getCaptureResolution();
+        lastDecision = direction + " capture resolution to "
+                + std::to_string(resolution.x) + "x" + std::to_string(resolution.y);
+    }
+}
+
+void QualityController::captureResolutionRejected() {
+    int rejectedLevel = levels[KNOB_CAPTURE_RESOLUTION];
+    if (rejectedLevel < previousCaptureLevel) {
+        minLevels[KNOB_CAPTURE_RESOLUTION] = rejectedLevel + 1;
+    } else {
+        maxLevels[KNOB_CAPTURE_RESOLUTION] = rejectedLevel - 1;
+    }
+    levels[KNOB_CAPTURE_RESOLUTION] = previousCaptureLevel;
+    lastDecision = "Camera doesn't support the requested capture resolution";
+}
@@ -0,0 +1,128 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef QUALITYCONTROLLER_HPP_
+#define QUALITYCONTROLLER_HPP_
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+//! Measured processing times of the pipeline stages of one frame in milliseconds
+struct StageTimings {
+    StageTimings() : captureMs(0.0f), inferenceMs(0.0f), slicingMs(0.0f), inferenceRan(false) {}
+    //! Color conversion, downscaling and texture upload (waiting for the camera is not included)
+    float captureMs;
+    //! Time spent in GridPredictor::computeGridCoefficients (only valid if inferenceRan is true)
+    float inferenceMs;
+    //! GPU time of the slicing pass
+    float slicingMs;
+    bool inferenceRan;
+};
+
+/**
+ * Closed-loop controller holding the per-frame processing time below a configurable budget.
+ * It can trade quality for speed using three knobs: The resolution the slicing pass renders at,
+ * the number of frames between two inference runs (the grid is reused in between) and the capture
+ * resolution of the camera.
+ *
+ * To avoid oscillation, the controller uses exponentially smoothed stage timings, requires the
+ * budget to be exceeded (or undercut) for a number of consecutive frames before acting, waits for
+ * a cool-down period after each decision and only raises quality if the predicted cost after the
+ * change still stays clearly below the budget.
+ */
+class QualityController {
+public:
+    QualityController();
+    //! Resets all knobs to full quality and clears the measurement history.
+    void reset();
+
+    //! Feeds the timings of the last frame. \return true if one of the knobs changed.
+    bool update(const StageTimings& timings);
+    //! Advances the frame counter. \return true if the grid should be predicted in this frame.
+    bool shouldRunInference();
+    //! Called if the camera doesn't support the capture resolution returned by getCaptureResolution.
+    void captureResolutionRejected();
+
+    // Settings
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+    void setFrameTimeBudget(float budgetMs) { frameTimeBudget = budgetMs; }
+    float getFrameTimeBudget() const { return frameTimeBudget; }
+    //! Keeps the render scale at 100% if disabled (e.g. the incremental slicing always renders at full resolution).
+    void setRenderScaleEnabled(bool enabled);
+
+    // Current decisions
+    float getRenderScale() const;
+    int getInferenceInterval() const;
+    glm::ivec2 getCaptureResolution() const;
+    const std::string& getLastDecision() const { return lastDecision; }
+
+    // Smoothed measurements
+    float getEstimatedFrameTime() const;
+    float getSmoothedCaptureTime() const { return smoothedCaptureMs; }
+    float getSmoothedInferenceTime() const { return smoothedInferenceMs; }
+    float getSmoothedSlicingTime() const { return smoothedSlicingMs; }
+
+private:
+    enum Knob {
+        KNOB_RENDER_SCALE, KNOB_INFERENCE_INTERVAL, KNOB_CAPTURE_RESOLUTION, NUM_KNOBS
+    };
+    //! Predicted frame time if the level of a knob were changed to newLevel
+    float predictFrameTime(Knob knob, int newLevel) const;
+    bool degradeQuality();
+    bool raiseQuality();
+    void setLevel(Knob knob, int newLevel);
+
+    bool enabled;
+    bool renderScaleEnabled;
+    float frameTimeBudget;
+
+    // Levels are indices into the ladders below; 0 is the highest quality.
+    int levels[NUM_KNOBS];
+    int minLevels[NUM_KNOBS];
+    int maxLevels[NUM_KNOBS];
+    int previousCaptureLevel;
+    std::vector<float> renderScales;
+    std::vector<int> inferenceIntervals;
+    std::vector<glm::ivec2> captureResolutions;
+
+    // Hysteresis state
+    bool hasMeasurements;
+    float smoothedCaptureMs, smoothedInferenceMs, smoothedSlicingMs;
+    int framesOverBudget, framesUnderBudget, cooldownFrames;
+    uint64_t frameCounter;
+    std::string lastDecision;
+};
+
+#endif /* QUALITYCONTROLLER_HPP_ */
@@ -0,0 +1,117 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/opencv.hpp>
+#include <Utils/Timer.hpp>
+#include "Tracer.hpp"
+#include "PerfCounters.hpp"
+#include "SharedMemoryFrameSource.hpp"
+
+using namespace sgl;
+
+SharedMemoryFrameSource::SharedMemoryFrameSource()
+        : hasFrame(false), resolution(0, 0), lastConversionTimeMs(0.0f), numTornFrames(0) {
+}
+
+bool SharedMemoryFrameSource::open(const std::string& name) {
+    if (!ring.open(name)) {
+        return false;
+    }
+    resolution = glm::ivec2(ring.getMaxWidth(), ring.getMaxHeight());
+    return true;
+}
+
+bool SharedMemoryFrameSource::readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage) {
+    TRACE_SCOPE("SharedMemoryFrameSource::readFrame");
+    if (!ring.isOpen() || !ring.acquireLatest(currentFrame)) {
+        return false;
+    }
+    uint64_t startTime = Timer->getTicksMicroseconds();
+    resolution = glm::ivec2(currentFrame.width, currentFrame.height);
+
+    uint8_t *framePixels = const_cast<uint8_t*>(currentFrame.pixels);
+    if (currentFrame.format == FRAME_FORMAT_RGBA8) {
+        frameImage->wrap(framePixels, currentFrame.width, currentFrame.height);
+    } else {
+        frameImage->allocate(currentFrame.width, currentFrame.height);
+        cv::Mat rgbaMat(currentFrame.height, currentFrame.width, CV_8UC4, frameImage->pixels);
+        PERF_SCOPE("SharedMemoryFrameSource::cvtColor", uint64_t(currentFrame.width) * uint64_t(currentFrame.height));
+        if (currentFrame.format == FRAME_FORMAT_YUYV) {
+            cv::Mat yuyvMat(currentFrame.height, currentFrame.width, CV_8UC2, framePixels);
+#if (CV_VERSION_MAJOR <= 2)
+            cv::cvtColor(yuyvMat, rgbaMat, CV_YUV2RGBA_YUYV, 4);
+#else
+            cv::cvtColor(yuyvMat, rgbaMat, cv::COLOR_YUV2RGBA_YUYV, 4);
+#endif
+        } else if (currentFrame.format == FRAME_FORMAT_NV12) {
+            cv::Mat nv12Mat(currentFrame.height + currentFrame.height / 2, currentFrame.width, CV_8UC1, framePixels);
+#if (CV_VERSION_MAJOR <= 2)
+            cv::cvtColor(nv12Mat, rgbaMat, CV_YUV2RGBA_NV12, 4);
+#else
+            cv::cvtColor(nv12Mat, rgbaMat, cv::COLOR_YUV2RGBA_NV12, 4);
+#endif
+        } else if (currentFrame.format == FRAME_FORMAT_BGR8) {
+            cv::Mat bgrMat(currentFrame.height, currentFrame.width, CV_8UC3, framePixels);
+#if (CV_VERSION_MAJOR <= 2)
+            cv::cvtColor(bgrMat, rgbaMat, CV_BGR2RGBA, 4);
+#else
+            cv::cvtColor(bgrMat, rgbaMat, cv::COLOR_BGR2RGBA, 4);
+#endif
+        }
+    }
+
+    // Downscale
+    downscaledImage->allocate(256, 256);
+    cv::Mat rgbaMat(frameImage->h, frameImage->w, CV_8UC4, frameImage->pixels);
+    cv::Mat downscaledMat(256, 256, CV_8UC4, downscaledImage->pixels);
+    {
+        PERF_SCOPE("SharedMemoryFrameSource::resize", uint64_t(frameImage->w) * uint64_t(frameImage->h));
+        cv::resize(rgbaMat, downscaledMat, cv::Size(256, 256), 0, 0, cv::INTER_AREA);
+    }
+
+    lastConversionTimeMs = (Timer->getTicksMicroseconds() - startTime) / 1000.0f;
+    if (!ring.isStillValid(currentFrame)) {
+        // The producer overwrote the frame while it was converted
+        numTornFrames++;
+        return false;
+    }
+    hasFrame = true;
+    return true;
+}
+
+void SharedMemoryFrameSource::releaseFrame() {
+    if (hasFrame && !ring.isStillValid(currentFrame)) {
+        numTornFrames++;
+    }
+    hasFrame = false;
+}
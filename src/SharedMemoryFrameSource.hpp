@@ -0,0 +1,69 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHAREDMEMORYFRAMESOURCE_HPP_
+#define SHAREDMEMORYFRAMESOURCE_HPP_
+
+#include <string>
+#include "FrameSource.hpp"
+#include "SharedMemoryRing.hpp"
+
+/**
+ * Reads the newest frame of a SharedMemoryRing filled by another process. RGBA8 frames are used in place
+ * (no copy), other formats (BGR8, YUYV and NV12) are converted to RGBA.
+ */
+class SharedMemoryFrameSource : public FrameSource {
+public:
+    SharedMemoryFrameSource();
+    //! \param name: Name of the POSIX shared memory object created by the producer
+    bool open(const std::string& name);
+    virtual bool readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage);
+    virtual void releaseFrame();
+    virtual glm::ivec2 getResolution() { return resolution; }
+    virtual float getLastConversionTimeMs() { return lastConversionTimeMs; }
+    virtual uint64_t getLastTimestampNs() { return currentFrame.timestampNs; }
+
+    //! \return Frames the producer published while the viewer was busy with older frames
+    uint64_t getNumSkippedFrames() { return ring.getNumSkippedFrames(); }
+    //! \return Frames the producer overwrote while the viewer was still reading them
+    uint64_t getNumOverruns() { return ring.getNumOverruns() + numTornFrames; }
+
+private:
+    SharedMemoryRing ring;
+    SharedFrame currentFrame;
+    bool hasFrame;
+    glm::ivec2 resolution;
+    float lastConversionTimeMs;
+    uint64_t numTornFrames;
+};
+
+#endif /* SHAREDMEMORYFRAMESOURCE_HPP_ */
@@ -0,0 +1,285 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include <cerrno>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <Utils/File/Logfile.hpp>
+#include "SharedMemoryRing.hpp"
+
+using namespace sgl;
+
+// Slot headers and pixel data are aligned to pages so that producers can use them for DMA/zero-copy APIs
+const size_t PAGE_ALIGNMENT = 4096;
+
+static inline size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+#ifndef _WIN32
+/**
+ * Checks the layout written by the producer before it's used, as the header comes from another process.
+ * All products are checked for overflows, as the values are untrusted 64-bit integers.
+ */
+static bool isValidRingHeader(const SharedRingHeader *ringHeader, size_t mappedSize) {
+    if (ringHeader->magic != SHARED_RING_MAGIC || ringHeader->version != SHARED_RING_VERSION
+            || ringHeader->slotCount == 0 || ringHeader->maxWidth == 0 || ringHeader->maxHeight == 0) {
+        return false;
+    }
+    const uint64_t maxSize = uint64_t(mappedSize);
+    const uint64_t slotStride = ringHeader->slotStride;
+    const uint64_t pixelOffset = ringHeader->pixelOffset;
+    if (pixelOffset < sizeof(SharedFrameHeader) || pixelOffset > slotStride || pixelOffset % alignof(uint64_t) != 0
+            || slotStride % alignof(uint64_t) != 0) {
+        return false;
+    }
+
+    // maxWidth * maxHeight fits into 64 bits (both are 32-bit), the factor 4 may not
+    uint64_t numPixels = uint64_t(ringHeader->maxWidth) * uint64_t(ringHeader->maxHeight);
+    if (numPixels > (slotStride - pixelOffset) / 4) {
+        return false;
+    }
+
+    uint64_t slotsOffset = alignUp(sizeof(SharedRingHeader), PAGE_ALIGNMENT);
+    if (slotsOffset > maxSize || slotStride > (maxSize - slotsOffset) / ringHeader->slotCount) {
+        return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * The frame headers come from another process, too. Frames the consumers can't convert (empty, larger than the
+ * slots, unknown formats or odd sizes for the subsampled YUV formats) are rejected.
+ */
+static bool isValidFrame(uint32_t width, uint32_t height, uint32_t format, const SharedRingHeader *ringHeader) {
+    if (width == 0 || height == 0 || width > ringHeader->maxWidth || height > ringHeader->maxHeight) {
+        return false;
+    }
+    if (format == FRAME_FORMAT_RGBA8 || format == FRAME_FORMAT_BGR8) {
+        return true;
+    }
+    if (format == FRAME_FORMAT_YUYV || format == FRAME_FORMAT_NV12) {
+        return width % 2 == 0 && height % 2 == 0;
+    }
+    return false;
+}
+
+SharedMemoryRing::SharedMemoryRing()
+        : isProducer(false), mappedSize(0), header(NULL), lastSequence(0), numSkippedFrames(0), numOverruns(0) {
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+    close();
+}
+
+bool SharedMemoryRing::create(const std::string& name, int slotCount, int maxWidth, int maxHeight) {
+    close();
+    if (slotCount <= 0 || maxWidth <= 0 || maxHeight <= 0) {
+        Logfile::get()->writeError(
+                "ERROR in SharedMemoryRing::create: The slot count and the maximum resolution must be positive.");
+        return false;
+    }
+
+#ifdef _WIN32
+    Logfile::get()->writeError("ERROR in SharedMemoryRing::create: POSIX shared memory isn't available on Windows.");
+    return false;
+#else
+    size_t pixelOffset = alignUp(sizeof(SharedFrameHeader), PAGE_ALIGNMENT);
+    size_t slotStride = pixelOffset + alignUp(size_t(maxWidth) * size_t(maxHeight) * 4, PAGE_ALIGNMENT);
+    size_t size = alignUp(sizeof(SharedRingHeader), PAGE_ALIGNMENT) + slotStride * size_t(slotCount);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 || ftruncate(fd, off_t(size)) < 0) {
+        Logfile::get()->writeError(std::string() + "ERROR in SharedMemoryRing::create: " + strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+        }
+        return false;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        Logfile::get()->writeError(std::string() + "ERROR in SharedMemoryRing::create: " + strerror(errno));
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // ftruncate zero-fills the memory, i.e., all slots have the sequence number 0
+    header = static_cast<SharedRingHeader*>(data);
+    header->version = SHARED_RING_VERSION;
+    header->slotCount = uint32_t(slotCount);
+    header->maxWidth = uint32_t(maxWidth);
+    header->maxHeight = uint32_t(maxHeight);
+    header->slotStride = slotStride;
+    header->pixelOffset = pixelOffset;
+    header->writeCount.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // Consumers check the magic number last
+    header->magic = SHARED_RING_MAGIC;
+
+    this->name = name;
+    isProducer = true;
+    mappedSize = size;
+    return true;
+#endif
+}
+
+bool SharedMemoryRing::open(const std::string& name) {
+    close();
+
+#ifdef _WIN32
+    Logfile::get()->writeError("ERROR in SharedMemoryRing::open: POSIX shared memory isn't available on Windows.");
+    return false;
+#else
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) < 0 || size_t(fileStat.st_size) < sizeof(SharedRingHeader)) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in SharedMemoryRing::open: Couldn't open \"" + name + "\".");
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    size_t size = size_t(fileStat.st_size);
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        Logfile::get()->writeError(std::string() + "ERROR in SharedMemoryRing::open: " + strerror(errno));
+        return false;
+    }
+
+    SharedRingHeader *ringHeader = static_cast<SharedRingHeader*>(data);
+    if (!isValidRingHeader(ringHeader, size)) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in SharedMemoryRing::open: \"" + name + "\" is no valid frame ring.");
+        munmap(data, size);
+        return false;
+    }
+
+    this->name = name;
+    header = ringHeader;
+    isProducer = false;
+    mappedSize = size;
+    lastSequence = 0;
+    return true;
+#endif
+}
+
+void SharedMemoryRing::close() {
+#ifndef _WIN32
+    if (header) {
+        munmap(header, mappedSize);
+        if (isProducer) {
+            shm_unlink(name.c_str());
+        }
+        header = NULL;
+    }
+#endif
+}
+
+SharedFrameHeader *SharedMemoryRing::getSlotHeader(uint64_t slot) {
+    uint8_t *base = reinterpret_cast<uint8_t*>(header) + alignUp(sizeof(SharedRingHeader), PAGE_ALIGNMENT);
+    return reinterpret_cast<SharedFrameHeader*>(base + slot * header->slotStride);
+}
+
+uint8_t *SharedMemoryRing::getSlotPixels(uint64_t slot) {
+    return reinterpret_cast<uint8_t*>(getSlotHeader(slot)) + header->pixelOffset;
+}
+
+uint8_t *SharedMemoryRing::beginWrite() {
+    uint64_t slot = header->writeCount.load(std::memory_order_relaxed) % header->slotCount;
+    SharedFrameHeader *frameHeader = getSlotHeader(slot);
+    frameHeader->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return getSlotPixels(slot);
+}
+
+void SharedMemoryRing::commitWrite(int width, int height, FrameFormat format, uint64_t timestampNs) {
+    uint64_t sequence = header->writeCount.load(std::memory_order_relaxed) + 1;
+    SharedFrameHeader *frameHeader = getSlotHeader((sequence - 1) % header->slotCount);
+    frameHeader->width = uint32_t(width);
+    frameHeader->height = uint32_t(height);
+    frameHeader->format = uint32_t(format);
+    frameHeader->timestampNs = timestampNs;
+    frameHeader->sequence.store(sequence, std::memory_order_release);
+    header->writeCount.store(sequence, std::memory_order_release);
+}
+
+bool SharedMemoryRing::acquireLatest(SharedFrame& frame) {
+    uint64_t sequence = header->writeCount.load(std::memory_order_acquire);
+    if (sequence == 0 || sequence == lastSequence) {
+        return false;
+    }
+
+    uint64_t slot = (sequence - 1) % header->slotCount;
+    SharedFrameHeader *frameHeader = getSlotHeader(slot);
+    if (frameHeader->sequence.load(std::memory_order_acquire) != sequence) {
+        // The producer already started overwriting the slot
+        numOverruns++;
+        return false;
+    }
+    // Read once, as the producer may change the header at any time
+    uint32_t width = frameHeader->width;
+    uint32_t height = frameHeader->height;
+    uint32_t format = frameHeader->format;
+    frame.width = int(width);
+    frame.height = int(height);
+    frame.format = FrameFormat(format);
+    frame.timestampNs = frameHeader->timestampNs;
+    frame.pixels = getSlotPixels(slot);
+    frame.sequence = sequence;
+    if (!isStillValid(frame) || !isValidFrame(width, height, format, header)) {
+        numOverruns++;
+        return false;
+    }
+
+    if (lastSequence != 0 && sequence > lastSequence + 1) {
+        numSkippedFrames += sequence - lastSequence - 1;
+    }
+    lastSequence = sequence;
+    return true;
+}
+
+bool SharedMemoryRing::isStillValid(const SharedFrame& frame) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t slot = (frame.sequence - 1) % header->slotCount;
+    return getSlotHeader(slot)->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
@@ -0,0 +1,140 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SHAREDMEMORYRING_HPP_
+#define SHAREDMEMORYRING_HPP_
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include "FrameData.hpp"
+
+/*
+ * Layout of a frame ring in POSIX shared memory (shm_open). Producer and consumers must run on the same
+ * machine (host byte order, lock-free 64-bit atomics).
+ *
+ * SharedRingHeader | slot 0: SharedFrameHeader, pixels | slot 1: SharedFrameHeader, pixels | ...
+ *
+ * Frame n (starting at 1) is stored in slot (n - 1) % slotCount. The producer sets the sequence number of
+ * the slot to 0 before writing it and to n after writing it, then publishes n in writeCount. Consumers read
+ * the pixels in place and check afterwards whether the sequence number of the slot is unchanged; if not,
+ * the producer overran them and the data may be torn. Gaps between the sequence numbers of consecutively
+ * acquired frames are frames the consumer skipped.
+ */
+
+const uint32_t SHARED_RING_MAGIC = 0x474E5248; // "HRNG"
+const uint32_t SHARED_RING_VERSION = 1;
+
+struct SharedRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t maxWidth;
+    uint32_t maxHeight;
+    uint32_t reserved;
+    //! Bytes from one slot header to the next
+    uint64_t slotStride;
+    //! Offset of the pixel data relative to the slot header
+    uint64_t pixelOffset;
+    //! Number of frames committed so far (= sequence number of the newest frame)
+    std::atomic<uint64_t> writeCount;
+};
+
+struct SharedFrameHeader {
+    //! 0 while the slot is written, otherwise the sequence number of the frame stored in it
+    std::atomic<uint64_t> sequence;
+    uint32_t width;
+    uint32_t height;
+    //! FrameFormat (pixel rows are tightly packed)
+    uint32_t format;
+    uint32_t reserved;
+    //! Producer defined capture time in nanoseconds
+    uint64_t timestampNs;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "Unsupported std::atomic layout");
+
+//! A frame acquired from a SharedMemoryRing. The pixels point directly into the shared memory.
+struct SharedFrame {
+    SharedFrame() : pixels(NULL), width(0), height(0), format(FRAME_FORMAT_RGBA8), sequence(0), timestampNs(0) {}
+    const uint8_t *pixels;
+    int width, height;
+    FrameFormat format;
+    uint64_t sequence;
+    uint64_t timestampNs;
+};
+
+//! Single producer, multiple consumer ring of frames in POSIX shared memory.
+class SharedMemoryRing {
+public:
+    SharedMemoryRing();
+    ~SharedMemoryRing();
+    //! Creates a new ring as producer (replacing an existing one with the same name).
+    bool create(const std::string& name, int slotCount, int maxWidth, int maxHeight);
+    //! Opens an existing ring as consumer.
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return header != NULL; }
+    int getMaxWidth() const { return header ? int(header->maxWidth) : 0; }
+    int getMaxHeight() const { return header ? int(header->maxHeight) : 0; }
+
+    // Producer
+    //! \return Pointer to the pixel data of the next slot (maxWidth * maxHeight * 4 bytes) to write to.
+    uint8_t *beginWrite();
+    //! Publishes the frame written to the pointer returned by beginWrite.
+    void commitWrite(int width, int height, FrameFormat format, uint64_t timestampNs);
+
+    // Consumer
+    /*!
+     * \return false if no frame newer than the last acquired one is available. Frames that were overwritten or
+     * have an invalid header (see getNumOverruns) are not returned either.
+     */
+    bool acquireLatest(SharedFrame& frame);
+    //! \return Whether the frame's pixels are still unchanged (i.e., the producer didn't overrun the consumer).
+    bool isStillValid(const SharedFrame& frame);
+    uint64_t getNumSkippedFrames() const { return numSkippedFrames; }
+    uint64_t getNumOverruns() const { return numOverruns; }
+
+private:
+    SharedFrameHeader *getSlotHeader(uint64_t slot);
+    uint8_t *getSlotPixels(uint64_t slot);
+
+    std::string name;
+    bool isProducer;
+    size_t mappedSize;
+    SharedRingHeader *header;
+
+    uint64_t lastSequence;
+    uint64_t numSkippedFrames, numOverruns;
+};
+
+#endif /* SHAREDMEMORYRING_HPP_ */
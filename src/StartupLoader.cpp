@@ -0,0 +1,131 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include <Utils/File/Logfile.hpp>
+#include "Webcam.hpp"
+#include "GridRenderer.hpp"
+#include "Tracer.hpp"
+#include "StartupLoader.hpp"
+
+using namespace sgl;
+
+StartupLoader::StartupLoader() : startTime(std::chrono::steady_clock::now()), started(false), modelLoading(false),
+        modelLoaded(false) {
+}
+
+StartupLoader::~StartupLoader() {
+    if (webcamThread.joinable()) {
+        webcamThread.join();
+    }
+    if (modelThread.joinable()) {
+        modelThread.join();
+    }
+}
+
+void StartupLoader::start(bool openWebcam, bool nativeYuv, const std::string& modelPath) {
+    started = true;
+    if (openWebcam) {
+        webcamThread = std::thread(&StartupLoader::openWebcam, this, nativeYuv);
+    }
+    modelLoading = true;
+    modelThread = std::thread(&StartupLoader::loadModel, this, modelPath);
+}
+
+void StartupLoader::openWebcam(bool nativeYuv) {
+    Tracer::setThreadName("startup webcam");
+    TRACE_SCOPE("StartupLoader::openWebcam");
+    Webcam *webcam = new Webcam;
+    // The webcam is used anyway if it can't be opened (no frames are shown then, like before the cold start)
+    bool opened = webcam->open(0, nativeYuv);
+    logMilestone(opened ? "webcam opened" : "webcam failed to open");
+    std::lock_guard<std::mutex> lock(mutex);
+    frameSource = FrameSourcePtr(webcam);
+}
+
+void StartupLoader::loadModel(const std::string& modelPath) {
+    Tracer::setThreadName("startup model");
+    GridPredictorPtr loadedGridPredictor;
+    GuideParameters loadedGuide;
+    // The reclaimers (e.g. the idle models of ComparisonRenderer) aren't thread-safe, so the memory budget is only
+    // checked when the main thread takes the model (see MainApp::updateStartupLoading)
+    bool loaded = GridRenderer::loadModel(modelPath, loadedGridPredictor, loadedGuide, false);
+    logMilestone(loaded ? "model loaded" : "model failed to load");
+    std::lock_guard<std::mutex> lock(mutex);
+    gridPredictor = loadedGridPredictor;
+    guide = loadedGuide;
+    modelLoaded = loaded;
+    modelLoading = false;
+}
+
+FrameSourcePtr StartupLoader::takeFrameSource() {
+    std::lock_guard<std::mutex> lock(mutex);
+    FrameSourcePtr openedFrameSource = frameSource;
+    frameSource = FrameSourcePtr();
+    return openedFrameSource;
+}
+
+bool StartupLoader::takeModel(GridPredictorPtr& gridPredictor, GuideParameters& guide) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!modelLoaded) {
+        return false;
+    }
+    gridPredictor = this->gridPredictor;
+    guide = this->guide;
+    this->gridPredictor = GridPredictorPtr();
+    modelLoaded = false;
+    return true;
+}
+
+bool StartupLoader::isModelPending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return modelLoading || modelLoaded;
+}
+
+double StartupLoader::getElapsedMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void StartupLoader::logMilestone(const std::string& name) {
+    double elapsedMs = getElapsedMs();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!reachedMilestones.insert(name).second) {
+            return;
+        }
+    }
+    std::stringstream message;
+    message << std::fixed << std::setprecision(1) << "INFO in StartupLoader: Cold start: " << name << " after "
+            << elapsedMs << " ms";
+    Logfile::get()->writeInfo(message.str());
+}
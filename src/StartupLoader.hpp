@@ -0,0 +1,101 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STARTUPLOADER_HPP_
+#define STARTUPLOADER_HPP_
+
+#include <string>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <boost/shared_ptr.hpp>
+#include "FrameSource.hpp"
+#include "GridPredictor.hpp"
+#include "GuideParameters.hpp"
+
+/**
+ * Cold start of the viewer: Opens the webcam and loads the first model (TensorFlow session, graph, warm-up
+ * inference and guide parameters) in background threads, while the main thread creates the window and compiles
+ * the shaders. The main thread picks up the results with the take functions, which don't block.
+ * Also logs the time from the start of the process to milestones like the first (filtered) frame.
+ */
+class StartupLoader {
+public:
+    //! The cold start is measured from here on, so the loader should be created at the beginning of main.
+    StartupLoader();
+    //! Waits for the background threads.
+    ~StartupLoader();
+
+    /*!
+     * Starts the background threads.
+     * \param openWebcam: false if the frames come from somewhere else (e.g. a shared memory ring)
+     * \param nativeYuv: See Webcam::open
+     * \param modelPath: Folder of the filter shown first
+     */
+    void start(bool openWebcam, bool nativeYuv, const std::string& modelPath);
+    //! \return Whether start was called (otherwise, the loader only logs the milestones).
+    bool isStarted() { return started; }
+    //! \return The webcam once it was opened (an empty pointer before and after it was taken).
+    FrameSourcePtr takeFrameSource();
+    /*!
+     * \return true if the model was loaded (only once). The OpenGL part of the initialization is done by
+     * GridRenderer::setModel on the main thread.
+     */
+    bool takeModel(GridPredictorPtr& gridPredictor, GuideParameters& guide);
+    //! \return Whether takeModel may still return a model (i.e. false after it was taken or if loading failed).
+    bool isModelPending();
+
+    //! Logs the time since the start of the process when a milestone (e.g. "first frame") is reached first.
+    void logMilestone(const std::string& name);
+    double getElapsedMs();
+
+private:
+    void openWebcam(bool nativeYuv);
+    void loadModel(const std::string& modelPath);
+
+    std::chrono::steady_clock::time_point startTime;
+    std::thread webcamThread, modelThread;
+    std::mutex mutex;
+
+    FrameSourcePtr frameSource;
+    GridPredictorPtr gridPredictor;
+    GuideParameters guide;
+    bool started;
+    bool modelLoading;
+    bool modelLoaded;
+    std::set<std::string> reachedMilestones;
+};
+
+typedef boost::shared_ptr<StartupLoader> StartupLoaderPtr;
+
+#endif /* STARTUPLOADER_HPP_ */
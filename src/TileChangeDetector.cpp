@@ -0,0 +1,173 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "TileChangeDetector.hpp"
+
+TileChangeDetector::TileChangeDetector(int tileSize, float gridTolerance, float changeThreshold)
+        : tileSize(std::max(tileSize, 1)), gridTolerance(gridTolerance), changeThreshold(changeThreshold),
+          width(0), height(0), numTilesX(0), numTilesY(0), allTilesChanged(true), numTilesSliced(0),
+          numTilesTotal(0) {
+}
+
+void TileChangeDetector::setTileSize(int tileSize) {
+    this->tileSize = std::max(tileSize, 1);
+    // Forces a reallocation with the next frame
+    width = height = 0;
+    allTilesChanged = true;
+}
+
+void TileChangeDetector::invalidate() {
+    allTilesChanged = true;
+}
+
+void TileChangeDetector::computeTileSignature(const FrameData& frame, int tileX, int tileY, float *signature) const {
+    // The cells have the same size in partial tiles at the right and bottom border (the cells outside of the
+    // frame are empty and have the mean 0 in all frames), so the noise is reduced equally in all tiles
+    int x0 = tileX * tileSize, y0 = tileY * tileSize;
+    int x1 = std::min(x0 + tileSize, frame.w), y1 = std::min(y0 + tileSize, frame.h);
+    for (int cellY = 0; cellY < SIGNATURE_CELLS; cellY++) {
+        int cellY0 = std::min(y0 + tileSize * cellY / SIGNATURE_CELLS, y1);
+        int cellY1 = std::min(y0 + tileSize * (cellY + 1) / SIGNATURE_CELLS, y1);
+        for (int cellX = 0; cellX < SIGNATURE_CELLS; cellX++) {
+            int cellX0 = std::min(x0 + tileSize * cellX / SIGNATURE_CELLS, x1);
+            int cellX1 = std::min(x0 + tileSize * (cellX + 1) / SIGNATURE_CELLS, x1);
+            uint32_t sums[3] = { 0, 0, 0 };
+            for (int y = cellY0; y < cellY1; y++) {
+                const uint8_t *pixel = frame.pixels + (size_t(y) * size_t(frame.w) + size_t(cellX0)) * 4;
+                for (int x = cellX0; x < cellX1; x++, pixel += 4) {
+                    sums[0] += pixel[0];
+                    sums[1] += pixel[1];
+                    sums[2] += pixel[2];
+                }
+            }
+            int numPixels = (cellX1 - cellX0) * (cellY1 - cellY0);
+            float scale = numPixels > 0 ? 1.0f / float(numPixels) : 0.0f;
+            float *cell = signature + (cellY * SIGNATURE_CELLS + cellX) * 3;
+            cell[0] = float(sums[0]) * scale;
+            cell[1] = float(sums[1]) * scale;
+            cell[2] = float(sums[2]) * scale;
+        }
+    }
+}
+
+void TileChangeDetector::update(const FrameData& frame) {
+    if (frame.w != width || frame.h != height) {
+        width = frame.w;
+        height = frame.h;
+        numTilesX = (width + tileSize - 1) / tileSize;
+        numTilesY = (height + tileSize - 1) / tileSize;
+        size_t numTiles = size_t(numTilesX) * size_t(numTilesY);
+        frameSignatures.assign(numTiles * SIGNATURE_SIZE, 0.0f);
+        slicedSignatures.assign(numTiles * SIGNATURE_SIZE, 0.0f);
+        changedTiles.assign(numTiles, 0);
+        allTilesChanged = true;
+    }
+
+    for (int tileY = 0; tileY < numTilesY; tileY++) {
+        for (int tileX = 0; tileX < numTilesX; tileX++) {
+            size_t tileIndex = size_t(tileY) * size_t(numTilesX) + size_t(tileX);
+            float *frameSignature = &frameSignatures[tileIndex * SIGNATURE_SIZE];
+            computeTileSignature(frame, tileX, tileY, frameSignature);
+            if (allTilesChanged || changedTiles[tileIndex]) {
+                continue;
+            }
+            // Compared with the frame the tile was sliced from, so slow changes can't accumulate unnoticed
+            const float *slicedSignature = &slicedSignatures[tileIndex * SIGNATURE_SIZE];
+            for (int i = 0; i < SIGNATURE_SIZE; i++) {
+                if (std::abs(frameSignature[i] - slicedSignature[i]) > changeThreshold) {
+                    changedTiles[tileIndex] = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void TileChangeDetector::updateGrid(const GridCoefficients& grid) {
+    if (!allTilesChanged && grid.gridSize == slicedGrid.gridSize) {
+        // Compared with the grid of the last full update, so small changes can't accumulate
+        const std::vector<float>& coefficients = grid.coefficients;
+        const std::vector<float>& slicedCoefficients = slicedGrid.coefficients;
+        bool gridChanged = false;
+        for (size_t i = 0; i < coefficients.size(); i++) {
+            if (std::abs(coefficients[i] - slicedCoefficients[i]) > gridTolerance) {
+                gridChanged = true;
+                break;
+            }
+        }
+        if (!gridChanged) {
+            return;
+        }
+    }
+    slicedGrid = grid;
+    allTilesChanged = true;
+}
+
+void TileChangeDetector::getChangedTileRects(std::vector<glm::ivec4>& rects) const {
+    rects.clear();
+    for (int tileY = 0; tileY < numTilesY; tileY++) {
+        const char *rowTiles = &changedTiles.front() + size_t(tileY) * size_t(numTilesX);
+        int tileX = 0;
+        while (tileX < numTilesX) {
+            if (!allTilesChanged && !rowTiles[tileX]) {
+                tileX++;
+                continue;
+            }
+            int runStart = tileX;
+            while (tileX < numTilesX && (allTilesChanged || rowTiles[tileX])) {
+                tileX++;
+            }
+            rects.push_back(glm::ivec4(
+                    runStart * tileSize, tileY * tileSize,
+                    std::min(tileX * tileSize, width), std::min((tileY + 1) * tileSize, height)));
+        }
+    }
+}
+
+void TileChangeDetector::markSliced() {
+    size_t numTiles = changedTiles.size();
+    size_t numChangedTiles = 0;
+    for (size_t tileIndex = 0; tileIndex < numTiles; tileIndex++) {
+        if (allTilesChanged || changedTiles[tileIndex]) {
+            std::copy(frameSignatures.begin() + tileIndex * SIGNATURE_SIZE,
+                      frameSignatures.begin() + (tileIndex + 1) * SIGNATURE_SIZE,
+                      slicedSignatures.begin() + tileIndex * SIGNATURE_SIZE);
+            numChangedTiles++;
+        }
+    }
+    numTilesSliced += numChangedTiles;
+    numTilesTotal += numTiles;
+    std::fill(changedTiles.begin(), changedTiles.end(), 0);
+    allTilesChanged = false;
+}
@@ -0,0 +1,106 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TILECHANGEDETECTOR_HPP_
+#define TILECHANGEDETECTOR_HPP_
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+#include "GridCoefficients.hpp"
+
+/**
+ * Keeps track of which tiles of a cached sliced output are out of date. For every input frame, a signature of
+ * each tile (the mean colors of 8x8 cells) is compared with the signature of the frame the cached tile was
+ * sliced from. A tile is out of date if a cell mean differs by more than a threshold, so sensor noise, which
+ * mostly averages out within the cells, doesn't invalidate the whole frame. All tiles are out of date if the
+ * grid differs from the grid of the cached output by more than a tolerance.
+ * Changes accumulate until markSliced is called, so frames that weren't sliced can be skipped.
+ */
+class TileChangeDetector {
+public:
+    /*!
+     * \param tileSize: Width and height of the tiles in pixels
+     * \param gridTolerance: Maximum absolute difference of the grid coefficients that doesn't invalidate the
+     * cached output. The network never predicts identical grids for camera frames, and 1e-3 changes the
+     * sliced colors by less than one 8-bit step.
+     * \param changeThreshold: Maximum absolute difference of the cell means (in 8-bit steps) that doesn't
+     * invalidate a tile. With 64x64 tiles, the cells have 8x8 pixels, which reduces the noise by a factor of 8.
+     * 0 re-slices a tile whenever one of its cell means changes.
+     */
+    explicit TileChangeDetector(int tileSize = 64, float gridTolerance = 1e-3f, float changeThreshold = 3.0f);
+    void setTileSize(int tileSize);
+    int getTileSize() const { return tileSize; }
+    void setChangeThreshold(float threshold) { changeThreshold = threshold; }
+    float getChangeThreshold() const { return changeThreshold; }
+
+    //! Marks the tiles of frame that differ from the frame they were last sliced from as changed.
+    void update(const FrameData& frame);
+    //! Marks all tiles as changed if grid differs from the grid used for the cached output.
+    void updateGrid(const GridCoefficients& grid);
+    //! Marks all tiles as changed (e.g., after the filter changed).
+    void invalidate();
+
+    //! Rectangles (x0, y0, x1, y1) covering the changed tiles (horizontally adjacent tiles are merged).
+    void getChangedTileRects(std::vector<glm::ivec4>& rects) const;
+    //! Called after the changed tiles were sliced from the last frame passed to update. Updates the statistics.
+    void markSliced();
+
+    // Statistics since the last reset
+    uint64_t getNumTilesSliced() const { return numTilesSliced; }
+    uint64_t getNumTilesTotal() const { return numTilesTotal; }
+    //! \return The fraction of tiles that were sliced again (1 = no savings).
+    double getChangedTileRatio() const {
+        return numTilesTotal > 0 ? double(numTilesSliced) / double(numTilesTotal) : 1.0;
+    }
+    void resetStatistics() { numTilesSliced = numTilesTotal = 0; }
+
+private:
+    //! Number of cells per tile row/column of a signature
+    static const int SIGNATURE_CELLS = 8;
+    static const int SIGNATURE_SIZE = SIGNATURE_CELLS * SIGNATURE_CELLS * 3;
+    //! Writes the mean RGB colors of the cells of the tile to signature (SIGNATURE_SIZE values).
+    void computeTileSignature(const FrameData& frame, int tileX, int tileY, float *signature) const;
+
+    int tileSize;
+    float gridTolerance, changeThreshold;
+    int width, height, numTilesX, numTilesY;
+    //! Signatures of the tiles of the last frame and of the frame each tile was last sliced from
+    std::vector<float> frameSignatures, slicedSignatures;
+    std::vector<char> changedTiles;
+    bool allTilesChanged;
+    GridCoefficients slicedGrid;
+
+    uint64_t numTilesSliced, numTilesTotal;
+};
+
+#endif /* TILECHANGEDETECTOR_HPP_ */
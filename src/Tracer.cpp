@@ -0,0 +1,192 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <chrono>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include <Utils/File/Logfile.hpp>
+#include "Tracer.hpp"
+
+using namespace sgl;
+
+static int getProcessId() {
+#ifdef _WIN32
+    return int(_getpid());
+#else
+    return int(getpid());
+#endif
+}
+
+std::atomic<bool> Tracer::enabled(false);
+
+// The buffer is assigned when the thread records its first span and given back when the thread exits
+struct ThreadTraceBufferHolder {
+    ThreadTraceBufferHolder() : buffer(NULL) {}
+    ~ThreadTraceBufferHolder() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(Tracer::get()->mutex);
+            buffer->inUse = false;
+        }
+    }
+    TraceBuffer *buffer;
+};
+static thread_local ThreadTraceBufferHolder threadTraceBuffer;
+static thread_local std::string threadName;
+
+TraceBuffer::TraceBuffer(uint32_t threadId, const std::string& threadName)
+        : threadName(threadName), inUse(true), events(CAPACITY), numEvents(0), threadId(threadId) {
+}
+
+void TraceBuffer::copyEvents(std::vector<TraceEvent>& copiedEvents) {
+    uint64_t end = numEvents.load(std::memory_order_acquire);
+    uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+    std::vector<TraceEvent> eventsCopy;
+    eventsCopy.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++) {
+        eventsCopy.push_back(events[i & (CAPACITY - 1)]);
+    }
+
+    // Spans the owning thread may have overwritten in the meantime are dropped. This includes the slot of the
+    // unpublished span endAfterCopy, which the thread may be writing right now.
+    uint64_t endAfterCopy = numEvents.load(std::memory_order_acquire);
+    uint64_t firstValid = endAfterCopy + 1 > CAPACITY ? endAfterCopy + 1 - CAPACITY : 0;
+    for (uint64_t i = std::max(begin, firstValid); i < end; i++) {
+        copiedEvents.push_back(eventsCopy.at(i - begin));
+    }
+}
+
+Tracer::Tracer() : nextThreadId(1), recordingStartNs(0), recordingEndNs(0) {
+}
+
+Tracer *Tracer::get() {
+    static Tracer tracer;
+    return &tracer;
+}
+
+uint64_t Tracer::getTimeNs() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Tracer::recordEvent(const char *name, uint64_t startNs, uint64_t endNs) {
+    if (!threadTraceBuffer.buffer) {
+        threadTraceBuffer.buffer = get()->registerThread();
+    }
+    threadTraceBuffer.buffer->addEvent(name, startNs, endNs);
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    threadName = name;
+    if (threadTraceBuffer.buffer) {
+        std::lock_guard<std::mutex> lock(get()->mutex);
+        threadTraceBuffer.buffer->threadName = name;
+    }
+}
+
+TraceBuffer *Tracer::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // The buffers are kept after the thread exits, so that its spans can still be written
+    for (TraceBufferPtr& buffer : buffers) {
+        if (!buffer->inUse) {
+            buffer->inUse = true;
+            if (!threadName.empty()) {
+                buffer->threadName = threadName;
+            }
+            return buffer.get();
+        }
+    }
+    uint32_t threadId = nextThreadId++;
+    std::string name = threadName.empty() ? "thread " + std::to_string(threadId) : threadName;
+    buffers.push_back(TraceBufferPtr(new TraceBuffer(threadId, name)));
+    return buffers.back().get();
+}
+
+void Tracer::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    recordingStartNs = getTimeNs();
+    recordingEndNs = 0;
+    enabled.store(true);
+}
+
+void Tracer::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enabled.load()) {
+        recordingEndNs = getTimeNs();
+        enabled.store(false);
+    }
+}
+
+bool Tracer::writeChromeTrace(const std::string& filename) {
+    std::ofstream file(filename.c_str());
+    if (!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in Tracer::writeChromeTrace: Couldn't open file \"" + filename + "\".");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t endNs = recordingEndNs != 0 ? recordingEndNs : getTimeNs();
+    int processId = getProcessId();
+    size_t numEventsWritten = 0;
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < buffers.size(); i++) {
+        TraceBufferPtr& buffer = buffers.at(i);
+        file << (i == 0 ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << processId
+             << ", \"tid\": " << buffer->getThreadId() << ", \"args\": {\"name\": \"" << buffer->threadName << "\"}}";
+
+        std::vector<TraceEvent> events;
+        buffer->copyEvents(events);
+        for (const TraceEvent& event : events) {
+            if (event.startNs < recordingStartNs || event.startNs > endNs) {
+                continue;
+            }
+            file << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"hdrnet\", \"ph\": \"X\", \"ts\": "
+                 << double(event.startNs - recordingStartNs) * 1e-3 << ", \"dur\": "
+                 << double(event.endNs - event.startNs) * 1e-3 << ", \"pid\": " << processId
+                 << ", \"tid\": " << buffer->getThreadId() << "}";
+            numEventsWritten++;
+        }
+    }
+    file << "\n]}\n";
+    file.close();
+
+    Logfile::get()->writeInfo(
+            std::string() + "Wrote " + std::to_string(numEventsWritten) + " trace events to \"" + filename + "\".");
+    return true;
+}
@@ -0,0 +1,143 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TRACER_HPP_
+#define TRACER_HPP_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <boost/shared_ptr.hpp>
+
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+/**
+ * Records the time until the end of the enclosing scope as a span named name (a string literal).
+ * Costs a single relaxed atomic load while tracing is off.
+ */
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+struct TraceEvent {
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+/**
+ * Ring buffer of the spans recorded by one thread. Only the owning thread writes to it, so recording a
+ * span needs no locks. When the buffer is full, the oldest spans are overwritten.
+ * The buffer of a thread that exited is handed to the next new thread (e.g. of the next server client).
+ */
+class TraceBuffer {
+public:
+    TraceBuffer(uint32_t threadId, const std::string& threadName);
+
+    inline void addEvent(const char *name, uint64_t startNs, uint64_t endNs) {
+        uint64_t index = numEvents.load(std::memory_order_relaxed);
+        TraceEvent& event = events[index & (CAPACITY - 1)];
+        event.name = name;
+        event.startNs = startNs;
+        event.endNs = endNs;
+        numEvents.store(index + 1, std::memory_order_release);
+    }
+    //! Appends all spans that weren't overwritten while copying them (called by other threads).
+    void copyEvents(std::vector<TraceEvent>& copiedEvents);
+
+    uint32_t getThreadId() const { return threadId; }
+    std::string threadName;
+    bool inUse;
+
+private:
+    static const uint64_t CAPACITY = 1 << 16; // Power of two
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> numEvents;
+    uint32_t threadId;
+};
+
+typedef boost::shared_ptr<TraceBuffer> TraceBufferPtr;
+
+/**
+ * Collects the spans of all threads and writes them in the Chrome trace event format, which can be
+ * opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class Tracer {
+public:
+    static Tracer *get();
+    static inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    //! Monotonic time stamp used for all spans
+    static uint64_t getTimeNs();
+    //! Called by TraceScope (only while tracing is enabled)
+    static void recordEvent(const char *name, uint64_t startNs, uint64_t endNs);
+    //! Name of the calling thread in the trace (e.g. "inference")
+    static void setThreadName(const std::string& name);
+
+    //! Starts recording. Spans recorded before are discarded.
+    void start();
+    void stop();
+    //! Writes the spans recorded between start and stop (or now, if still recording).
+    bool writeChromeTrace(const std::string& filename);
+
+private:
+    Tracer();
+    TraceBuffer *registerThread();
+    friend struct ThreadTraceBufferHolder;
+
+    static std::atomic<bool> enabled;
+    std::mutex mutex;
+    std::vector<TraceBufferPtr> buffers;
+    uint32_t nextThreadId;
+    uint64_t recordingStartNs;
+    uint64_t recordingEndNs;
+};
+
+//! Records a span from construction to destruction (see TRACE_SCOPE).
+class TraceScope {
+public:
+    explicit inline TraceScope(const char *name) : name(name), startNs(0) {
+        if (Tracer::isEnabled()) {
+            startNs = Tracer::getTimeNs();
+        }
+    }
+    inline ~TraceScope() {
+        if (startNs != 0 && Tracer::isEnabled()) {
+            Tracer::recordEvent(name, startNs, Tracer::getTimeNs());
+        }
+    }
+
+private:
+    const char *name;
+    uint64_t startNs;
+};
+
+#endif /* TRACER_HPP_ */
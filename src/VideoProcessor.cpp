@@ -0,0 +1,368 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/opencv.hpp>
+#include <Utils/File/Logfile.hpp>
+#include "GridPredictor.hpp"
+#include "CpuSlicer.hpp"
+#include "IncrementalSlicer.hpp"
+#include "ImageUtils.hpp"
+#include "Tracer.hpp"
+#include "MemoryAccounting.hpp"
+#include "VideoProcessor.hpp"
+
+using namespace sgl;
+
+// Shorter segments don't amortize loading the session and seeking
+const int MIN_SEGMENT_FRAMES = 30;
+
+static std::string shellQuote(const std::string& argument) {
+    std::string quotedArgument = "'";
+    for (char c : argument) {
+        if (c == '\'') {
+            quotedArgument += "'\\''";
+        } else {
+            quotedArgument += c;
+        }
+    }
+    return quotedArgument + "'";
+}
+
+static int getFourcc(const std::string& codec) {
+    std::string code = codec + "    ";
+#if (CV_VERSION_MAJOR <= 2)
+    return CV_FOURCC(code[0], code[1], code[2], code[3]);
+#else
+    return cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+#endif
+}
+
+VideoProcessor::VideoProcessor(const VideoProcessingSettings& settings)
+        : settings(settings), frameWidth(0), frameHeight(0), numFramesTotal(0), framesPerSecond(30.0),
+          nextSegmentIndex(0), numFramesProcessed(0), numFinishedWorkers(0), numTilesSliced(0), numTilesTotal(0) {
+}
+
+bool VideoProcessor::readVideoProperties() {
+    cv::VideoCapture capture(settings.inputFilename);
+    if (!capture.isOpened()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in VideoProcessor::run: Couldn't open \"" + settings.inputFilename + "\".");
+        return false;
+    }
+#if (CV_VERSION_MAJOR <= 2)
+    frameWidth = int(capture.get(CV_CAP_PROP_FRAME_WIDTH));
+    frameHeight = int(capture.get(CV_CAP_PROP_FRAME_HEIGHT));
+    numFramesTotal = int(capture.get(CV_CAP_PROP_FRAME_COUNT));
+    framesPerSecond = capture.get(CV_CAP_PROP_FPS);
+#else
+    frameWidth = int(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+    frameHeight = int(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    numFramesTotal = int(capture.get(cv::CAP_PROP_FRAME_COUNT));
+    framesPerSecond = capture.get(cv::CAP_PROP_FPS);
+#endif
+    if (framesPerSecond <= 0.0) {
+        framesPerSecond = 30.0;
+    }
+    return frameWidth > 0 && frameHeight > 0;
+}
+
+void VideoProcessor::createSegments() {
+    int numWorkers = settings.numWorkers > 0 ? settings.numWorkers : int(std::thread::hardware_concurrency());
+    numWorkers = std::max(numWorkers, 1);
+
+    // Without a (reliable) frame count, the video can't be split
+    int numSegments = 1;
+    if (numFramesTotal > 0) {
+        numSegments = std::max(numWorkers * std::max(settings.segmentsPerWorker, 1), 1);
+        numSegments = std::min(numSegments, std::max(numFramesTotal / MIN_SEGMENT_FRAMES, 1));
+    }
+    int framesPerSegment = numFramesTotal > 0 ? (numFramesTotal + numSegments - 1) / numSegments : -1;
+
+    boost::filesystem::path outputPath(settings.outputFilename);
+    segments.clear();
+    for (int i = 0; i < numSegments; i++) {
+        Segment segment;
+        segment.firstFrame = i * framesPerSegment;
+        // The frame count of the container may be inaccurate, so the last segment reads until the end
+        segment.numFrames = i == numSegments - 1 ? -1 : framesPerSegment;
+        std::ostringstream filename;
+        filename << (outputPath.parent_path() / outputPath.stem()).string() << ".part"
+                 << std::setw(4) << std::setfill('0') << i << outputPath.extension().string();
+        segment.filename = filename.str();
+        segment.success = false;
+        segments.push_back(segment);
+    }
+    statistics.numWorkers = std::min(numWorkers, numSegments);
+}
+
+bool VideoProcessor::run() {
+    if (!readVideoProperties() || !guide.load(settings.modelPath)) {
+        return false;
+    }
+    createSegments();
+    Logfile::get()->writeInfo(
+            std::string() + "Processing " + settings.inputFilename + " (" + std::to_string(numFramesTotal)
+            + " frames) in " + std::to_string(segments.size()) + " segments with "
+            + std::to_string(statistics.numWorkers) + " workers");
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < statistics.numWorkers; i++) {
+        workers.push_back(std::thread(&VideoProcessor::workerLoop, this, i));
+    }
+
+    double lastReportS = 0.0;
+    while (numFinishedWorkers < statistics.numWorkers) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (settings.reportIntervalS > 0 && elapsedS - lastReportS >= settings.reportIntervalS) {
+            reportProgress(elapsedS);
+            lastReportS = elapsedS;
+        }
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    bool success = true;
+    for (Segment& segment : segments) {
+        success = success && segment.success;
+    }
+    std::chrono::steady_clock::time_point stitchingStartTime = std::chrono::steady_clock::now();
+    if (success) {
+        success = stitchSegments();
+    } else {
+        Logfile::get()->writeError("ERROR in VideoProcessor::run: Not all segments could be processed.");
+    }
+    if (!settings.keepSegments) {
+        removeSegmentFiles();
+    }
+
+    std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    statistics.numFrames = numFramesProcessed;
+    statistics.elapsedS = std::chrono::duration<double>(endTime - startTime).count();
+    statistics.stitchingS = std::chrono::duration<double>(endTime - stitchingStartTime).count();
+    if (numTilesTotal > 0) {
+        statistics.changedTileRatio = double(numTilesSliced) / double(numTilesTotal);
+    }
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2) << "Processed " << statistics.numFrames << " frames in "
+            << statistics.elapsedS << " s (" << statistics.getFramesPerSecond() << " frames/s, stitching "
+            << statistics.stitchingS << " s";
+    if (settings.incrementalSlicing) {
+        summary << ", " << statistics.changedTileRatio * 100.0 << "% of the tiles sliced";
+    }
+    summary << ")" << std::endl << MemoryAccounting::get()->getSummary();
+    Logfile::get()->writeInfo(summary.str());
+    return success;
+}
+
+void VideoProcessor::reportProgress(double elapsedS) {
+    int numFrames = numFramesProcessed;
+    double throughput = numFrames / elapsedS;
+    std::ostringstream progress;
+    progress << std::fixed << std::setprecision(1) << "Processed " << numFrames;
+    if (numFramesTotal > 0) {
+        progress << "/" << numFramesTotal << " frames (" << 100.0 * numFrames / numFramesTotal << "%), "
+                 << throughput << " frames/s, ";
+        if (throughput > 0.0) {
+            progress << std::max(numFramesTotal - numFrames, 0) / throughput << " s remaining";
+        }
+    } else {
+        progress << " frames, " << throughput << " frames/s";
+    }
+    Logfile::get()->writeInfo(progress.str());
+}
+
+void VideoProcessor::workerLoop(int workerIndex) {
+    Tracer::setThreadName("video worker " + std::to_string(workerIndex));
+    GridPredictor gridPredictor;
+    if (gridPredictor.loadGraph(settings.modelPath, settings.threadsPerWorker)) {
+        CpuSlicer cpuSlicer(settings.threadsPerWorker);
+        cpuSlicer.setGuideParameters(guide);
+        // The segments left over by a failed worker are taken by the others
+        while (true) {
+            // All workers stop if the memory budget can't be met
+            if (MemoryAccounting::get()->hasBudgetFailure()) {
+                break;
+            }
+            int segmentIndex = nextSegmentIndex++;
+            if (segmentIndex >= int(segments.size())) {
+                break;
+            }
+            Segment& segment = segments.at(segmentIndex);
+            segment.success = processSegment(segment, gridPredictor, cpuSlicer);
+        }
+    }
+    numFinishedWorkers++;
+}
+
+bool VideoProcessor::processSegment(Segment& segment, GridPredictor& gridPredictor, CpuSlicer& cpuSlicer) {
+    TRACE_SCOPE("VideoProcessor::processSegment");
+    cv::VideoCapture capture(settings.inputFilename);
+    if (!capture.isOpened()) {
+        return false;
+    }
+    if (segment.firstFrame > 0) {
+        // Decodes from the preceding keyframe up to the first frame of the segment
+#if (CV_VERSION_MAJOR <= 2)
+        capture.set(CV_CAP_PROP_POS_FRAMES, segment.firstFrame);
+#else
+        capture.set(cv::CAP_PROP_POS_FRAMES, segment.firstFrame);
+#endif
+    }
+    cv::VideoWriter writer(
+            segment.filename, getFourcc(settings.codec), framesPerSecond, cv::Size(frameWidth, frameHeight), true);
+    if (!writer.isOpened()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in VideoProcessor::processSegment: Couldn't create \"" + segment.filename
+                + "\" with codec " + settings.codec + ".");
+        return false;
+    }
+
+    FrameData frame, slicedFrame;
+    FrameDataPtr lowresImage(new FrameData);
+    // Segments start with a full frame anyway, so every segment has its own tile cache
+    IncrementalSlicer incrementalSlicer(cpuSlicer, 64, settings.tileChangeThreshold);
+    cv::Mat bgrFrame, bgrOutput;
+    for (int i = 0; segment.numFrames < 0 || i < segment.numFrames; i++) {
+        if (!capture.read(bgrFrame)) {
+            break;
+        }
+        TRACE_SCOPE("VideoProcessor::processFrame");
+        frame.allocate(bgrFrame.cols, bgrFrame.rows);
+        cv::Mat rgbaFrame(frame.h, frame.w, CV_8UC4, frame.pixels);
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(bgrFrame, rgbaFrame, CV_BGR2RGBA, 4);
+#else
+        cv::cvtColor(bgrFrame, rgbaFrame, cv::COLOR_BGR2RGBA, 4);
+#endif
+
+        // The buffers of the segment were allocated while processing the first frame
+        if (i == 1 && !MemoryAccounting::get()->checkBudget("VideoProcessor::processSegment")) {
+            return false;
+        }
+
+        downscaleForInference(frame, *lowresImage);
+        GridCoefficientsPtr grid = gridPredictor.computeGridCoefficients(*lowresImage);
+        if (!grid) {
+            return false;
+        }
+        const FrameData *output = &slicedFrame;
+        if (settings.incrementalSlicing) {
+            output = &incrementalSlicer.slice(frame, *grid);
+        } else {
+            cpuSlicer.slice(frame, *grid, slicedFrame);
+        }
+
+        cv::Mat rgbaOutput(output->h, output->w, CV_8UC4, output->pixels);
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(rgbaOutput, bgrOutput, CV_RGBA2BGR, 3);
+#else
+        cv::cvtColor(rgbaOutput, bgrOutput, cv::COLOR_RGBA2BGR, 3);
+#endif
+        writer.write(bgrOutput);
+        numFramesProcessed++;
+    }
+    numTilesSliced += incrementalSlicer.getTileChangeDetector().getNumTilesSliced();
+    numTilesTotal += incrementalSlicer.getTileChangeDetector().getNumTilesTotal();
+    return true;
+}
+
+bool VideoProcessor::stitchSegments() {
+    if (segments.size() == 1 && !settings.keepSegments) {
+        boost::system::error_code errorCode;
+        boost::filesystem::rename(segments.front().filename, settings.outputFilename, errorCode);
+        if (!errorCode) {
+            return true;
+        }
+    }
+    // Concatenating the encoded streams is much faster than encoding all frames again
+    if (std::system("ffmpeg -version > /dev/null 2>&1") == 0 && stitchSegmentsWithFfmpeg()) {
+        return true;
+    }
+    return stitchSegmentsByReencoding();
+}
+
+bool VideoProcessor::stitchSegmentsWithFfmpeg() {
+    std::string listFilename = settings.outputFilename + ".segments.txt";
+    {
+        std::ofstream listFile(listFilename.c_str());
+        for (Segment& segment : segments) {
+            std::string path = boost::filesystem::absolute(segment.filename).string();
+            listFile << "file " << shellQuote(path) << "\n";
+        }
+    }
+    std::string command = "ffmpeg -y -loglevel error -f concat -safe 0 -i " + shellQuote(listFilename)
+            + " -c copy " + shellQuote(settings.outputFilename);
+    bool success = std::system(command.c_str()) == 0;
+    boost::system::error_code errorCode;
+    boost::filesystem::remove(listFilename, errorCode);
+    return success;
+}
+
+bool VideoProcessor::stitchSegmentsByReencoding() {
+    cv::VideoWriter writer(
+            settings.outputFilename, getFourcc(settings.codec), framesPerSecond,
+            cv::Size(frameWidth, frameHeight), true);
+    if (!writer.isOpened()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in VideoProcessor::stitchSegments: Couldn't create \""
+                + settings.outputFilename + "\".");
+        return false;
+    }
+    cv::Mat frame;
+    for (Segment& segment : segments) {
+        cv::VideoCapture capture(segment.filename);
+        while (capture.read(frame)) {
+            writer.write(frame);
+        }
+    }
+    return true;
+}
+
+void VideoProcessor::removeSegmentFiles() {
+    for (Segment& segment : segments) {
+        boost::system::error_code errorCode;
+        boost::filesystem::remove(segment.filename, errorCode);
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef VIDEOPROCESSOR_HPP_
+#define VIDEOPROCESSOR_HPP_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include "GuideParameters.hpp"
+
+class GridPredictor;
+class CpuSlicer;
+
+struct VideoProcessingSettings {
+    VideoProcessingSettings() : numWorkers(0), threadsPerWorker(1), segmentsPerWorker(4), codec("MJPG"),
+            keepSegments(false), reportIntervalS(2), incrementalSlicing(false), tileChangeThreshold(3.0f) {}
+    std::string modelPath;
+    std::string inputFilename;
+    std::string outputFilename;
+    //! Number of segments processed in parallel, each with its own TensorFlow session (0 = hardware threads)
+    int numWorkers;
+    //! Threads used by the session and the slicing of one worker
+    int threadsPerWorker;
+    //! The video is split into more segments than workers so that fast workers can take over work
+    int segmentsPerWorker;
+    //! FOURCC code of the output codec (all segments are encoded with the same settings)
+    std::string codec;
+    bool keepSegments;
+    //! Interval of the progress report in seconds (0 = no report)
+    int reportIntervalS;
+    //! Only re-slices the tiles that changed since the previous frame (see IncrementalSlicer)
+    bool incrementalSlicing;
+    //! Difference of the cell means of a tile (in 8-bit steps) up to which it isn't sliced again
+    float tileChangeThreshold;
+};
+
+struct VideoProcessingStatistics {
+    VideoProcessingStatistics() : numFrames(0), numWorkers(0), elapsedS(0.0), stitchingS(0.0),
+            changedTileRatio(1.0) {}
+    int numFrames;
+    int numWorkers;
+    //! Total time including stitching
+    double elapsedS;
+    double stitchingS;
+    //! Fraction of the tiles sliced with incremental slicing (1 = all tiles)
+    double changedTileRatio;
+    double getFramesPerSecond() const { return elapsedS > 0.0 ? numFrames / elapsedS : 0.0; }
+};
+
+/**
+ * Enhances a video file offline using all cores. The video is split into segments, which are decoded,
+ * filtered and encoded independently by a pool of workers. Afterwards, the encoded segments are
+ * concatenated in order (with ffmpeg if available, otherwise by decoding and encoding them again).
+ */
+class VideoProcessor {
+public:
+    explicit VideoProcessor(const VideoProcessingSettings& settings);
+    bool run();
+    const VideoProcessingStatistics& getStatistics() const { return statistics; }
+
+private:
+    struct Segment {
+        int firstFrame;
+        //! -1 = until the end of the video
+        int numFrames;
+        std::string filename;
+        bool success;
+    };
+
+    bool readVideoProperties();
+    void createSegments();
+    void workerLoop(int workerIndex);
+    bool processSegment(Segment& segment, GridPredictor& gridPredictor, CpuSlicer& cpuSlicer);
+    void reportProgress(double elapsedS);
+    bool stitchSegments();
+    bool stitchSegmentsWithFfmpeg();
+    bool stitchSegmentsByReencoding();
+    void removeSegmentFiles();
+
+    VideoProcessingSettings settings;
+    VideoProcessingStatistics statistics;
+    GuideParameters guide;
+
+    // Properties of the input video
+    int frameWidth, frameHeight, numFramesTotal;
+    double framesPerSecond;
+
+    std::vector<Segment> segments;
+    std::atomic<int> nextSegmentIndex;
+    std::atomic<int> numFramesProcessed;
+    std::atomic<int> numFinishedWorkers;
+    std::atomic<uint64_t> numTilesSliced, numTilesTotal;
+};
+
+#endif /* VIDEOPROCESSOR_HPP_ */
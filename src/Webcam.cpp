@@ -30,23 +30,18 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstring>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/opencv.hpp>
 #include <Utils/File/Logfile.hpp>
+#include <Utils/Timer.hpp>
+#include "Tracer.hpp"
+#include "PerfCounters.hpp"
 #include "Webcam.hpp"
 
 using namespace sgl;
 
-FrameData::FrameData() : pixels(NULL), w(0), h(0) {
-}
-
-FrameData::~FrameData() {
-    if (pixels) {
-        delete pixels;
-    }
-}
-
-Webcam::Webcam() : stream(NULL) {
+Webcam::Webcam() : stream(NULL), lastConversionTimeMs(0.0f), nativeYuv(false), resolution(0, 0) {
 }
 
 Webcam::~Webcam() {
@@ -55,7 +50,7 @@ Webcam::~Webcam() {
     }
 }
 
-bool Webcam::open(int id) {
+bool Webcam::open(int id, bool nativeYuv) {
     stream = new cv::VideoCapture(id);
 
     if (!stream->isOpened()) {
@@ -74,46 +69,142 @@ bool Webcam::open(int id) {
     //std::cout << "Camera resolution width is " << stream->get(cv::CAP_PROP_FRAME_WIDTH) << std::endl;
     //std::cout << "Camera resolution width is " << stream->get(cv::CAP_PROP_FRAME_WIDTH) << " | change is ok: " << ((int)b1) << std::endl;
 
+    if (nativeYuv) {
+        // Keep the frames in the layout of the camera; the conversion happens on the GPU or in the slicer
+#if (CV_VERSION_MAJOR <= 2)
+        stream->set(CV_CAP_PROP_FOURCC, CV_FOURCC('Y', 'U', 'Y', 'V'));
+        this->nativeYuv = stream->set(CV_CAP_PROP_CONVERT_RGB, 0);
+#else
+        stream->set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+        this->nativeYuv = stream->set(cv::CAP_PROP_CONVERT_RGB, 0);
+#endif
+        if (!this->nativeYuv) {
+            Logfile::get()->writeInfo("INFO in Webcam::open: Capture backend can't deliver raw YUV frames.");
+        }
+    }
+
+    updateCachedResolution();
+    return true;
+}
+
+void Webcam::updateCachedResolution() {
+#if (CV_VERSION_MAJOR <= 2)
+    resolution = glm::ivec2(stream->get(CV_CAP_PROP_FRAME_WIDTH), stream->get(CV_CAP_PROP_FRAME_HEIGHT));
+#else
+    resolution = glm::ivec2(stream->get(cv::CAP_PROP_FRAME_WIDTH), stream->get(cv::CAP_PROP_FRAME_HEIGHT));
+#endif
+}
+
+bool Webcam::copyRawFrame(const cv::Mat& frame, YuvFrame& yuvFrame) {
+    // Without CAP_PROP_CONVERT_RGB, V4L2 returns the raw buffer as a single row (or a 2-channel image for YUYV)
+    size_t numBytes = frame.total() * frame.elemSize();
+    FrameFormat format = FRAME_FORMAT_BGR8;
+    if (frame.isContinuous() && resolution.x % 2 == 0 && resolution.y % 2 == 0) {
+        if (numBytes == YuvFrame::getFrameSize(FRAME_FORMAT_YUYV, resolution.x, resolution.y)) {
+            format = FRAME_FORMAT_YUYV;
+        } else if (numBytes == YuvFrame::getFrameSize(FRAME_FORMAT_NV12, resolution.x, resolution.y)) {
+            format = FRAME_FORMAT_NV12;
+        }
+    }
+
+    if (format == FRAME_FORMAT_BGR8) {
+        Logfile::get()->writeInfo(
+                "INFO in Webcam::copyRawFrame: Camera doesn't deliver YUYV or NV12 frames. "
+                "Falling back to RGB frames.");
+        nativeYuv = false;
+#if (CV_VERSION_MAJOR <= 2)
+        stream->set(CV_CAP_PROP_CONVERT_RGB, 1);
+#else
+        stream->set(cv::CAP_PROP_CONVERT_RGB, 1);
+#endif
+        return false;
+    }
+
+    yuvFrame.allocate(format, resolution.x, resolution.y);
+    memcpy(&yuvFrame.data.front(), frame.data, numBytes);
+    return true;
+}
+
+bool Webcam::readYuvFrame(YuvFramePtr yuvFrame, FrameDataPtr downscaledImage) {
+    TRACE_SCOPE("Webcam::readYuvFrame");
+    cv::Mat frame;
+    if (!nativeYuv || !stream->read(frame)) {
+        return false;
+    }
+    TRACE_SCOPE("Webcam::convertFrame");
+    uint64_t startTime = Timer->getTicksMicroseconds();
+    if (!copyRawFrame(frame, *yuvFrame)) {
+        return false;
+    }
+    {
+        PERF_SCOPE("Webcam::downscaleYuv", uint64_t(yuvFrame->w) * uint64_t(yuvFrame->h));
+        downscaleYuvForInference(*yuvFrame, *downscaledImage);
+    }
+    lastConversionTimeMs = (Timer->getTicksMicroseconds() - startTime) / 1000.0f;
     return true;
 }
 
 bool Webcam::readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage) {
+    TRACE_SCOPE("Webcam::readFrame");
     cv::Mat frame;
     if (!stream->read(frame)) {
         // No frame to be read
         return false;
     }
-
-    if (frameImage->pixels == 0) {
-        frameImage->pixels = new uchar[frame.total()*4];
-        frameImage->w = frame.cols;
-        frameImage->h = frame.rows;
-        downscaledImage->pixels = new uchar[256*256*4];
-        downscaledImage->w = 256;
-        downscaledImage->h = 256;
+    TRACE_SCOPE("Webcam::convertFrame");
+    uint64_t startTime = Timer->getTicksMicroseconds();
+
+    if (nativeYuv) {
+        // Raw frames need to be converted by the viewer, e.g. in comparison mode
+        if (copyRawFrame(frame, rawFrame)) {
+            PERF_SCOPE("Webcam::convertYuv", uint64_t(rawFrame.w) * uint64_t(rawFrame.h));
+            convertYuvToRgba(rawFrame, *frameImage);
+            downscaleYuvForInference(rawFrame, *downscaledImage);
+            lastConversionTimeMs = (Timer->getTicksMicroseconds() - startTime) / 1000.0f;
+            return true;
+        }
+        // The next frame is delivered as BGR again
+        return false;
     }
 
+    // (Re-)allocate the frame buffer if the capture resolution changed
+    frameImage->allocate(frame.cols, frame.rows);
+    downscaledImage->allocate(256, 256);
+
+    uint64_t numPixels = uint64_t(frame.cols) * uint64_t(frame.rows);
     cv::Mat rgbaMat(frame.size(), CV_8UC4, frameImage->pixels);
+    {
+        PERF_SCOPE("Webcam::cvtColor", numPixels);
 #if (CV_VERSION_MAJOR <= 2)
-    cv::cvtColor(frame, rgbaMat, CV_BGR2RGBA, 4);
+        cv::cvtColor(frame, rgbaMat, CV_BGR2RGBA, 4);
 #else
-    cv::cvtColor(frame, rgbaMat, cv::COLOR_BGR2RGBA, 4);
+        cv::cvtColor(frame, rgbaMat, cv::COLOR_BGR2RGBA, 4);
 #endif
+    }
 
     // Downscale
     cv::Mat downscaledMat(256, 256, CV_8UC4, downscaledImage->pixels);
-    cv::resize(rgbaMat, downscaledMat, cv::Size(256, 256), 0, 0, cv::INTER_AREA); // INTER_LINEAR INTER_CUBIC INTER_AREA
+    {
+        PERF_SCOPE("Webcam::resize", numPixels);
+        cv::resize(rgbaMat, downscaledMat, cv::Size(256, 256), 0, 0, cv::INTER_AREA); // INTER_LINEAR INTER_CUBIC INTER_AREA
+    }
 
+    lastConversionTimeMs = (Timer->getTicksMicroseconds() - startTime) / 1000.0f;
     return true;
 }
 
 glm::ivec2 Webcam::getResolution() {
+    return resolution;
+}
+
+glm::ivec2 Webcam::setResolution(const glm::ivec2& resolution) {
 #if (CV_VERSION_MAJOR <= 2)
-    int cameraWidth = stream->get(CV_CAP_PROP_FRAME_WIDTH);
-    int cameraHeight = stream->get(CV_CAP_PROP_FRAME_HEIGHT);
+    stream->set(CV_CAP_PROP_FRAME_WIDTH, resolution.x);
+    stream->set(CV_CAP_PROP_FRAME_HEIGHT, resolution.y);
 #else
-    int cameraWidth = stream->get(cv::CAP_PROP_FRAME_WIDTH);
-    int cameraHeight = stream->get(cv::CAP_PROP_FRAME_HEIGHT);
+    stream->set(cv::CAP_PROP_FRAME_WIDTH, resolution.x);
+    stream->set(cv::CAP_PROP_FRAME_HEIGHT, resolution.y);
 #endif
-    return glm::ivec2(cameraWidth, cameraHeight);
+    updateCachedResolution();
+    return getResolution();
 }
@@ -35,26 +35,46 @@
 
 #include <boost/shared_ptr.hpp>
 #include <glm/glm.hpp>
-#include "FrameData.hpp"
+#include "FrameSource.hpp"
 
 namespace cv {
 class VideoCapture;
+class Mat;
 }
 
-class Webcam
+class Webcam : public FrameSource
 {
 public:
     Webcam();
-    ~Webcam();
-    //! \param id is the number of the camera
-    bool open(int id = 0);
+    virtual ~Webcam();
+    /*!
+     * \param id is the number of the camera
+     * \param nativeYuv: Requests YUYV frames without the conversion to BGR by OpenCV. Disabled again when
+     * the capture backend doesn't deliver raw YUYV/NV12 frames.
+     */
+    bool open(int id = 0, bool nativeYuv = false);
     //! \return Returns false if no frame is available
-    bool readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage);
+    virtual bool readFrame(FrameDataPtr frameImage, FrameDataPtr downscaledImage);
+    virtual bool supportsYuv() { return nativeYuv; }
+    virtual bool readYuvFrame(YuvFramePtr yuvFrame, FrameDataPtr downscaledImage);
     //! \return The resolution of the camera.
-    glm::ivec2 getResolution();
+    virtual glm::ivec2 getResolution();
+    //! Requests a new capture resolution. \return The resolution the camera actually uses.
+    virtual glm::ivec2 setResolution(const glm::ivec2& resolution);
+    //! \return Time spent converting and downscaling the last frame (excluding waiting for the camera)
+    virtual float getLastConversionTimeMs() { return lastConversionTimeMs; }
 
 private:
+    //! Copies a raw frame to yuvFrame. \return false if the frame isn't YUYV or NV12 (native mode is disabled).
+    bool copyRawFrame(const cv::Mat& frame, YuvFrame& yuvFrame);
+    void updateCachedResolution();
+
     cv::VideoCapture *stream;
+    float lastConversionTimeMs;
+    bool nativeYuv;
+    glm::ivec2 resolution;
+    YuvFrame rawFrame; ///< Used by readFrame in native YUV mode
+
 };
 
 #endif /* WEBCAM_HPP_ */
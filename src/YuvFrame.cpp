@@ -0,0 +1,147 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/opencv.hpp>
+#include "ImageUtils.hpp"
+#include "YuvFrame.hpp"
+
+void YuvFrame::allocate(FrameFormat format, int w, int h) {
+    this->format = format;
+    this->w = w;
+    this->h = h;
+    data.resize(getFrameSize(format, w, h));
+}
+
+size_t YuvFrame::getFrameSize(FrameFormat format, int w, int h) {
+    size_t numPixels = size_t(w) * size_t(h);
+    if (format == FRAME_FORMAT_YUYV) {
+        return numPixels * 2;
+    } else if (format == FRAME_FORMAT_NV12) {
+        return numPixels + numPixels / 2;
+    }
+    return 0;
+}
+
+void convertYuvToRgba(const YuvFrame& input, FrameData& output) {
+    output.allocate(input.w, input.h);
+    cv::Mat rgbaMat(input.h, input.w, CV_8UC4, output.pixels);
+    uint8_t *yuvData = const_cast<uint8_t*>(&input.data.front());
+    if (input.format == FRAME_FORMAT_YUYV) {
+        cv::Mat yuyvMat(input.h, input.w, CV_8UC2, yuvData);
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(yuyvMat, rgbaMat, CV_YUV2RGBA_YUYV, 4);
+#else
+        cv::cvtColor(yuyvMat, rgbaMat, cv::COLOR_YUV2RGBA_YUYV, 4);
+#endif
+    } else {
+        cv::Mat nv12Mat(input.h + input.h / 2, input.w, CV_8UC1, yuvData);
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(nv12Mat, rgbaMat, CV_YUV2RGBA_NV12, 4);
+#else
+        cv::cvtColor(nv12Mat, rgbaMat, cv::COLOR_YUV2RGBA_NV12, 4);
+#endif
+    }
+}
+
+static inline uint8_t toByte(float value) {
+    return uint8_t(glm::clamp(value, 0.0f, 255.0f) + 0.5f);
+}
+
+void convertRgbaToYuv(const FrameData& input, FrameFormat format, YuvFrame& output) {
+    output.allocate(format, input.w, input.h);
+    uint8_t *yuvData = &output.data.front();
+    // One chroma sample for each block of 2x1 (YUYV) or 2x2 (NV12) pixels
+    int blockHeight = format == FRAME_FORMAT_NV12 ? 2 : 1;
+    for (int y = 0; y < input.h; y += blockHeight) {
+        for (int x = 0; x < input.w; x += 2) {
+            glm::vec3 rgbSum(0.0f);
+            for (int by = 0; by < blockHeight; by++) {
+                for (int bx = 0; bx < 2; bx++) {
+                    size_t pixelIndex = size_t(y + by) * size_t(input.w) + size_t(x + bx);
+                    const uint8_t *pixel = input.pixels + pixelIndex * 4;
+                    glm::vec3 rgb(pixel[0] / 255.0f, pixel[1] / 255.0f, pixel[2] / 255.0f);
+                    rgbSum += rgb;
+                    uint8_t luma = toByte(16.0f + 65.481f * rgb.r + 128.553f * rgb.g + 24.966f * rgb.b);
+                    yuvData[format == FRAME_FORMAT_YUYV ? pixelIndex * 2 : pixelIndex] = luma;
+                }
+            }
+            glm::vec3 rgb = rgbSum / float(2 * blockHeight);
+            uint8_t *chroma = format == FRAME_FORMAT_YUYV
+                    ? yuvData + (size_t(y) * size_t(input.w) + size_t(x)) * 2 + 1
+                    : yuvData + size_t(input.w) * size_t(input.h) + size_t(y / 2) * size_t(input.w) + size_t(x);
+            int vOffset = format == FRAME_FORMAT_YUYV ? 2 : 1;
+            chroma[0] = toByte(128.0f - 37.797f * rgb.r - 74.203f * rgb.g + 112.0f * rgb.b);
+            chroma[vOffset] = toByte(128.0f + 112.0f * rgb.r - 93.786f * rgb.g - 18.214f * rgb.b);
+        }
+    }
+}
+
+void downscaleYuvForInference(const YuvFrame& input, FrameData& lowresImage) {
+    lowresImage.allocate(NETWORK_INPUT_SIZE, NETWORK_INPUT_SIZE);
+    const cv::Size networkSize(NETWORK_INPUT_SIZE, NETWORK_INPUT_SIZE);
+    uint8_t *yuvData = const_cast<uint8_t*>(&input.data.front());
+    size_t numPixels = size_t(NETWORK_INPUT_SIZE) * size_t(NETWORK_INPUT_SIZE);
+
+    if (input.format == FRAME_FORMAT_YUYV) {
+        // Every Y0 U Y1 V quadruple is one pixel of a half width RGBA image, so one resize averages all channels
+        cv::Mat packedMat(input.h, input.w / 2, CV_8UC4, yuvData), downscaledMat;
+        cv::resize(packedMat, downscaledMat, networkSize, 0, 0, cv::INTER_AREA);
+        const uint8_t *packed = downscaledMat.data;
+        for (size_t i = 0; i < numPixels; i++) {
+            const uint8_t *quadruple = packed + i * 4;
+            glm::vec3 rgb = yuvToRgb(
+                    (quadruple[0] + quadruple[2]) / 510.0f, quadruple[1] / 255.0f, quadruple[3] / 255.0f);
+            uint8_t *pixel = lowresImage.pixels + i * 4;
+            pixel[0] = toByte(rgb.r * 255.0f);
+            pixel[1] = toByte(rgb.g * 255.0f);
+            pixel[2] = toByte(rgb.b * 255.0f);
+            pixel[3] = 255;
+        }
+        return;
+    }
+
+    cv::Mat lumaMat(input.h, input.w, CV_8UC1, yuvData), downscaledLuma;
+    cv::Mat chromaMat(input.h / 2, input.w / 2, CV_8UC2, yuvData + size_t(input.w) * size_t(input.h));
+    cv::Mat downscaledChroma;
+    cv::resize(lumaMat, downscaledLuma, networkSize, 0, 0, cv::INTER_AREA);
+    cv::resize(chromaMat, downscaledChroma, networkSize, 0, 0, cv::INTER_AREA);
+    for (size_t i = 0; i < numPixels; i++) {
+        const uint8_t *chroma = downscaledChroma.data + i * 2;
+        glm::vec3 rgb = yuvToRgb(downscaledLuma.data[i] / 255.0f, chroma[0] / 255.0f, chroma[1] / 255.0f);
+        uint8_t *pixel = lowresImage.pixels + i * 4;
+        pixel[0] = toByte(rgb.r * 255.0f);
+        pixel[1] = toByte(rgb.g * 255.0f);
+        pixel[2] = toByte(rgb.b * 255.0f);
+        pixel[3] = 255;
+    }
+}
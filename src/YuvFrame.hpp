@@ -0,0 +1,98 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef YUVFRAME_HPP_
+#define YUVFRAME_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <boost/shared_ptr.hpp>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+
+/**
+ * Converts a YUV color to RGB (all components normalized to [0, 1]).
+ * Uses BT.601 with limited range (Y in [16, 235], U and V in [16, 240]) like most webcams and OpenCV.
+ * Keep in sync with yuvToRgb in ApplyCoefficients.glsl and Blit.glsl.
+ */
+inline glm::vec3 yuvToRgb(float y, float u, float v) {
+    y = 1.164f * (y - 16.0f / 255.0f);
+    u -= 128.0f / 255.0f;
+    v -= 128.0f / 255.0f;
+    return glm::clamp(
+            glm::vec3(y + 1.596f * v, y - 0.392f * u - 0.813f * v, y + 2.017f * u),
+            glm::vec3(0.0f), glm::vec3(1.0f));
+}
+
+/**
+ * Camera frame in its native YUV layout (width and height need to be even):
+ * - FRAME_FORMAT_YUYV: Packed 4:2:2, Y0 U Y1 V for every two pixels (2 bytes per pixel).
+ * - FRAME_FORMAT_NV12: 4:2:0 with the luma plane followed by a plane of interleaved U V samples for every
+ *   2x2 pixels (1.5 bytes per pixel).
+ */
+struct YuvFrame {
+    YuvFrame() : format(FRAME_FORMAT_YUYV), w(0), h(0) {}
+    void allocate(FrameFormat format, int w, int h);
+    //! \return The size of a frame in bytes (0 for formats that aren't YUV)
+    static size_t getFrameSize(FrameFormat format, int w, int h);
+
+    const uint8_t *getLumaPlane() const { return &data.front(); }
+    //! Only for NV12 (YUYV has no separate planes)
+    const uint8_t *getChromaPlane() const { return &data.front() + size_t(w) * size_t(h); }
+    //! \return The normalized RGB color of a pixel (with the chroma of the nearest chroma sample)
+    inline glm::vec3 getColor(int x, int y) const {
+        if (format == FRAME_FORMAT_YUYV) {
+            const uint8_t *pair = &data.front() + (size_t(y) * size_t(w) + size_t(x & ~1)) * 2;
+            return yuvToRgb(pair[(x & 1) * 2] / 255.0f, pair[1] / 255.0f, pair[3] / 255.0f);
+        }
+        const uint8_t *chroma = getChromaPlane() + size_t(y / 2) * size_t(w) + size_t(x & ~1);
+        return yuvToRgb(data[size_t(y) * size_t(w) + size_t(x)] / 255.0f, chroma[0] / 255.0f, chroma[1] / 255.0f);
+    }
+
+    FrameFormat format;
+    int w, h;
+    std::vector<uint8_t> data;
+};
+
+typedef boost::shared_ptr<YuvFrame> YuvFramePtr;
+
+//! Converts the frame to a 32-bit RGBA image. Output is (re-)allocated.
+void convertYuvToRgba(const YuvFrame& input, FrameData& output);
+//! Converts a 32-bit RGBA image to YUYV or NV12 (e.g. for synthetic test frames; the size needs to be even).
+void convertRgbaToYuv(const FrameData& input, FrameFormat format, YuvFrame& output);
+/**
+ * Downscales the frame to the 256x256 RGBA input of the network. The planes are downscaled before the
+ * conversion to RGB, so only 1.5-2 bytes per pixel of the full resolution frame are read.
+ */
+void downscaleYuvForInference(const YuvFrame& input, FrameData& lowresImage);
+
+#endif /* YUVFRAME_HPP_ */
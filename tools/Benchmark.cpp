@@ -0,0 +1,575 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Benchmarks the single stages of the filter pipeline on synthetic images.
+ * Usage: hdrnetbenchmark [--json <file>] [--model <dir>] [--resolutions 640x480,1920x1080,...]
+ *                        [--iterations N] [--warmup N] [--threads N] [--software-gl] [--no-gl] [--perf-counters]
+ * Without --model, a small test model with the same signature as the pretrained models is generated.
+ * The results are printed as a table and, with --json, written as JSON for tracking them over time.
+ * With --perf-counters, hardware counters (see PerfCounters) are collected for every stage (main thread only)
+ * and for the instrumented functions called by the stages (all threads).
+ *
+ * With --video-scaling [--video-frames N] [--video-resolution WxH], the throughput of the offline video
+ * processing (see VideoProcessor) is measured on a synthetic video for 1, 2, 4, ... workers instead.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <GL/glew.h>
+#include <Graphics/Texture/TextureManager.hpp>
+#include "GridPredictor.hpp"
+#include "GridRenderer.hpp"
+#include "CpuSlicer.hpp"
+#include "IncrementalSlicer.hpp"
+#include "YuvFrame.hpp"
+#include "GuideParameters.hpp"
+#include "ImageUtils.hpp"
+#include "VideoProcessor.hpp"
+#include "PerfCounters.hpp"
+#include "BenchmarkCommon.hpp"
+
+struct BenchmarkSettings {
+    int numIterations;
+    int numWarmupIterations;
+    bool perfCounters;
+};
+
+struct BenchmarkResult {
+    std::string stage;
+    glm::ivec2 resolution;
+    int numThreads;
+    std::vector<double> timesMs;
+    //! Hardware counters of all measured iterations (numCalls = 0 if not collected)
+    PerfCounterValues counters;
+
+    double getPercentile(double percentile) const {
+        std::vector<double> sortedTimes = timesMs;
+        std::sort(sortedTimes.begin(), sortedTimes.end());
+        size_t index = std::min(size_t(percentile * double(sortedTimes.size())), sortedTimes.size() - 1);
+        return sortedTimes.at(index);
+    }
+    double getMin() const { return *std::min_element(timesMs.begin(), timesMs.end()); }
+    double getMean() const {
+        double sum = 0.0;
+        for (double time : timesMs) {
+            sum += time;
+        }
+        return sum / double(timesMs.size());
+    }
+};
+
+static BenchmarkResult runBenchmark(
+        const BenchmarkSettings& settings, const std::string& stage, const glm::ivec2& resolution, int numThreads,
+        const std::function<void()>& function) {
+    for (int i = 0; i < settings.numWarmupIterations; i++) {
+        function();
+    }
+
+    BenchmarkResult result;
+    result.stage = stage;
+    result.resolution = resolution;
+    result.numThreads = numThreads;
+    PerfCounterValues startCounters, endCounters;
+    bool countersValid = settings.perfCounters && PerfCounters::readThreadCounters(startCounters);
+    for (int i = 0; i < settings.numIterations; i++) {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        function();
+        result.timesMs.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - startTime).count());
+    }
+    if (countersValid && PerfCounters::readThreadCounters(endCounters)) {
+        result.counters = endCounters - startCounters;
+        result.counters.numPixels = uint64_t(resolution.x) * uint64_t(resolution.y) * settings.numIterations;
+        result.counters.numCalls = uint64_t(settings.numIterations);
+    }
+
+    std::cout << std::left << std::setw(22) << stage << std::setw(12) << resolutionToString(resolution)
+              << std::right << std::setw(4) << numThreads << std::fixed << std::setprecision(3)
+              << std::setw(12) << result.getPercentile(0.5) << std::setw(12) << result.getPercentile(0.9)
+              << std::setw(12) << result.getMin();
+    if (result.counters.numCalls > 0) {
+        std::cout << std::setprecision(2) << std::setw(8) << result.counters.getIpc()
+                  << std::setw(12) << result.counters.getBytesPerPixel();
+    }
+    std::cout << std::endl;
+    return result;
+}
+
+static void writeJson(
+        std::ostream& stream, const std::vector<BenchmarkResult>& results, const std::string& modelName,
+        const std::string& glRenderer, int numIterations) {
+    stream << std::fixed << std::setprecision(4);
+    stream << "{\n";
+    stream << "  \"version\": 1,\n";
+    stream << "  \"timestamp\": " << std::time(NULL) << ",\n";
+    stream << "  \"model\": \"" << escapeJson(modelName) << "\",\n";
+    stream << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    stream << "  \"gl_renderer\": \"" << escapeJson(glRenderer) << "\",\n";
+    stream << "  \"iterations\": " << numIterations << ",\n";
+    stream << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results.at(i);
+        double megapixels = double(result.resolution.x) * double(result.resolution.y) * 1e-6;
+        stream << "    {\"stage\": \"" << result.stage << "\", \"width\": " << result.resolution.x
+               << ", \"height\": " << result.resolution.y << ", \"threads\": " << result.numThreads
+               << ", \"median_ms\": " << result.getPercentile(0.5) << ", \"p90_ms\": " << result.getPercentile(0.9)
+               << ", \"min_ms\": " << result.getMin() << ", \"mean_ms\": " << result.getMean()
+               << ", \"megapixels_per_s\": " << megapixels / (result.getPercentile(0.5) * 1e-3);
+        if (result.counters.numCalls > 0) {
+            const PerfCounterValues& counters = result.counters;
+            stream << ", \"cycles\": " << counters.cycles / counters.numCalls
+                   << ", \"instructions\": " << counters.instructions / counters.numCalls
+                   << ", \"cache_misses\": " << counters.cacheMisses / counters.numCalls
+                   << ", \"branch_misses\": " << counters.branchMisses / counters.numCalls
+                   << ", \"ipc\": " << counters.getIpc() << ", \"bytes_per_pixel\": " << counters.getBytesPerPixel();
+        }
+        stream << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    stream << "  ]\n";
+    stream << "}\n";
+}
+
+/**
+ * Frame frameIndex of a mostly static test sequence: image with a 64x64 square moving over it.
+ * Only the squares of the last and the current frame are written, as the sequence is played in order.
+ */
+static void drawMovingSquare(const FrameData& image, int frameIndex, FrameData& frame) {
+    const int squareSize = 64;
+    if (frame.w != image.w || frame.h != image.h) {
+        frame.allocate(image.w, image.h);
+        memcpy(frame.pixels, image.pixels, size_t(image.w) * size_t(image.h) * 4);
+    }
+    for (int index = std::max(frameIndex - 1, 0); index <= frameIndex; index++) {
+        int x0 = (index * 16) % std::max(image.w - squareSize, 1);
+        int y0 = (index * 9) % std::max(image.h - squareSize, 1);
+        size_t rowBytes = size_t(std::min(squareSize, image.w - x0)) * 4;
+        for (int y = y0; y < std::min(y0 + squareSize, image.h); y++) {
+            size_t offset = (size_t(y) * size_t(image.w) + size_t(x0)) * 4;
+            if (index < frameIndex) {
+                memcpy(frame.pixels + offset, image.pixels + offset, rowBytes);
+            } else {
+                memset(frame.pixels + offset, (index * 37) & 0xFF, rowBytes);
+            }
+        }
+    }
+}
+
+/**
+ * Simulates sensor noise: Adds uniform noise in [-amplitude, amplitude] (standard deviation amplitude / sqrt(3))
+ * to the RGB channels of frame. Every frame gets different noise, as the state is advanced across calls.
+ */
+static void addSensorNoise(const FrameData& frame, int amplitude, uint32_t& state, FrameData& noisyFrame) {
+    noisyFrame.allocate(frame.w, frame.h);
+    size_t numValues = size_t(frame.w) * size_t(frame.h) * 4;
+    for (size_t i = 0; i < numValues; i++) {
+        if (i % 4 == 3) {
+            noisyFrame.pixels[i] = frame.pixels[i];
+            continue;
+        }
+        // xorshift32 as in createSyntheticImage
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        int noise = int(state % uint32_t(2 * amplitude + 1)) - amplitude;
+        noisyFrame.pixels[i] = uint8_t(std::min(std::max(int(frame.pixels[i]) + noise, 0), 255));
+    }
+}
+
+struct IncrementalSlicingResult {
+    glm::ivec2 resolution;
+    double changedTileRatio, noisyChangedTileRatio;
+    double fullSlicingMs, incrementalSlicingMs, noisyIncrementalSlicingMs;
+};
+
+//! Writes a synthetic video with moving content (MJPG, so that decoding is cheap and seeking is exact)
+static bool createSyntheticVideo(const std::string& filename, const glm::ivec2& resolution, int numFrames) {
+#if (CV_VERSION_MAJOR <= 2)
+    int fourcc = CV_FOURCC('M', 'J', 'P', 'G');
+#else
+    int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+#endif
+    cv::VideoWriter writer(filename, fourcc, 30.0, cv::Size(resolution.x, resolution.y), true);
+    if (!writer.isOpened()) {
+        std::cerr << "Couldn't create the test video " << filename << std::endl;
+        return false;
+    }
+    // A larger pattern is scrolled through the frame
+    FrameData pattern;
+    createSyntheticImage(resolution.x * 2, resolution.y, 1, pattern);
+    cv::Mat patternMat(pattern.h, pattern.w, CV_8UC4, pattern.pixels), frame;
+    for (int i = 0; i < numFrames; i++) {
+        int offset = (i * 8) % resolution.x;
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(patternMat(cv::Rect(offset, 0, resolution.x, resolution.y)), frame, CV_RGBA2BGR, 3);
+#else
+        cv::cvtColor(patternMat(cv::Rect(offset, 0, resolution.x, resolution.y)), frame, cv::COLOR_RGBA2BGR, 3);
+#endif
+        writer.write(frame);
+    }
+    return true;
+}
+
+static int runVideoScalingBenchmark(int argc, char *argv[], const std::string& modelPath) {
+    int numFrames = std::max(std::atoi(getOption(argc, argv, "--video-frames", "600").c_str()), 1);
+    std::vector<glm::ivec2> resolutions = parseResolutions(getOption(argc, argv, "--video-resolution", "1280x720"));
+    glm::ivec2 resolution = resolutions.empty() ? glm::ivec2(1280, 720) : resolutions.front();
+    int maxWorkers = std::max(int(std::thread::hardware_concurrency()), 1);
+
+    std::string videoFilename = getDefaultTestModelDirectory() + "test_video.avi";
+    std::string outputFilename = getDefaultTestModelDirectory() + "test_video_output.avi";
+    if (!createSyntheticVideo(videoFilename, resolution, numFrames)) {
+        return 1;
+    }
+
+    std::vector<int> workerCounts;
+    for (int numWorkers = 1; numWorkers < maxWorkers; numWorkers *= 2) {
+        workerCounts.push_back(numWorkers);
+    }
+    workerCounts.push_back(maxWorkers);
+
+    std::cout << std::setw(8) << "workers" << std::setw(12) << "frames/s" << std::setw(10) << "speedup"
+              << std::setw(12) << "efficiency" << std::endl;
+    std::vector<BenchmarkResult> results;
+    double singleWorkerThroughput = 0.0;
+    for (int numWorkers : workerCounts) {
+        VideoProcessingSettings settings;
+        settings.modelPath = modelPath;
+        settings.inputFilename = videoFilename;
+        settings.outputFilename = outputFilename;
+        settings.numWorkers = numWorkers;
+        settings.threadsPerWorker = 1;
+        settings.reportIntervalS = 0;
+        VideoProcessor videoProcessor(settings);
+        if (!videoProcessor.run()) {
+            return 1;
+        }
+
+        const VideoProcessingStatistics& statistics = videoProcessor.getStatistics();
+        double throughput = statistics.getFramesPerSecond();
+        if (numWorkers == 1) {
+            singleWorkerThroughput = throughput;
+        }
+        double speedup = singleWorkerThroughput > 0.0 ? throughput / singleWorkerThroughput : 0.0;
+        std::cout << std::setw(8) << numWorkers << std::fixed << std::setprecision(2) << std::setw(12) << throughput
+                  << std::setw(10) << speedup << std::setw(11) << speedup / numWorkers * 100.0 << "%" << std::endl;
+
+        BenchmarkResult result;
+        result.stage = "video_processing";
+        result.resolution = resolution;
+        result.numThreads = numWorkers;
+        result.timesMs.push_back(statistics.elapsedS * 1000.0 / std::max(statistics.numFrames, 1));
+        results.push_back(result);
+    }
+
+    std::string jsonFilename = getOption(argc, argv, "--json");
+    if (!jsonFilename.empty()) {
+        std::ofstream jsonFile(jsonFilename.c_str());
+        writeJson(jsonFile, results, getOption(argc, argv, "--model", "test_model"), "none", 1);
+    }
+    boost::system::error_code errorCode;
+    boost::filesystem::remove(videoFilename, errorCode);
+    boost::filesystem::remove(outputFilename, errorCode);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkSettings settings;
+    settings.numIterations = std::max(std::atoi(getOption(argc, argv, "--iterations", "50").c_str()), 1);
+    settings.numWarmupIterations = std::max(std::atoi(getOption(argc, argv, "--warmup", "5").c_str()), 0);
+    settings.perfCounters = hasOption(argc, argv, "--perf-counters");
+    std::vector<glm::ivec2> resolutions = parseResolutions(
+            getOption(argc, argv, "--resolutions", "640x480,1280x720,1920x1080,3840x2160"));
+    int numThreads = std::atoi(getOption(argc, argv, "--threads", "0").c_str());
+    if (numThreads <= 0) {
+        numThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+    }
+    bool useOpenGL = !hasOption(argc, argv, "--no-gl");
+    std::string jsonFilename = getOption(argc, argv, "--json");
+
+    initializeApplication(argc, argv);
+    std::string modelPath = getOption(argc, argv, "--model");
+    if (modelPath.empty()) {
+        modelPath = getDefaultTestModelDirectory();
+        if (!createTestModel(modelPath)) {
+            return 1;
+        }
+    } else if (modelPath.back() != '/') {
+        modelPath += "/";
+    }
+
+    if (hasOption(argc, argv, "--video-scaling")) {
+        return runVideoScalingBenchmark(argc, argv, modelPath);
+    }
+
+    GridPredictor gridPredictor;
+    GuideParameters guide;
+    if (!gridPredictor.loadGraph(modelPath) || !guide.load(modelPath)) {
+        return 1;
+    }
+
+    std::string glRenderer = "none";
+    if (useOpenGL) {
+        createOpenGLContext(hasOption(argc, argv, "--software-gl"));
+        glRenderer = (const char*)glGetString(GL_RENDERER);
+    }
+
+    if (settings.perfCounters && !PerfCounters::get()->start()) {
+        std::cerr << "Hardware counters unavailable: " << PerfCounters::get()->getLastError() << std::endl;
+        settings.perfCounters = false;
+    }
+
+    std::cout << std::left << std::setw(22) << "stage" << std::setw(12) << "resolution"
+              << std::right << std::setw(4) << "thr" << std::setw(12) << "median ms" << std::setw(12) << "p90 ms"
+              << std::setw(12) << "min ms";
+    if (settings.perfCounters) {
+        std::cout << std::setw(8) << "IPC" << std::setw(12) << "bytes/px";
+    }
+    std::cout << std::endl;
+    std::vector<BenchmarkResult> results;
+    const glm::ivec2 lowresResolution(NETWORK_INPUT_SIZE, NETWORK_INPUT_SIZE);
+
+    // Stages working on the 256x256 network input
+    FrameDataPtr lowresImage(new FrameData);
+    createSyntheticImage(NETWORK_INPUT_SIZE, NETWORK_INPUT_SIZE, 1, *lowresImage);
+    std::vector<float> inputTensorData(NETWORK_INPUT_SIZE * NETWORK_INPUT_SIZE * 3);
+    results.push_back(runBenchmark(settings, "tensor_fill", lowresResolution, 1, [&]() {
+        GridPredictor::fillInputTensor(&inputTensorData.front(), *lowresImage);
+    }));
+    results.push_back(runBenchmark(settings, "inference", lowresResolution, 1, [&]() {
+        gridPredictor.computeGridCoefficients(*lowresImage);
+    }));
+    const int batchSize = 4;
+    std::vector<FrameDataPtr> lowresImages(batchSize, lowresImage);
+    std::vector<GridCoefficientsPtr> grids;
+    results.push_back(runBenchmark(settings, "inference_batch4", lowresResolution, 1, [&]() {
+        gridPredictor.computeGridCoefficientsBatch(lowresImages, grids);
+    }));
+    GridCoefficients grid = *gridPredictor.computeGridCoefficients(*lowresImage);
+
+    GridRenderer *gridRenderer = NULL;
+    if (useOpenGL) {
+        gridRenderer = new GridRenderer;
+        gridRenderer->initialize(modelPath);
+        results.push_back(runBenchmark(settings, "grid_upload", lowresResolution, 1, [&]() {
+            gridRenderer->uploadGrid(grid);
+            glFinish();
+        }));
+    }
+
+    // Stages working on the full resolution camera image
+    CpuSlicer cpuSlicer;
+    cpuSlicer.setGuideParameters(guide);
+    std::vector<IncrementalSlicingResult> incrementalResults;
+    for (const glm::ivec2& resolution : resolutions) {
+        FrameData image, downscaledImage, slicedImage;
+        createSyntheticImage(resolution.x, resolution.y, 1, image);
+
+        cv::Mat rgbaMat(resolution.y, resolution.x, CV_8UC4, image.pixels), bgrMat, convertedMat;
+#if (CV_VERSION_MAJOR <= 2)
+        cv::cvtColor(rgbaMat, bgrMat, CV_RGBA2BGR, 3);
+#else
+        cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR, 3);
+#endif
+        results.push_back(runBenchmark(settings, "bgr_to_rgba", resolution, 1, [&]() {
+#if (CV_VERSION_MAJOR <= 2)
+            cv::cvtColor(bgrMat, convertedMat, CV_BGR2RGBA, 4);
+#else
+            cv::cvtColor(bgrMat, convertedMat, cv::COLOR_BGR2RGBA, 4);
+#endif
+        }));
+        results.push_back(runBenchmark(settings, "area_downscale", resolution, 1, [&]() {
+            downscaleForInference(image, downscaledImage);
+        }));
+
+        cpuSlicer.setNumThreads(1);
+        results.push_back(runBenchmark(settings, "cpu_slicing", resolution, 1, [&]() {
+            cpuSlicer.slice(image, grid, slicedImage);
+        }));
+        if (numThreads > 1) {
+            cpuSlicer.setNumThreads(numThreads);
+            results.push_back(runBenchmark(settings, "cpu_slicing", resolution, numThreads, [&]() {
+                cpuSlicer.slice(image, grid, slicedImage);
+            }));
+        }
+        double fullSlicingMs = results.back().getPercentile(0.5);
+
+        // Native camera formats (see YuvFrame): conversion to RGBA vs. downscaling the planes directly
+        YuvFrame yuyvFrame, nv12Frame;
+        convertRgbaToYuv(image, FRAME_FORMAT_YUYV, yuyvFrame);
+        convertRgbaToYuv(image, FRAME_FORMAT_NV12, nv12Frame);
+        FrameData convertedImage;
+        results.push_back(runBenchmark(settings, "yuyv_to_rgba", resolution, 1, [&]() {
+            convertYuvToRgba(yuyvFrame, convertedImage);
+        }));
+        results.push_back(runBenchmark(settings, "yuyv_downscale", resolution, 1, [&]() {
+            downscaleYuvForInference(yuyvFrame, downscaledImage);
+        }));
+        results.push_back(runBenchmark(settings, "nv12_to_rgba", resolution, 1, [&]() {
+            convertYuvToRgba(nv12Frame, convertedImage);
+        }));
+        results.push_back(runBenchmark(settings, "nv12_downscale", resolution, 1, [&]() {
+            downscaleYuvForInference(nv12Frame, downscaledImage);
+        }));
+        cpuSlicer.setNumThreads(numThreads);
+        results.push_back(runBenchmark(settings, "cpu_slicing_yuyv", resolution, numThreads, [&]() {
+            cpuSlicer.sliceYuv(yuyvFrame, grid, slicedImage);
+        }));
+
+        // Mostly static sequence: the grid stays the same and only a small square moves (see drawMovingSquare)
+        IncrementalSlicingResult incrementalResult;
+        incrementalResult.resolution = resolution;
+        incrementalResult.fullSlicingMs = fullSlicingMs;
+        FrameData sequenceFrame;
+        IncrementalSlicer incrementalSlicer(cpuSlicer);
+        int sequenceFrameIndex = 0;
+        results.push_back(runBenchmark(settings, "cpu_slicing_tiles", resolution, numThreads, [&]() {
+            drawMovingSquare(image, sequenceFrameIndex++, sequenceFrame);
+            incrementalSlicer.slice(sequenceFrame, grid);
+        }));
+        incrementalResult.incrementalSlicingMs = results.back().getPercentile(0.5);
+        incrementalResult.changedTileRatio = incrementalSlicer.getTileChangeDetector().getChangedTileRatio();
+
+        // The same sequence with sensor noise (standard deviation of about 3.5 8-bit steps). The noise is added
+        // outside of the measured time, as it would come from the camera.
+        FrameData noisyFrame;
+        IncrementalSlicer noisyIncrementalSlicer(cpuSlicer);
+        uint32_t noiseState = 2891336453u;
+        BenchmarkResult noisyResult;
+        noisyResult.stage = "cpu_slicing_tiles_noise";
+        noisyResult.resolution = resolution;
+        noisyResult.numThreads = numThreads;
+        for (int i = 0; i < settings.numWarmupIterations + settings.numIterations; i++) {
+            drawMovingSquare(image, sequenceFrameIndex++, sequenceFrame);
+            addSensorNoise(sequenceFrame, 6, noiseState, noisyFrame);
+            auto startTime = std::chrono::steady_clock::now();
+            noisyIncrementalSlicer.slice(noisyFrame, grid);
+            if (i >= settings.numWarmupIterations) {
+                noisyResult.timesMs.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - startTime).count());
+            }
+        }
+        results.push_back(noisyResult);
+        incrementalResult.noisyIncrementalSlicingMs = results.back().getPercentile(0.5);
+        incrementalResult.noisyChangedTileRatio =
+                noisyIncrementalSlicer.getTileChangeDetector().getChangedTileRatio();
+        incrementalResults.push_back(incrementalResult);
+
+        if (gridRenderer) {
+            sgl::TexturePtr imageTexture = sgl::TextureManager->createEmptyTexture(resolution.x, resolution.y);
+            results.push_back(runBenchmark(settings, "texture_upload", resolution, 1, [&]() {
+                imageTexture->uploadPixelData(resolution.x, resolution.y, image.pixels);
+                glFinish();
+            }));
+            // Includes the read back, as glReadPixels waits for the slicing pass anyway
+            std::vector<uint8_t> outputPixels(size_t(resolution.x) * size_t(resolution.y) * 4);
+            results.push_back(runBenchmark(settings, "gl_slicing_readback", resolution, 1, [&]() {
+                gridRenderer->renderSlicedImageToMemory(imageTexture, &outputPixels.front());
+            }));
+
+            // YUYV frames are uploaded as RGBA textures of half the width (half the bytes of RGBA frames)
+            sgl::TexturePtr yuyvTexture = sgl::TextureManager->createEmptyTexture(resolution.x / 2, resolution.y);
+            results.push_back(runBenchmark(settings, "texture_upload_yuyv", resolution, 1, [&]() {
+                yuyvTexture->uploadPixelData(resolution.x / 2, resolution.y, &yuyvFrame.data.front());
+                glFinish();
+            }));
+            gridRenderer->setInputFormat(FRAME_FORMAT_YUYV);
+            results.push_back(runBenchmark(settings, "gl_slicing_yuyv", resolution, 1, [&]() {
+                gridRenderer->renderSlicedImageToMemory(yuyvTexture, &outputPixels.front());
+            }));
+            gridRenderer->setInputFormat(FRAME_FORMAT_RGBA8);
+
+            // Same sequence on the GPU: full slicing of every frame vs. slicing the changed tiles
+            results.push_back(runBenchmark(settings, "gl_slicing_frame", resolution, 1, [&]() {
+                drawMovingSquare(image, sequenceFrameIndex++, sequenceFrame);
+                imageTexture->uploadPixelData(resolution.x, resolution.y, sequenceFrame.pixels);
+                gridRenderer->renderSlicedImage(imageTexture);
+                glFinish();
+            }));
+            results.push_back(runBenchmark(settings, "gl_slicing_tiles", resolution, 1, [&]() {
+                drawMovingSquare(image, sequenceFrameIndex++, sequenceFrame);
+                imageTexture->uploadPixelData(resolution.x, resolution.y, sequenceFrame.pixels);
+                gridRenderer->detectChangedTiles(sequenceFrame);
+                gridRenderer->renderSlicedImageIncremental(imageTexture);
+                glFinish();
+            }));
+        }
+    }
+
+    std::cout << std::endl << "Incremental CPU slicing of a mostly static sequence (64x64 square moving):"
+              << std::endl;
+    for (const IncrementalSlicingResult& result : incrementalResults) {
+        std::cout << "  " << std::left << std::setw(12) << resolutionToString(result.resolution) << std::right
+                  << std::fixed << std::setprecision(1) << result.changedTileRatio * 100.0 << "% of the tiles sliced, "
+                  << std::setprecision(3) << result.incrementalSlicingMs << " ms instead of " << result.fullSlicingMs
+                  << " ms (" << std::setprecision(1)
+                  << result.fullSlicingMs / std::max(result.incrementalSlicingMs, 1e-6) << "x)" << std::endl;
+        std::cout << "  " << std::left << std::setw(12) << "with noise" << std::right << std::fixed
+                  << std::setprecision(1) << result.noisyChangedTileRatio * 100.0 << "% of the tiles sliced, "
+                  << std::setprecision(3)
+                  << result.noisyIncrementalSlicingMs << " ms (" << std::setprecision(1)
+                  << result.fullSlicingMs / std::max(result.noisyIncrementalSlicingMs, 1e-6) << "x)" << std::endl;
+    }
+
+    if (settings.perfCounters) {
+        std::cout << std::endl << "Hardware counters of the instrumented functions:" << std::endl
+                  << PerfCounters::get()->getSummary();
+        PerfCounters::get()->stop();
+    }
+
+    if (!jsonFilename.empty()) {
+        std::ofstream jsonFile(jsonFilename.c_str());
+        writeJson(jsonFile, results, getOption(argc, argv, "--model", "test_model"), glRenderer,
+                  settings.numIterations);
+    }
+
+    delete gridRenderer;
+    if (useOpenGL) {
+        releaseApplication();
+    }
+    return 0;
+}
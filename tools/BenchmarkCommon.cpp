@@ -0,0 +1,301 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <tensorflow/core/framework/graph.pb.h>
+#include <tensorflow/core/framework/node_def.pb.h>
+#include <tensorflow/core/framework/attr_value.pb.h>
+#include <tensorflow/core/framework/tensor.h>
+#include <tensorflow/core/platform/env.h>
+#include <Utils/File/Logfile.hpp>
+#include <Utils/File/FileUtils.hpp>
+#include <Utils/AppSettings.hpp>
+#include "GuideParameters.hpp"
+#include "BenchmarkCommon.hpp"
+
+namespace tf = tensorflow;
+using namespace sgl;
+
+std::vector<glm::ivec2> parseResolutions(const std::string& resolutionList) {
+    std::vector<glm::ivec2> resolutions;
+    size_t start = 0;
+    while (start < resolutionList.size()) {
+        size_t end = resolutionList.find(',', start);
+        if (end == std::string::npos) {
+            end = resolutionList.size();
+        }
+        std::string resolutionString = resolutionList.substr(start, end - start);
+        size_t separatorPos = resolutionString.find('x');
+        if (separatorPos != std::string::npos) {
+            glm::ivec2 resolution(
+                    std::atoi(resolutionString.substr(0, separatorPos).c_str()),
+                    std::atoi(resolutionString.substr(separatorPos + 1).c_str()));
+            if (resolution.x > 0 && resolution.y > 0) {
+                resolutions.push_back(resolution);
+            }
+        }
+        start = end + 1;
+    }
+    return resolutions;
+}
+
+std::string resolutionToString(const glm::ivec2& resolution) {
+    return std::to_string(resolution.x) + "x" + std::to_string(resolution.y);
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escapedText;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escapedText += '\\';
+        }
+        escapedText += c;
+    }
+    return escapedText;
+}
+
+
+// --- Test model ---
+
+// Grid size of the test model (same as the pretrained models)
+const int TEST_GRID_WIDTH = 16;
+const int TEST_GRID_HEIGHT = 16;
+const int TEST_GRID_DEPTH = 8;
+const int INPUT_SIZE = 256;
+
+static tf::NodeDef *addNode(
+        tf::GraphDef& graphDef, const std::string& name, const std::string& op,
+        const std::vector<std::string>& inputs) {
+    tf::NodeDef *node = graphDef.add_node();
+    node->set_name(name);
+    node->set_op(op);
+    for (const std::string& input : inputs) {
+        node->add_input(input);
+    }
+    return node;
+}
+
+static void setTypeAttribute(tf::NodeDef *node, const std::string& name, tf::DataType type) {
+    (*node->mutable_attr())[name].set_type(type);
+}
+
+static void setIntListAttribute(tf::NodeDef *node, const std::string& name, const std::vector<int>& values) {
+    tf::AttrValue_ListValue *list = (*node->mutable_attr())[name].mutable_list();
+    for (int value : values) {
+        list->add_i(value);
+    }
+}
+
+static void setStringAttribute(tf::NodeDef *node, const std::string& name, const std::string& value) {
+    (*node->mutable_attr())[name].set_s(value);
+}
+
+static void addConstNode(tf::GraphDef& graphDef, const std::string& name, const tf::Tensor& tensor) {
+    tf::NodeDef *node = addNode(graphDef, name, "Const", {});
+    setTypeAttribute(node, "dtype", tensor.dtype());
+    tensor.AsProtoTensorContent((*node->mutable_attr())["value"].mutable_tensor());
+}
+
+static tf::Tensor createShapeTensor(const std::vector<int>& values) {
+    tf::Tensor tensor(tf::DT_INT32, tf::TensorShape({int64_t(values.size())}));
+    for (size_t i = 0; i < values.size(); i++) {
+        tensor.flat<int>()(i) = values.at(i);
+    }
+    return tensor;
+}
+
+static bool writeFloatFile(const std::string& filename, const float *data, size_t numFloats) {
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        Logfile::get()->writeError(
+                std::string() + "ERROR in createTestModel: Couldn't write file \"" + filename + "\".");
+        return false;
+    }
+    file.write((const char*)data, numFloats * sizeof(float));
+    return file.good();
+}
+
+bool createTestModel(const std::string& directory) {
+    boost::system::error_code errorCode;
+    boost::filesystem::create_directories(directory, errorCode);
+
+    const int numChannels = TEST_GRID_DEPTH * 12;
+    const int blockSize = INPUT_SIZE / TEST_GRID_WIDTH;
+    tf::GraphDef graphDef;
+
+    // lowres_input [N, 256, 256, 3] -> block averages [N, 16, 16, 3]
+    tf::NodeDef *input = addNode(graphDef, "lowres_input", "Placeholder", {});
+    setTypeAttribute(input, "dtype", tf::DT_FLOAT);
+    tf::TensorShapeProto *inputShape = (*input->mutable_attr())["shape"].mutable_shape();
+    inputShape->add_dim()->set_size(-1);
+    inputShape->add_dim()->set_size(INPUT_SIZE);
+    inputShape->add_dim()->set_size(INPUT_SIZE);
+    inputShape->add_dim()->set_size(3);
+
+    tf::NodeDef *pooling = addNode(graphDef, "block_average", "AvgPool", {"lowres_input"});
+    setTypeAttribute(pooling, "T", tf::DT_FLOAT);
+    setIntListAttribute(pooling, "ksize", {1, blockSize, blockSize, 1});
+    setIntListAttribute(pooling, "strides", {1, blockSize, blockSize, 1});
+    setStringAttribute(pooling, "padding", "VALID");
+    setStringAttribute(pooling, "data_format", "NHWC");
+
+    // 1x1 convolution -> [N, 16, 16, 8*3*4]: The diagonal of the affine transform darkens bright blocks
+    tf::Tensor weights(tf::DT_FLOAT, tf::TensorShape({1, 1, 3, numChannels}));
+    tf::Tensor biases(tf::DT_FLOAT, tf::TensorShape({numChannels}));
+    for (int c = 0; c < numChannels; c++) {
+        int depth = c / 12, row = (c / 4) % 3, column = c % 4;
+        bool diagonal = row == column;
+        for (int inputChannel = 0; inputChannel < 3; inputChannel++) {
+            weights.flat<float>()(inputChannel*numChannels + c) = diagonal ? -0.15f : 0.0f;
+        }
+        float offset = 0.02f * (float(depth) / float(TEST_GRID_DEPTH - 1) - 0.5f);
+        biases.flat<float>()(c) = diagonal ? 1.2f : (column == 3 ? offset : 0.0f);
+    }
+    addConstNode(graphDef, "weights", weights);
+    addConstNode(graphDef, "biases", biases);
+    tf::NodeDef *convolution = addNode(graphDef, "convolution", "Conv2D", {"block_average", "weights"});
+    setTypeAttribute(convolution, "T", tf::DT_FLOAT);
+    setIntListAttribute(convolution, "strides", {1, 1, 1, 1});
+    setStringAttribute(convolution, "padding", "SAME");
+    setStringAttribute(convolution, "data_format", "NHWC");
+    tf::NodeDef *biasAdd = addNode(graphDef, "coefficients", "BiasAdd", {"convolution", "biases"});
+    setTypeAttribute(biasAdd, "T", tf::DT_FLOAT);
+
+    // Move the rows of the affine transform to the front, so that they form three consecutive RGBA grids
+    addConstNode(graphDef, "split_shape", createShapeTensor(
+            {-1, TEST_GRID_HEIGHT, TEST_GRID_WIDTH, TEST_GRID_DEPTH, 3, 4}));
+    addConstNode(graphDef, "row_permutation", createShapeTensor({0, 4, 1, 2, 3, 5}));
+    addConstNode(graphDef, "output_shape", createShapeTensor(
+            {-1, TEST_GRID_HEIGHT, TEST_GRID_WIDTH, TEST_GRID_DEPTH, 12}));
+    tf::NodeDef *split = addNode(graphDef, "split_rows", "Reshape", {"coefficients", "split_shape"});
+    setTypeAttribute(split, "T", tf::DT_FLOAT);
+    setTypeAttribute(split, "Tshape", tf::DT_INT32);
+    tf::NodeDef *transpose = addNode(graphDef, "rows_first", "Transpose", {"split_rows", "row_permutation"});
+    setTypeAttribute(transpose, "T", tf::DT_FLOAT);
+    setTypeAttribute(transpose, "Tperm", tf::DT_INT32);
+    tf::NodeDef *output = addNode(graphDef, "output_coefficients", "Reshape", {"rows_first", "output_shape"});
+    setTypeAttribute(output, "T", tf::DT_FLOAT);
+    setTypeAttribute(output, "Tshape", tf::DT_INT32);
+
+    tf::Status status = tf::WriteBinaryProto(tf::Env::Default(), directory + "frozen_graph.pb", graphDef);
+    if (!status.ok()) {
+        Logfile::get()->writeError(std::string() + "ERROR in createTestModel: " + status.ToString());
+        return false;
+    }
+
+    // Guide: Mean of the RGB channels
+    glm::mat3x4 ccm(1.0f);
+    glm::vec4 mixMatrix(1.0f / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f, 0.0f);
+    glm::vec3 shifts[NUM_GUIDE_SEGMENTS], slopes[NUM_GUIDE_SEGMENTS];
+    for (int i = 0; i < NUM_GUIDE_SEGMENTS; i++) {
+        shifts[i] = glm::vec3(float(i) / float(NUM_GUIDE_SEGMENTS));
+        slopes[i] = glm::vec3(i == 0 ? 1.0f : 0.0f);
+    }
+    bool success = true;
+    success = writeFloatFile(directory + "guide_ccm_f32_3x4.bin", &ccm[0][0], 12) && success;
+    success = writeFloatFile(directory + "guide_mix_matrix_f32_1x4.bin", &mixMatrix[0], 4) && success;
+    success = writeFloatFile(directory + "guide_shifts_f32_16x3.bin", &shifts[0][0], 16*3) && success;
+    success = writeFloatFile(directory + "guide_slopes_f32_16x3.bin", &slopes[0][0], 16*3) && success;
+    return success;
+}
+
+std::string getDefaultTestModelDirectory() {
+    return (boost::filesystem::temp_directory_path() / "hdrnet-test-model").string() + "/";
+}
+
+
+// --- Test images ---
+
+void createSyntheticImage(int width, int height, uint32_t seed, FrameData& image) {
+    image.allocate(width, height);
+    uint32_t state = seed * 747796405u + 2891336453u;
+    for (int y = 0; y < height; y++) {
+        float v = float(y) / float(std::max(height - 1, 1));
+        for (int x = 0; x < width; x++) {
+            float u = float(x) / float(std::max(width - 1, 1));
+            // xorshift32 for the noise
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            float noise = float(state & 0xFFu) / 255.0f - 0.5f;
+
+            glm::vec3 color;
+            if (v < 0.25f) {
+                // Color bars
+                int bar = int(u * 8.0f) % 8;
+                color = glm::vec3(bar & 1 ? 0.9f : 0.1f, bar & 2 ? 0.9f : 0.1f, bar & 4 ? 0.9f : 0.1f);
+            } else {
+                // Gradients with a low-frequency pattern (dark and bright regions for the guide)
+                float pattern = 0.5f + 0.5f * std::sin(u * 9.0f) * std::cos(v * 7.0f);
+                color = glm::vec3(u, v, 1.0f - u) * 0.6f + glm::vec3(pattern) * 0.4f;
+            }
+            color = glm::clamp(color + glm::vec3(noise * 0.06f), glm::vec3(0.0f), glm::vec3(1.0f));
+
+            uint8_t *pixel = image.pixels + 4*(x + y*width);
+            pixel[0] = uint8_t(color.r * 255.0f + 0.5f);
+            pixel[1] = uint8_t(color.g * 255.0f + 0.5f);
+            pixel[2] = uint8_t(color.b * 255.0f + 0.5f);
+            pixel[3] = 255;
+        }
+    }
+}
+
+
+// --- Application setup ---
+
+void initializeApplication(int argc, char *argv[]) {
+    FileUtils::get()->initialize("hdrnet-viewer", argc, argv);
+    std::string settingsFile = FileUtils::get()->getConfigDirectory() + "settings.txt";
+    AppSettings::get()->loadSettings(settingsFile.c_str());
+#ifdef DATA_PATH
+    if (!FileUtils::get()->directoryExists("Data") && !FileUtils::get()->directoryExists("../Data")) {
+        AppSettings::get()->setDataDirectory(DATA_PATH);
+    }
+#endif
+}
+
+void createOpenGLContext(bool softwareRendering) {
+    if (softwareRendering) {
+        // Mesa: Use llvmpipe instead of the hardware driver
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    }
+    AppSettings::get()->createWindow();
+    AppSettings::get()->initializeSubsystems();
+}
+
+void releaseApplication() {
+    AppSettings::get()->release();
+}
@@ -0,0 +1,79 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCHMARKCOMMON_HPP_
+#define BENCHMARKCOMMON_HPP_
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "FrameData.hpp"
+#include "CommandLine.hpp"
+
+/*
+ * Code shared by the benchmark (hdrnetbenchmark) and the golden image comparison (hdrnetregression).
+ */
+
+//! Parses a comma separated list of sizes of the form WxH (e.g. "640x480,1920x1080").
+std::vector<glm::ivec2> parseResolutions(const std::string& resolutionList);
+std::string resolutionToString(const glm::ivec2& resolution);
+//! Escapes quotes and backslashes for use in a JSON string.
+std::string escapeJson(const std::string& text);
+
+/**
+ * Writes a small graph with the same input and output signature as the hdrnet models (a 16x16x8 grid
+ * computed from the average colors of 16x16 pixel blocks), and guide parameters that map the input to
+ * its mean intensity. The graph has a dynamic batch dimension.
+ * It doesn't produce pleasing images, but exercises the whole pipeline without downloading the models.
+ * \param directory: Output directory (including a trailing slash); it's created if necessary.
+ */
+bool createTestModel(const std::string& directory);
+//! \return A directory for the test model in the temporary directory of the system.
+std::string getDefaultTestModelDirectory();
+
+/**
+ * Fills image with a deterministic 32-bit RGBA test pattern (gradients, color bars and noise).
+ * The same seed and resolution always produce the same image.
+ */
+void createSyntheticImage(int width, int height, uint32_t seed, FrameData& image);
+
+//! Sets up the settings and data directory like the viewer (needed for the shader files).
+void initializeApplication(int argc, char *argv[]);
+/**
+ * Creates the window and the OpenGL context.
+ * \param softwareRendering: Whether to force the Mesa software rasterizer (llvmpipe), which gives
+ * comparable results on machines without a GPU (e.g. build servers).
+ */
+void createOpenGLContext(bool softwareRendering);
+void releaseApplication();
+
+#endif /* BENCHMARKCOMMON_HPP_ */
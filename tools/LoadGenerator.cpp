@@ -0,0 +1,176 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Load generator for the enhancement server (hdrnetviewer --server <socket>).
+ * Usage: hdrnetloadgen <socket> [--concurrency N] [--requests N] [--width W] [--height H]
+ * Each of the N concurrent clients opens its own connection and sends its requests one after another.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "EnhancementProtocol.hpp"
+#include "CommandLine.hpp"
+
+struct ClientResult {
+    ClientResult() : numFailed(0) {}
+    std::vector<double> latenciesMs;
+    int numFailed;
+};
+
+static int connectToServer(const std::string& socketPath) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (clientSocket < 0 || connect(clientSocket, (sockaddr*)&address, sizeof(address)) < 0) {
+        std::cerr << "ERROR: Couldn't connect to " << socketPath << ": " << strerror(errno) << std::endl;
+        if (clientSocket >= 0) {
+            close(clientSocket);
+        }
+        return -1;
+    }
+    return clientSocket;
+}
+
+static void runClient(
+        const std::string& socketPath, int numRequests, uint32_t width, uint32_t height, ClientResult& result) {
+    int clientSocket = connectToServer(socketPath);
+    if (clientSocket < 0) {
+        result.numFailed = numRequests;
+        return;
+    }
+
+    // Synthetic gradient image
+    std::vector<uint8_t> image(size_t(width) * size_t(height) * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t *pixel = &image.at((size_t(y) * width + x) * 4);
+            pixel[0] = uint8_t(x * 255 / width);
+            pixel[1] = uint8_t(y * 255 / height);
+            pixel[2] = uint8_t((x + y) * 127 / (width + height));
+            pixel[3] = 255;
+        }
+    }
+    std::vector<uint8_t> output(image.size());
+
+    EnhancementRequestHeader request;
+    request.magic = ENHANCEMENT_REQUEST_MAGIC;
+    request.width = width;
+    request.height = height;
+    request.format = ENHANCEMENT_FORMAT_RGBA8;
+
+    for (int i = 0; i < numRequests; i++) {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        EnhancementResponseHeader response;
+        if (!writeFully(clientSocket, &request, sizeof(request))
+                || !writeFully(clientSocket, &image.front(), image.size())
+                || !readFully(clientSocket, &response, sizeof(response))
+                || response.magic != ENHANCEMENT_RESPONSE_MAGIC) {
+            result.numFailed += numRequests - i;
+            break;
+        }
+        if (response.status != ENHANCEMENT_OK) {
+            result.numFailed++;
+            continue;
+        }
+        if (!readFully(clientSocket, &output.front(), output.size())) {
+            result.numFailed += numRequests - i;
+            break;
+        }
+        result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    close(clientSocket);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <socket> [--concurrency N] [--requests N] [--width W] [--height H]" << std::endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string socketPath = argv[1];
+    int concurrency = std::max(std::atoi(getOption(argc, argv, "--concurrency", "4").c_str()), 1);
+    int numRequests = std::max(std::atoi(getOption(argc, argv, "--requests", "100").c_str()), 1);
+    uint32_t width = uint32_t(std::max(std::atoi(getOption(argc, argv, "--width", "1920").c_str()), 1));
+    uint32_t height = uint32_t(std::max(std::atoi(getOption(argc, argv, "--height", "1080").c_str()), 1));
+
+    std::vector<ClientResult> results(concurrency);
+    std::vector<std::thread> clients;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < concurrency; i++) {
+        clients.push_back(std::thread(
+                runClient, socketPath, numRequests, width, height, std::ref(results.at(i))));
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::vector<double> latenciesMs;
+    int numFailed = 0;
+    for (ClientResult& result : results) {
+        latenciesMs.insert(latenciesMs.end(), result.latenciesMs.begin(), result.latenciesMs.end());
+        numFailed += result.numFailed;
+    }
+    std::sort(latenciesMs.begin(), latenciesMs.end());
+
+    double throughput = double(latenciesMs.size()) / elapsedS;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Requests: " << latenciesMs.size() << " succeeded, " << numFailed << " failed ("
+              << concurrency << " clients, " << width << "x" << height << ")" << std::endl;
+    std::cout << "Throughput: " << throughput << " images/s, "
+              << (throughput * width * height / 1e6) << " MPixel/s" << std::endl;
+    if (!latenciesMs.empty()) {
+        std::cout << "Latency (ms): p50 " << latenciesMs.at(latenciesMs.size() / 2)
+                  << ", p99 " << latenciesMs.at(std::min(latenciesMs.size() - 1, latenciesMs.size() * 99 / 100))
+                  << ", max " << latenciesMs.back() << std::endl;
+    }
+    return numFailed == 0 ? 0 : 1;
+}
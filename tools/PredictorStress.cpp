@@ -0,0 +1,210 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Calls one shared GridPredictor from many threads at once.
+ * Usage: hdrnetstress [--model <dir>] [--threads N] [--calls N] [--intra-op-threads N] [--batch-threads N]
+ * Every thread predicts the grids of different synthetic images and compares them against reference grids
+ * computed on a single thread before, so results handed to the wrong caller are detected. The throughput is
+ * measured for 1, 2, 4, ... threads up to --threads (default: number of cores). --batch-threads of the threads
+ * call computeGridCoefficientsBatch instead. Build with -DUSE_TSAN=ON to check for data races.
+ * The exit code is 0 if all grids matched.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "GridPredictor.hpp"
+#include "ImageUtils.hpp"
+#include "Tracer.hpp"
+#include "BenchmarkCommon.hpp"
+
+//! Number of different input images (and reference grids) the threads cycle through
+const int NUM_TEST_IMAGES = 8;
+const int BATCH_SIZE = 4;
+
+static bool gridsMatch(const GridCoefficients& grid, const GridCoefficients& reference) {
+    if (grid.gridSize != reference.gridSize || grid.coefficients.size() != reference.coefficients.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < grid.coefficients.size(); i++) {
+        // Allows for different summation orders, but not for the grid of another image
+        float difference = std::abs(grid.coefficients[i] - reference.coefficients[i]);
+        if (difference > 1e-4f * std::max(std::abs(reference.coefficients[i]), 1.0f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct StressResult {
+    int numThreads;
+    double callsPerSecond;
+    int numMismatches;
+    int numFailures;
+};
+
+static StressResult runStressTest(
+        const GridPredictor& gridPredictor, const std::vector<FrameDataPtr>& lowresImages,
+        const std::vector<GridCoefficientsPtr>& referenceGrids, int numThreads, int numBatchThreads,
+        int numCallsPerThread) {
+    std::atomic<int> numMismatches(0), numFailures(0), numCalls(0);
+    std::atomic<bool> startFlag(false);
+    std::vector<std::thread> threads;
+    for (int threadIndex = 0; threadIndex < numThreads; threadIndex++) {
+        bool useBatches = threadIndex < numBatchThreads;
+        threads.push_back(std::thread([&, threadIndex, useBatches]() {
+            Tracer::setThreadName("stress " + std::to_string(threadIndex));
+            while (!startFlag.load()) {
+                std::this_thread::yield();
+            }
+            for (int call = 0; call < numCallsPerThread; call++) {
+                int firstImage = (threadIndex * 3 + call) % NUM_TEST_IMAGES;
+                std::vector<GridCoefficientsPtr> grids;
+                std::vector<int> imageIndices;
+                if (useBatches) {
+                    std::vector<FrameDataPtr> batch;
+                    for (int i = 0; i < BATCH_SIZE; i++) {
+                        imageIndices.push_back((firstImage + i) % NUM_TEST_IMAGES);
+                        batch.push_back(lowresImages.at(imageIndices.back()));
+                    }
+                    if (!gridPredictor.computeGridCoefficientsBatch(batch, grids)) {
+                        grids.clear();
+                    }
+                } else {
+                    imageIndices.push_back(firstImage);
+                    grids.push_back(gridPredictor.computeGridCoefficients(*lowresImages.at(firstImage)));
+                }
+
+                if (grids.size() != imageIndices.size() || !grids.front()) {
+                    numFailures++;
+                    continue;
+                }
+                for (size_t i = 0; i < grids.size(); i++) {
+                    if (!gridsMatch(*grids.at(i), *referenceGrids.at(imageIndices.at(i)))) {
+                        numMismatches++;
+                    }
+                }
+                numCalls += int(grids.size());
+            }
+        }));
+    }
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    startFlag.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    StressResult result;
+    result.numThreads = numThreads;
+    result.callsPerSecond = double(numCalls.load()) / elapsedS;
+    result.numMismatches = numMismatches.load();
+    result.numFailures = numFailures.load();
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = std::atoi(getOption(argc, argv, "--threads", "0").c_str());
+    if (maxThreads <= 0) {
+        maxThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+    }
+    int numCallsPerThread = std::max(std::atoi(getOption(argc, argv, "--calls", "50").c_str()), 1);
+    // One TensorFlow thread per call by default, so that the scaling comes from the concurrent callers
+    int intraOpThreads = std::atoi(getOption(argc, argv, "--intra-op-threads", "1").c_str());
+    int numBatchThreads = std::max(std::atoi(getOption(argc, argv, "--batch-threads", "0").c_str()), 0);
+
+    initializeApplication(argc, argv);
+    std::string modelPath = getOption(argc, argv, "--model");
+    if (modelPath.empty()) {
+        modelPath = getDefaultTestModelDirectory();
+        if (!createTestModel(modelPath)) {
+            return 1;
+        }
+    } else if (modelPath.back() != '/') {
+        modelPath += "/";
+    }
+
+    GridPredictor gridPredictor;
+    if (!gridPredictor.loadGraph(modelPath, intraOpThreads)) {
+        return 1;
+    }
+
+    // Reference grids computed one after another
+    std::vector<FrameDataPtr> lowresImages;
+    std::vector<GridCoefficientsPtr> referenceGrids;
+    for (int i = 0; i < NUM_TEST_IMAGES; i++) {
+        FrameData image;
+        createSyntheticImage(640, 480, uint32_t(i + 1), image);
+        FrameDataPtr lowresImage(new FrameData);
+        downscaleForInference(image, *lowresImage);
+        GridCoefficientsPtr grid = gridPredictor.computeGridCoefficients(*lowresImage);
+        if (!grid) {
+            return 1;
+        }
+        lowresImages.push_back(lowresImage);
+        referenceGrids.push_back(grid);
+    }
+
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "grids/s" << std::setw(10) << "speedup"
+              << std::setw(12) << "mismatches" << std::setw(10) << "failures" << std::endl;
+    bool passed = true;
+    double singleThreadedThroughput = 0.0;
+    for (int numThreads = 1; ; numThreads = std::min(numThreads * 2, maxThreads)) {
+        StressResult result = runStressTest(
+                gridPredictor, lowresImages, referenceGrids, numThreads, std::min(numBatchThreads, numThreads),
+                numCallsPerThread);
+        if (numThreads == 1) {
+            singleThreadedThroughput = result.callsPerSecond;
+        }
+        std::cout << std::setw(8) << numThreads << std::fixed << std::setprecision(1)
+                  << std::setw(14) << result.callsPerSecond << std::setprecision(2)
+                  << std::setw(10) << result.callsPerSecond / singleThreadedThroughput
+                  << std::setw(12) << result.numMismatches << std::setw(10) << result.numFailures << std::endl;
+        passed = passed && result.numMismatches == 0 && result.numFailures == 0;
+        if (numThreads >= maxThreads) {
+            break;
+        }
+    }
+    std::cout << "Input tensors allocated: " << gridPredictor.getNumPooledTensors() << std::endl;
+    std::cout << (passed ? "All grids matched the reference grids." : "FAILED: Wrong or missing grids.")
+              << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2017, Christoph Neuhauser
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the copyright holder nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Compares the filtered synthetic test images against golden images.
+ * Usage: hdrnetregression --golden <dir> [--update] [--tolerance N] [--max-differing F]
+ *                         [--resolutions 640x480,...] [--software-gl] [--no-gl] [--json <file>]
+ * The images are filtered with the generated test model on the CPU and with OpenGL. Both results are
+ * compared against the golden images and against each other. A comparison fails if more than the fraction F
+ * of the pixels differ by more than N in any color channel. No golden images are committed; they are written
+ * with --update by a known-good revision (see README.md).
+ * The exit code is 0 if all comparisons passed.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <boost/filesystem.hpp>
+#include <GL/glew.h>
+#include <Graphics/Texture/TextureManager.hpp>
+#include "GridPredictor.hpp"
+#include "GridRenderer.hpp"
+#include "CpuSlicer.hpp"
+#include "GuideParameters.hpp"
+#include "ImageUtils.hpp"
+#include "BenchmarkCommon.hpp"
+
+struct ComparisonResult {
+    std::string name;
+    std::string reference;
+    int maxDifference;
+    double meanDifference;
+    double differingFraction;
+    bool passed;
+};
+
+//! Compares the RGB channels of two images (the golden images are stored without alpha channel).
+static ComparisonResult compareImages(
+        const std::string& name, const std::string& reference, const FrameData& image,
+        const FrameData& referenceImage, int tolerance, double maxDifferingFraction) {
+    ComparisonResult result;
+    result.name = name;
+    result.reference = reference;
+    result.maxDifference = 255;
+    result.meanDifference = 255.0;
+    result.differingFraction = 1.0;
+    result.passed = false;
+    if (image.w != referenceImage.w || image.h != referenceImage.h) {
+        return result;
+    }
+
+    size_t numPixels = size_t(image.w) * size_t(image.h);
+    size_t numDifferingPixels = 0;
+    double differenceSum = 0.0;
+    result.maxDifference = 0;
+    for (size_t i = 0; i < numPixels; i++) {
+        int maxPixelDifference = 0;
+        for (int c = 0; c < 3; c++) {
+            int difference = std::abs(int(image.pixels[i*4 + c]) - int(referenceImage.pixels[i*4 + c]));
+            maxPixelDifference = std::max(maxPixelDifference, difference);
+            differenceSum += difference;
+        }
+        result.maxDifference = std::max(result.maxDifference, maxPixelDifference);
+        if (maxPixelDifference > tolerance) {
+            numDifferingPixels++;
+        }
+    }
+    result.meanDifference = differenceSum / double(numPixels * 3);
+    result.differingFraction = double(numDifferingPixels) / double(numPixels);
+    result.passed = result.differingFraction <= maxDifferingFraction;
+    return result;
+}
+
+//! Compares image with the golden image of the same name or replaces the golden image (updateGolden).
+static bool checkGoldenImage(
+        const std::string& name, const FrameData& image, const std::string& goldenDirectory, bool updateGolden,
+        int tolerance, double maxDifferingFraction, std::vector<ComparisonResult>& results) {
+    std::string goldenFilename = goldenDirectory + name + ".png";
+    if (updateGolden) {
+        return saveImageFile(goldenFilename, image);
+    }
+    FrameData goldenImage;
+    if (!loadImageFile(goldenFilename, goldenImage)) {
+        std::cerr << "Missing golden image " << goldenFilename << " (create it with --update)" << std::endl;
+        return false;
+    }
+    results.push_back(compareImages(name, "golden", image, goldenImage, tolerance, maxDifferingFraction));
+    return results.back().passed;
+}
+
+static void writeJson(std::ostream& stream, const std::vector<ComparisonResult>& results, bool passed) {
+    stream << std::fixed << std::setprecision(6);
+    stream << "{\n";
+    stream << "  \"passed\": " << (passed ? "true" : "false") << ",\n";
+    stream << "  \"comparisons\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const ComparisonResult& result = results.at(i);
+        stream << "    {\"name\": \"" << escapeJson(result.name) << "\", \"reference\": \"" << result.reference
+               << "\", \"max_difference\": " << result.maxDifference
+               << ", \"mean_difference\": " << result.meanDifference
+               << ", \"differing_fraction\": " << result.differingFraction
+               << ", \"passed\": " << (result.passed ? "true" : "false") << "}"
+               << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    stream << "  ]\n";
+    stream << "}\n";
+}
+
+int main(int argc, char *argv[]) {
+    std::string goldenDirectory = getOption(argc, argv, "--golden");
+    if (goldenDirectory.empty()) {
+        std::cerr << "Usage: " << argv[0] << " --golden <dir> [--update] [--tolerance N] [--max-differing F]"
+                  << " [--resolutions WxH,...] [--software-gl] [--no-gl] [--json <file>]" << std::endl;
+        return 1;
+    }
+    if (goldenDirectory.back() != '/') {
+        goldenDirectory += "/";
+    }
+    bool updateGolden = hasOption(argc, argv, "--update");
+    int tolerance = std::atoi(getOption(argc, argv, "--tolerance", "2").c_str());
+    double maxDifferingFraction = std::atof(getOption(argc, argv, "--max-differing", "0.001").c_str());
+    std::vector<glm::ivec2> resolutions = parseResolutions(
+            getOption(argc, argv, "--resolutions", "640x480,1280x720,1920x1080"));
+    bool useOpenGL = !hasOption(argc, argv, "--no-gl");
+
+    initializeApplication(argc, argv);
+    std::string modelPath = getDefaultTestModelDirectory();
+    GridPredictor gridPredictor;
+    GuideParameters guide;
+    if (!createTestModel(modelPath) || !gridPredictor.loadGraph(modelPath) || !guide.load(modelPath)) {
+        return 1;
+    }
+    CpuSlicer cpuSlicer;
+    cpuSlicer.setGuideParameters(guide);
+
+    GridRenderer *gridRenderer = NULL;
+    if (useOpenGL) {
+        createOpenGLContext(hasOption(argc, argv, "--software-gl"));
+        gridRenderer = new GridRenderer;
+        gridRenderer->initialize(modelPath);
+    }
+    if (updateGolden) {
+        boost::system::error_code errorCode;
+        boost::filesystem::create_directories(goldenDirectory, errorCode);
+    }
+
+    bool passed = true;
+    std::vector<ComparisonResult> results;
+    for (size_t i = 0; i < resolutions.size(); i++) {
+        const glm::ivec2& resolution = resolutions.at(i);
+        FrameData image;
+        createSyntheticImage(resolution.x, resolution.y, uint32_t(i + 1), image);
+        FrameDataPtr lowresImage(new FrameData);
+        downscaleForInference(image, *lowresImage);
+        GridCoefficientsPtr gridPtr = gridPredictor.computeGridCoefficients(*lowresImage);
+        if (!gridPtr) {
+            return 1;
+        }
+        const GridCoefficients& grid = *gridPtr;
+
+        FrameData cpuImage;
+        cpuSlicer.slice(image, grid, cpuImage);
+        std::string cpuName = "cpu_" + resolutionToString(resolution);
+        passed = checkGoldenImage(
+                cpuName, cpuImage, goldenDirectory, updateGolden, tolerance, maxDifferingFraction, results) && passed;
+
+        if (gridRenderer) {
+            sgl::TexturePtr imageTexture = sgl::TextureManager->createEmptyTexture(resolution.x, resolution.y);
+            imageTexture->uploadPixelData(resolution.x, resolution.y, image.pixels);
+            gridRenderer->uploadGrid(grid);
+            FrameData glImage(resolution.x, resolution.y);
+            gridRenderer->renderSlicedImageToMemory(imageTexture, glImage.pixels);
+            std::string glName = "gl_" + resolutionToString(resolution);
+            passed = checkGoldenImage(
+                    glName, glImage, goldenDirectory, updateGolden, tolerance, maxDifferingFraction, results)
+                    && passed;
+
+            // Both slicing implementations need to stay interchangeable
+            results.push_back(compareImages(
+                    glName, cpuName, glImage, cpuImage, tolerance, maxDifferingFraction));
+            passed = results.back().passed && passed;
+        }
+    }
+
+    for (const ComparisonResult& result : results) {
+        std::cout << std::left << std::setw(20) << result.name << std::setw(20) << result.reference
+                  << (result.passed ? "passed" : "FAILED") << "  max difference " << result.maxDifference
+                  << ", differing pixels " << std::fixed << std::setprecision(4)
+                  << result.differingFraction * 100.0 << "%" << std::endl;
+    }
+    if (updateGolden) {
+        std::cout << "Golden images written to " << goldenDirectory << std::endl;
+    }
+
+    std::string jsonFilename = getOption(argc, argv, "--json");
+    if (!jsonFilename.empty()) {
+        std::ofstream jsonFile(jsonFilename.c_str());
+        writeJson(jsonFile, results, passed);
+    }
+
+    delete gridRenderer;
+    if (useOpenGL) {
+        releaseApplication();
+    }
+    return passed ? 0 : 1;
+}